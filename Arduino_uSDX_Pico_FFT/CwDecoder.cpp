@@ -23,74 +23,56 @@
 #include "TFT_eSPI.h"
 #include "display_tft.h"
 #include "CwDecoder.h"
+#include "CwMorse.h"
+
+static_assert(CW_LETTER_NMARK >= CW_TREE_DEPTH, "letter_mark: a held letter of the longest code must fit");
+static_assert(offsetof(cw_dec_t, out_head) == offsetof(cw_dec_t, out) + CW_OUT_LEN, "cw_dec_t: out_head follows out");
+static_assert(sizeof(cw_dec_t) - offsetof(cw_dec_t, out_head) <= 4, "cw_dec_t: out and out_head last (cw_dec_init)");
 
 
 
 
 
 
-struct st_tabcw
-  {
-  uint16_t nbit;  /* numero de pontos e tracos do dado */
-  uint16_t cod;   /* pontos bit = 0  e tracos bit = 1 */
-  } tabcw[128] = {0};
-
-// reference to the morse cw table tabcw[],  grouped by number os dots and dashs
-#define TABCW1  2
-uint16_t tabcw1[TABCW1] = { 'E', 'T' };
-#define TABCW2  4
-uint16_t tabcw2[TABCW2] = { 'A', 'I', 'M', 'N' };
-#define TABCW3  8
-uint16_t tabcw3[TABCW3] = { 'K', 'U', 'S', 'D', 'G', 'O', 'R', 'W' };
-#define TABCW4  12
-uint16_t tabcw4[TABCW4] = { 'L', 'F', 'B', 'C', 'H', 'J', 'P', 'Q', 'V', 'X', 'Y', 'Z' };
-#define TABCW5  12
-uint16_t tabcw5[TABCW5] = { '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '=', '/' };
-#define TABCW6  7
-uint16_t tabcw6[TABCW6] = { '.', ',', ';', ':', '-', '\'', '?' };
-#define TABCW8   1 
-uint16_t tabcw8[TABCW8] = { '*' };
-
-
-
-
-
-uint16_t cw_rx[MAX_CW_RX_INDEX][2];
-uint16_t cw_rx_array;
-uint16_t cw_rx_index;
-uint32_t cw_rx_avg;
 uint16_t cw_rx_cnt;
 
+volatile cw_frame_t cw_ring[CW_RING_SIZE];
+volatile uint16_t cw_ring_wr = 0;
+volatile uint16_t cw_ring_rd = 0;
+volatile uint32_t cw_ring_drops = 0;
+
+volatile int16_t cw_gz_coeff;
+volatile int16_t cw_gz_cos, cw_gz_sin;
+int16_t cw_pitch_buf[CW_PITCH_NSAMP];
+volatile uint16_t cw_pitch_pos = CW_PITCH_NSAMP;
+uint16_t cw_pitch = CW_PITCH_INIC;
+bool cw_pitch_auto = true;
+static int16_t cw_pitch_coeff[CW_PITCH_NBIN];   // 2cos(w) of the bank, Q14
+
 // wpm = 1200 / tponto ms 
-//#define TDOT_MIN      16          // x 2.5ms =  40ms
-#define TDOT_MIN       4         // x 2.5ms =  10ms   120wpm
-#define TDOT_MAX      96         // x 2.5ms = 240ms     5wpm
-#define TDOT_SHIFT     1         // tdot accumulate 4x
-// wpm = 1200 / tponto ms   (time base for reading the cw audio is 2.5ms)
-// 60  =  20ms   / 2.5ms =  8 counts
-// 30  =  40ms   / 2.5ms = 16
-// 20  =  60ms   / 2.5ms = 24
-// 15  =  80ms   / 2.5ms = 32
-// 10  = 120ms   / 2.5ms = 48
-//  5  = 240ms   / 2.5ms = 96
-uint16_t tdot;
-uint16_t tdot_acc;
-uint16_t limiar_min_dot;    // 1/2 dot
-uint16_t limiar_min_dash;  //2x_dot
-uint16_t limiar_min_space;    //5x dot
-uint16_t limiar_space;    //7x dot
-uint16_t cw_rx_limiar;
-uint16_t count_low;
-uint16_t count_high;
-uint16_t cw_level;
-
-#define CW_RX_LIMIAR_INIC   4
-//#define CW_RX_LIMIAR_MIN   3
-//#define CW_RX_LIMIAR_MAX  10
-
-
-uint16_t cw_letter_pos;
-uint16_t cw_letter;
+// counts are levels: 5ms for the main decoder (CW_FRAME_US), 2.5ms for the skimmer channels (SK_NBLOCK)
+//#define TDOT_MIN      16          // x 5ms =  80ms
+#define TDOT_MIN       4         // x 5ms =  20ms    60wpm  (skimmer 120wpm)
+#define TDOT_MAX      96         // x 5ms = 480ms   2.5wpm  (skimmer 5wpm)
+#define TDOT_INIC     24         // x 5ms = 120ms    10wpm  (skimmer 20wpm)
+#define CW_MARK_MAX   (7*TDOT_MAX)   // longer marks are a carrier, not in the mark clusters
+// wpm = 1200 / tponto ms   (main decoder: 5ms levels, the skimmer has twice the counts)
+// 60  =  20ms   / 5ms =  4 counts
+// 30  =  40ms   / 5ms =  8
+// 20  =  60ms   / 5ms = 12
+// 15  =  80ms   / 5ms = 16
+// 10  = 120ms   / 5ms = 24
+//  5  = 240ms   / 5ms = 48
+
+cw_dec_t cw_main;    // decoder of the audio (CW mode), the skimmer channels have their own
+
+// clusters of the histograms (Otsu: two classes with the largest between class variance)
+#define CW_LVL_EVERY        8    // levels between two level thresholds (40ms, skimmer 20ms)
+#define CW_LVL_MIN_N       32    // levels before the first threshold
+#define CW_LVL_SEP         96    // mark >= 1.5 octaves (9dB) above space, in bins <<4, noise alone is ~1 octave
+#define CW_DUR_MIN_N        4    // durations before the clusters are used
+#define CW_DUR_MIN_CL       2    // dots and dashes each before the decoder is locked (one cluster: CW_DUR_NHIST marks)
+#define CW_DUR_SEP         64    // dash >= 1 octave above dot (3x), letter space above element space, bins <<4
 
 #define SCW_MAX   15
 //                     "123456789012345"
@@ -153,7 +135,7 @@ bool cw_out(int8_t *v, int8_t *u)
 /**************************************************************************************
     
 **************************************************************************************/
-void CwCalcTime()
+void CwCalcTime(cw_dec_t *d)
 {
   //tdash = 3 * tdot;
   //spchar = 3 * tdot;
@@ -165,15 +147,27 @@ void CwCalcTime()
   // space letter = 3
   // space word = 7
 
-  tdot = tdot_acc>>TDOT_SHIFT;  //tdot_acc needs 16x up to chanag 1 in tdot
+  // dot/dash and element/letter boundaries come from the duration clusters, 0 = not known
+  uint16_t w;
 
-  limiar_min_dot = tdot>>1;       // 1/2 dot = min time for dot and space  less than this = noise or high wpm
-  limiar_min_dash = 2 * tdot;  //2x_dot
-  limiar_min_space = 5 * tdot;    //5x dot
-  limiar_space = 7 * tdot;    //7x dot
+  if(d->tdot < TDOT_MIN) d->tdot = TDOT_MIN;
+  if(d->tdot > TDOT_MAX) d->tdot = TDOT_MAX;
 
-  sprintf(s1, "%d_", tdot);
-  tft_writexy_plus(1, TFT_LIGHTGREY, TFT_BACKGROUND, 1, 0, 0, 0, (uint8_t *)s1);   
+  d->limiar_min_dot = (d->tdot>>2) > 2 ? (d->tdot>>2) : 2;   // 1/4 dot = min time for a level change, less than this = noise
+  if(d->limiar_min_dash == 0) d->limiar_min_dash = 2 * d->tdot;  //2x_dot
+  if(d->limiar_letter == 0) d->limiar_letter = 2 * d->tdot;      //2x_dot
+
+  w = (d->t_letter * 5) / 3;    //5x dot  or 5/3 of the letter spaces of this sender
+  if(w < 4 * d->tdot) w = (d->t_letter == 0) ? 5 * d->tdot : 4 * d->tdot;
+  if(w > 6 * d->tdot) w = 6 * d->tdot;
+  d->limiar_min_space = w;
+  d->limiar_space = 7 * d->tdot;    //7x dot
+
+  if(d->show)
+  {
+    sprintf(s1, "%d_", d->tdot);
+    tft_writexy_plus(1, TFT_LIGHTGREY, TFT_BACKGROUND, 1, 0, 0, 0, (uint8_t *)s1);   
+  }
 }
 
 
@@ -204,6 +198,25 @@ void  to_display(char c)
 
 
 
+/**************************************************************************************
+    character decoded: main decoder to the display, the others to their out list
+**************************************************************************************/
+void  cw_put(cw_dec_t *d, char c)
+{
+  if(d->show)
+  {
+    to_display(c);
+  }
+  else
+  {
+    d->out[d->out_head & (CW_OUT_LEN-1)] = c;
+    d->out_head++;     // the reader (other core) only reads up to out_head
+  }
+  d->last = c;
+}
+
+
+
 #define SCWGRAPH_X    0
 #define SCWGRAPH_Y    10
 #define SCWGRAPH_H    16
@@ -283,21 +296,29 @@ void  graph_to_display(void)
 /**************************************************************************************
     
 **************************************************************************************/
-void CwDecoder_Inic(void)
+void cw_dec_init(cw_dec_t *d, bool show)
 {
-  tdot_acc = 10<<TDOT_SHIFT;   //  tdot = tdot_acc>>TDOT_SHIFT;     // 32 = 15wpm  cw dot time (time base for other parameters)
-  CwCalcTime();
+  memset(d, 0, offsetof(cw_dec_t, out));   //out and out_head stay: the reader keeps its position
+  d->show = show;
+  d->tdot = TDOT_INIC;     // cw dot time (time base for other parameters) until the marks are known
+  CwCalcTime(d);
 
   //tft_writexy_plus(1, TFT_LIGHTGREY, TFT_BACKGROUND, 8, 0, 3, 20, (uint8_t *)scw);   
   //to_display('K');
 
 
-  cw_rx_limiar = CW_RX_LIMIAR_INIC;
-  count_low = 0;
-  count_high = 0;
-  cw_level = 0;
-  cw_letter_pos = 0;
-  cw_letter = 0;
+  d->cw_rx_limiar = 0xffff;   //no signal until the levels are known
+  d->last = ' ';
+}
+
+
+
+/**************************************************************************************
+    
+**************************************************************************************/
+void CwDecoder_Inic(void)
+{
+  cw_dec_init(&cw_main, true);
 }
 
 
@@ -335,27 +356,29 @@ void CwDecoder_Exit(void)
 /**************************************************************************************
     
 **************************************************************************************/
-void new_dot(void)
+void new_dot(cw_dec_t *d)
 {
   //include the dot on the letter received
   //including 0 = dot
-  cw_letter_pos++;   //dot is 0   and cw_letter is already 0
+  cw_letter_add(&d->cw_letter, &d->cw_letter_pos, false);
   //use the counter_high to adjust the tdot
   //to_display('.');
 
-  sprintf(s1, "%d_", count_high);
-  tft_writexy_plus(1, TFT_LIGHTGREY, TFT_BACKGROUND, 4, 0, 0, 0, (uint8_t *)s1); 
+  if(d->show)
+  {
+    sprintf(s1, "%d_", d->count_high);
+    tft_writexy_plus(1, TFT_LIGHTGREY, TFT_BACKGROUND, 4, 0, 0, 0, (uint8_t *)s1); 
+  }
 }
 
 
 /**************************************************************************************
     
 **************************************************************************************/
-void new_dash(void)
+void new_dash(cw_dec_t *d)
 {
   //include the dash on the letter received
-  cw_letter |= (0x8000>>cw_letter_pos); //including 1 = dash
-  cw_letter_pos++;
+  cw_letter_add(&d->cw_letter, &d->cw_letter_pos, true);  //including 1 = dash
   //use the counter_high to adjust the tdot->tdash
   //to_display('-');
 }
@@ -364,7 +387,7 @@ void new_dash(void)
 /**************************************************************************************
     
 **************************************************************************************/
-void new_space_dot_dash(void)
+void new_space_dot_dash(cw_dec_t *d)
 {
   //ok,  do nothing     next dot or dash is comming
   //use the counter_low to adjust the tdot->limiar_min_space
@@ -372,34 +395,13 @@ void new_space_dot_dash(void)
 
 
 
-char cw_search_letter(uint16_t num, uint16_t *tab)
-{
-  uint16_t i;
-  char ret;
-
-  for(i=0; i<num; i++)
-  {
-    if(cw_letter == tabcw[tab[i]].cod)
-      break;
-  }
-  if(i<num)
-  {
-    ret = tab[i];
-  }
-  else
-  {
-    ret = '#';  //not find
-  }
-  return ret;
-}
-
-
-
 /**************************************************************************************
     new space between letters
 **************************************************************************************/
-void new_space_letters(void)
+void new_space_letters(cw_dec_t *d)
 {
+  char c;
+
 /*
   //if last letter on the word is not a space
   if(scw[SCW_MAX-1] != ' ')
@@ -408,326 +410,465 @@ void new_space_letters(void)
     to_display(' '); 
   }
 */
-  //finished the letter
-  //  look for the letter on the table  and show on display
-  switch(cw_letter_pos)
+  if(d->cw_letter_pos == 0)  //no dot or dash since the last letter
+    return;
+
+  if(d->held)   //started during acquisition: dots and dashes again with the boundary known now
   {
-    case 1:
-        to_display(cw_search_letter(TABCW1, tabcw1));
-      break;
-    case 2:
-        to_display(cw_search_letter(TABCW2, tabcw2));
-      break;
-    case 3:
-        to_display(cw_search_letter(TABCW3, tabcw3));
-      break;
-    case 4:
-        to_display(cw_search_letter(TABCW4, tabcw4));
-      break;
-    case 5:
-        to_display(cw_search_letter(TABCW5, tabcw5));
-      break;
-    case 6:
-        to_display(cw_search_letter(TABCW6, tabcw6));
-      break;
-    case 8:
-        to_display(cw_search_letter(TABCW8, tabcw8));
-      break;
-    default:
-        to_display('#');  // don't know
-      break;
+    if(!d->locked || (d->cw_letter_pos > CW_LETTER_NMARK))
+    {
+      d->cw_letter = 0;     //still not known: the letter is lost
+      d->cw_letter_pos = 0;
+      return;
+    }
+    d->cw_letter = cw_letter_marks(d->letter_mark, d->cw_letter_pos, d->limiar_min_dash);
   }
 
-  cw_letter = 0;     //clear the dot/dashes for new letter
-  cw_letter_pos = 0;   //clear the count of dot/dashes
+  //finished the letter
+  //  look for the letter on the tree  and show on display
+  c = cw_letter_char(d->cw_letter, d->cw_letter_pos);
+  if(c || !d->held)
+    cw_put(d, c ? c : '#');  // don't know (held: a first element cut by the level threshold, lost)
+
+  d->cw_letter = 0;     //clear the dot/dashes for new letter
+  d->cw_letter_pos = 0;   //clear the count of dot/dashes
 }
 
 
 /**************************************************************************************
     
 **************************************************************************************/
-void new_space_words(void)
+void new_space_words(cw_dec_t *d)
 {
   //if last letter on the word is not a space
-  if(scw[SCW_MAX-1] != ' ')
+  if(d->last != ' ')
   {
     //   insert a space on the word
-    to_display(' '); 
+    cw_put(d, ' '); 
   }
 }
 
-/*
-#define LEV_SHORT   0
-#define LEV_OK      1
-#define LEV_LONG    2
+/**************************************************************************************
+    histogram bin of a value: log2 with 4 bins per octave (~19%), 0..3 are the values
+**************************************************************************************/
+static uint8_t cw_bin(uint16_t v)
+{
+  uint16_t msb;
 
-uint16_t lev_high = LEV_OK;
-uint16_t lev_low = LEV_OK;
-*/
+  if(v < 4) return v;
+  msb = 31 - __builtin_clz(v);
+  return 4 * (msb - 1) + ((v >> (msb - 2)) & 3);
+}
 
 /**************************************************************************************
-    
+    value of a bin <<4 (between the bins linear)
 **************************************************************************************/
-/*
-void wpm_adjust(void)
+static uint16_t cw_bin_val(uint16_t bq)
 {
-//  if((lev_low == LEV_SHORT) && (lev_high == LEV_SHORT))
-  if(lev_high == LEV_SHORT)
-  {
-    if(tdot > TDOT_MIN)
-    {  
-      tdot_acc--;
-      CwCalcTime();
-    }
-    lev_high = LEV_OK;
-  }
+  uint32_t v0, v1;
+  uint16_t b = bq >> 4;
+
+  v0 = (b < 4) ? b : (uint32_t)(4 + (b & 3)) << (b/4 - 1);
+  b++;
+  v1 = (b < 4) ? b : (uint32_t)(4 + (b & 3)) << (b/4 - 1);
+  v0 += ((v1 - v0) * (bq & 15)) >> 4;
+  return (v0 > 0xfffe) ? 0xfffe : (uint16_t)v0;
+}
+
+/**************************************************************************************
+    the oldest value of the ring leaves the histogram when the new one comes in
+**************************************************************************************/
+static void cw_level_in(cw_dec_t *d, uint16_t level)
+{
+  cw_hist_t *h = &d->h_lvl;
+  uint8_t b = cw_bin(level);
+
+  if(h->n < CW_LVL_NHIST) h->n++;
+  else h->cnt[d->r_lvl[h->pos]]--;
+  d->r_lvl[h->pos] = b;
+  h->cnt[b]++;
+  h->pos = (h->pos + 1) & (CW_LVL_NHIST-1);
+}
+
+static void cw_dur_in(cw_hist_t *h, uint16_t *ring, uint16_t count)
+{
+  if(h->n < CW_DUR_NHIST) h->n++;
+  else h->cnt[cw_bin(ring[h->pos])]--;
+  ring[h->pos] = count;
+  h->cnt[cw_bin(count)]++;
+  h->pos = (h->pos + 1) & (CW_DUR_NHIST-1);
+}
+
+/**************************************************************************************
+    two class clustering (Otsu) of a histogram: class 0 = bins <= t
+    the split with the largest between class variance n0*n1*(m1-m0)^2 = (s0*n1 - s1*n0)^2 / (n0*n1)
+    returns false without two classes, else the class sizes and the mean bins <<4
+**************************************************************************************/
+typedef struct
+{
+  uint8_t  t;
+  uint16_t n0, n1;
+  uint16_t m0, m1;
+} cw_split_t;
+
+static bool cw_otsu(cw_hist_t *h, cw_split_t *r)
+{
+  int32_t n0 = 0, n1, s0 = 0, s1, sum = 0, x;
+  int64_t v, best = 0;
+  uint16_t b;
 
-//  if((lev_low == LEV_LONG) && (lev_high == LEV_LONG))
-  if(lev_high == LEV_LONG)
+  for(b=0; b<CW_HIST_NBIN; b++)
+    sum += b * h->cnt[b];
+
+  for(b=0; b<CW_HIST_NBIN-1; b++)
   {
-    if(tdot < TDOT_MAX)
+    n0 += h->cnt[b];
+    s0 += b * h->cnt[b];
+    n1 = h->n - n0;
+    if(n0 == 0) continue;
+    if(n1 == 0) break;
+    s1 = sum - s0;
+    x = s0 * n1 - s1 * n0;
+    v = ((int64_t)x * x) / ((int64_t)n0 * n1);
+    if(v > best)
     {
-      tdot_acc++;
-      CwCalcTime();
-    } 
-    lev_high = LEV_OK;
+      best = v;
+      r->t = b;
+      r->n0 = n0;
+      r->n1 = n1;
+      r->m0 = (s0 << 4) / n0;
+      r->m1 = (s1 << 4) / n1;
+    }
   }
+  return (best > 0);
 }
-*/
 
 /**************************************************************************************
-    
+    mean durations of the two classes (class 0 = bins <= t)
 **************************************************************************************/
-void wpm_up(void)
+static void cw_dur_means(cw_hist_t *h, uint16_t *ring, uint8_t t, uint16_t *m0, uint16_t *m1)
 {
-  if(tdot > TDOT_MIN)
-  {  
-    tdot_acc--;
-    CwCalcTime();
+  uint32_t s0 = 0, s1 = 0;
+  uint16_t i, n0 = 0, n1 = 0;
 
-    sprintf(s1, "%d_", tdot);
-    tft_writexy_plus(1, TFT_LIGHTGREY, TFT_BACKGROUND, 1, 0, 0, 0, (uint8_t *)s1);   
+  for(i=0; i<h->n; i++)
+  {
+    if(cw_bin(ring[i]) <= t) { s0 += ring[i]; n0++; }
+    else { s1 += ring[i]; n1++; }
   }
+  *m0 = n0 ? s0 / n0 : 0;
+  *m1 = n1 ? s1 / n1 : 0;
 }
 
+
 /**************************************************************************************
-    
+    level threshold: arithmetic mean of the mean mark and mean space levels (linear, from the bin values)
+    no decoding while there are no marks CW_LVL_SEP above the space level
+    the clustering runs every CW_LVL_EVERY levels, the histogram takes one level at a time
 **************************************************************************************/
-void wpm_down(void)
+void cw_threshold(cw_dec_t *d, uint16_t level)
 {
-  if(tdot < TDOT_MAX)
-  {
-    tdot_acc++;
-    CwCalcTime();
+  cw_split_t s;
+  uint32_t l0 = 0, l1 = 0, v;
+  uint16_t b;
 
-    sprintf(s1, "%d_", tdot);
-    tft_writexy_plus(1, TFT_LIGHTGREY, TFT_BACKGROUND, 1, 0, 0, 0, (uint8_t *)s1);   
-  }  
-}
+  cw_level_in(d, level);
+  if(++d->lvl_cnt < CW_LVL_EVERY) return;
+  d->lvl_cnt = 0;
 
+  if((d->h_lvl.n >= CW_LVL_MIN_N) && cw_otsu(&d->h_lvl, &s) &&
+     ((s.m1 - s.m0) >= CW_LVL_SEP) && (s.n1 >= (d->h_lvl.n >> 4)))
+  {
+    for(b=0; b<CW_HIST_NBIN; b++)
+    {
+      v = (uint32_t)d->h_lvl.cnt[b] * cw_bin_val(b << 4);
+      if(b <= s.t) l0 += v;
+      else l1 += v;
+    }
+    d->cw_rx_limiar = (l0 / s.n0 + l1 / s.n1) >> 1;
+  }
+  else
+    d->cw_rx_limiar = 0xffff;   //no signal: stays low
+}
 
-#define DOT    1
-#define DASH   3
-#define SPACE_DOT_DASH   1
-#define SPACE_LETTERS    3
-#define SPACE_WORDS    7
 
 /**************************************************************************************
-    
+    mark ended: dot and dash clusters give tdot and the dot/dash boundary
+    with one cluster only (EEE, TTT) it is dots when shorter than the boundary
 **************************************************************************************/
-void wpm_ok(uint16_t count, uint16_t size)
+void cw_mark_time(cw_dec_t *d, uint16_t count)
 {
+  cw_split_t s;
+  uint16_t m0, m1;
 
-  if((size * tdot) > count)  //ok, but will adjust
+  cw_dur_in(&d->h_mark, d->r_mark, count);
+  if((d->h_mark.n >= CW_DUR_MIN_N) && cw_otsu(&d->h_mark, &s) && ((s.m1 - s.m0) >= CW_DUR_SEP))
   {
-    tdot_acc--;
-    CwCalcTime();
+    cw_dur_means(&d->h_mark, d->r_mark, s.t, &m0, &m1);
+    d->tdot = (m0 + m1/3) / 2;
+    d->limiar_min_dash = (m0 + m1) / 2;
+    if((s.n0 >= CW_DUR_MIN_CL) && (s.n1 >= CW_DUR_MIN_CL)) d->locked = true;
   }
-  else if((size * tdot) < count)  //ok, but will adjust
+  else
   {
-    tdot_acc++;
-    CwCalcTime();
+    cw_dur_means(&d->h_mark, d->r_mark, CW_HIST_NBIN, &m0, &m1);
+    d->tdot = (m0 < d->limiar_min_dash) ? m0 : m0/3;
+    d->limiar_min_dash = 0;   //2x dot
+    if(d->h_mark.n >= CW_DUR_NHIST) d->locked = true;   //one cluster only (EEE, TTT)
   }
+  CwCalcTime(d);
+}
 
-/*
-  if((tdot_acc>>TDOT_SHIFT) > tdot)  //if tdot is good   try to bring tdot_acc to the correct value
+/**************************************************************************************
+    space ended (not between words): element and letter space clusters
+**************************************************************************************/
+void cw_space_time(cw_dec_t *d, uint16_t count)
+{
+  cw_split_t s;
+  uint16_t m0, m1;
+
+  cw_dur_in(&d->h_space, d->r_space, count);
+  if((d->h_space.n >= CW_DUR_MIN_N) && cw_otsu(&d->h_space, &s) && ((s.m1 - s.m0) >= CW_DUR_SEP))
   {
-    tdot_acc--;
-    tdot = tdot_acc>>TDOT_SHIFT;  //tdot_acc needs 16x up to chanag 1 in tdot
-    CwCalcTime();
+    cw_dur_means(&d->h_space, d->r_space, s.t, &m0, &m1);
+    d->limiar_letter = (m0 + m1) / 2;
+    d->t_letter = m1;
   }
-  else if((tdot_acc>>TDOT_SHIFT) < tdot) 
+  else
   {
-    tdot_acc++;
-    tdot = tdot_acc>>TDOT_SHIFT;  //tdot_acc needs 16x up to chanag 1 in tdot
-    CwCalcTime();
+    d->limiar_letter = 0;   //2x dot
+    d->t_letter = 0;
   }
-*/
+  CwCalcTime(d);
 }
 
 
 /**************************************************************************************
-    
+    cw_dec_level - one cw level (5ms main, 2.5ms skimmer) into the timing state machine of decoder d
+    a level change counts when it stays for limiar_min_dot, the counts before belong to the new level
+    acquisition: until the dot and dash clusters are known the boundary is a guess from TDOT_INIC,
+    a letter started then is held and decoded at its end from its mark durations, when the clusters
+    are still not known it is lost (the first letter or two of a new signal)
+**************************************************************************************/
+void cw_dec_level(cw_dec_t *d, uint16_t level)
+{
+  uint16_t on;
+
+  cw_threshold(d, level);
+  on = (level > d->cw_rx_limiar) ? 1 : 0;
+
+  if(on == d->cw_level)
+  {
+    // *******************  same level: a shorter change was noise  *******************
+    if(on)
+    {
+      d->count_high += 1 + d->count_pend;
+      if(d->count_high > CW_MARK_MAX)        //tone for so long (rf carrier)
+      {
+        d->count_high = CW_MARK_MAX;      //just to limit the counter
+      }
+    }
+    else
+    {
+      d->count_low += 1 + d->count_pend;
+      if(d->count_low >= d->limiar_min_space)         //5x dot = space between words (no more signal)
+      {
+        new_space_letters(d);
+        d->count_low = d->limiar_space;      //7x dot = just to limit the counter
+      }
+    }
+    d->count_pend = 0;
+    return;
+  }
+
+  if(++d->count_pend < d->limiar_min_dot)
+    return;
+
+  if(on)
+    {
+      // ********************************************************************* 
+      // *************************** level raising ***************************
+      // ********************************************************************* 
+
+      if(d->show) cw_in(-d->count_low, d->tdot);  //make a list of info to send through serial when out of CW mode
+
+      if(d->count_low < d->limiar_min_space)
+      {
+        cw_space_time(d, d->count_low);
+      }
+
+      if(d->count_low < d->limiar_letter)   //2x_dot
+      {
+        new_space_dot_dash(d);
+      }
+      else if(d->count_low < d->limiar_min_space)        //5x dot  = space between letter
+      {
+        new_space_letters(d);
+      }
+      else  //big space
+      {
+        new_space_words(d);
+      }
+
+      d->count_high = d->count_pend;
+      d->count_low = 0;
+    }
+  else
+    { 
+      // *********************************************************************
+      // *************************** level falling ***************************
+      // *********************************************************************
+
+      if(d->cw_letter_pos == 0) d->held = !d->locked;   //first element of a letter
+      if(d->cw_letter_pos < CW_LETTER_NMARK) d->letter_mark[d->cw_letter_pos] = d->count_high;
+
+      if(d->count_high < d->limiar_min_dash)    //2x_dot  =  dot time
+      {
+        new_dot(d);
+      }
+      else    //dash  or a tone for so long
+      {
+        new_dash(d);
+      }
+
+      if(d->count_high < CW_MARK_MAX)    //no carrier, slower marks too
+      {
+        cw_mark_time(d, d->count_high);
+      }
+
+      if(d->show) cw_in(d->count_high, d->cw_letter);  //make a list of info to send through serial when out of CW mode
+
+      d->count_low = d->count_pend;
+      d->count_high = 0;
+    }
+  d->count_pend = 0;
+  d->cw_level = on;
+}
+
+
+/**************************************************************************************
+    cw_pitch_set - Goertzel of rx() to the CW tone
 **************************************************************************************/
-void cw_limiar_up(void)
+void cw_pitch_set(uint16_t hz)
 {
+  float w;
+
+  if(hz < CW_PITCH_MIN) hz = CW_PITCH_MIN;
+  if(hz > CW_PITCH_MAX) hz = CW_PITCH_MAX;
+  w = 2.0f * (float)M_PI * (float)hz / (float)CW_FSAMP;
+
+  cw_pitch = hz;
+  cw_gz_coeff = (int16_t)(2.0f * cosf(w) * (1<<CW_GZ_Q));
+  cw_gz_cos = (int16_t)(cosf(w) * (1<<CW_GZ_Q));
+  cw_gz_sin = (int16_t)(sinf(w) * (1<<CW_GZ_Q));
 }
 
+
+
 /**************************************************************************************
-    
+    cw_pitch_evaluate - strongest tone of the last audio buffer
+    power of each bank bin (Goertzel), the peak must stand CW_PITCH_SNR above the average
+    parabolic interpolation between the bins, then the pitch moves half way to it
+**************************************************************************************/
+void cw_pitch_evaluate(void)
+{
+  int64_t p[CW_PITCH_NBIN], sum = 0;
+  int32_t s0, s1, s2;
+  uint16_t b, n, best = 0;
+  float a, c, e, delta, f;
+
+  if(cw_pitch_pos < CW_PITCH_NSAMP)  //rx() still filling
+    return;
+
+  for(b=0; b<CW_PITCH_NBIN; b++)
+  {
+    s1 = 0;
+    s2 = 0;
+    for(n=0; n<CW_PITCH_NSAMP; n++)
+    {
+      s0 = cw_pitch_buf[n] + (int32_t)(((int64_t)cw_pitch_coeff[b] * s1) >> CW_GZ_Q) - s2;
+      s2 = s1;
+      s1 = s0;
+    }
+    p[b] = (int64_t)s1*s1 + (int64_t)s2*s2 - ((((int64_t)cw_pitch_coeff[b] * s1) >> CW_GZ_Q) * s2);
+    sum += p[b];
+    if(p[b] > p[best]) best = b;
+  }
+  cw_pitch_pos = 0;  //next buffer
+
+  if((p[best] * CW_PITCH_NBIN) < (sum * CW_PITCH_SNR))  //no tone
+    return;
+
+  f = (float)(CW_PITCH_MIN + best * CW_PITCH_STEP);
+  if((best > 0) && (best < CW_PITCH_NBIN-1))
+  {
+    a = sqrtf((float)p[best-1]);
+    c = sqrtf((float)p[best]);
+    e = sqrtf((float)p[best+1]);
+    delta = 0.5f * (a - e) / (a - 2.0f*c + e);
+    f += delta * CW_PITCH_STEP;
+  }
+  if(fabsf(f - (float)cw_pitch) > CW_PITCH_STEP)
+    cw_pitch_set((uint16_t)f);   //new station: jump
+  else
+    cw_pitch_set((uint16_t)(((float)cw_pitch + f) * 0.5f));
+}
+
+
+
+/**************************************************************************************
+    cw_ring_put - one level frame from rx() (DSP IRQ)
 **************************************************************************************/
-void cw_limiar_down(void)
+void cw_ring_put(uint16_t level)
 {
+  uint16_t wr = cw_ring_wr;
+
+  if(((wr + 1) & CW_RING_MASK) == cw_ring_rd)  //full: the decoder is late
+  {
+    cw_ring_drops++;
+    return;
+  }
+  cw_ring[wr].level = level;
+  cw_ring[wr].time = time_us_64();
+  __dmb();  // frame written before the index: the main loop reads the index first
+  cw_ring_wr = (wr + 1) & CW_RING_MASK;
 }
 
+
 /**************************************************************************************
     CwDecoder_array_in - uses the cw audio level to search for cw characters
-    array received with samples @ 2.5ms
+    takes all the frames in the ring, frames dropped (time stamp gap) keep the last level
+    so the mark and space times stay right
 **************************************************************************************/
 void CwDecoder_array_in(void)
 {
-uint16_t i = 0;
-static uint16_t cw_rx_array_old = 0;
+static uint64_t time_last = 0;
+static uint16_t level_last = 0;
+uint64_t time, dt;
+uint32_t gap;
+uint16_t rd, level, n = 0;
 
 
-  if(cw_rx_array != cw_rx_array_old)  //new array ready to analysis
+  while((rd = cw_ring_rd) != cw_ring_wr)
   {
-
-    //look the level on the received array
-    for(i=0; i<MAX_CW_RX_INDEX; i++)
-      {
-        //to_graph(cw_rx[i][cw_rx_array_old]);  //put the signal on graphic
-
-        //sprintf(s1, "%d_", cw_rx[i][cw_rx_array_old]);
-        //tft_writexy_plus(1, TFT_LIGHTGREY, TFT_BACKGROUND, 4, 0, 3, 20, (uint8_t *)s1); 
-
-        if(cw_rx[i][cw_rx_array_old] > cw_rx_limiar)
-          {
-            // *******************  input signal level = high  *******************
-
-            if(cw_level == 1)  //if it was already high
-              {
-                count_high++;
-                if(count_high > limiar_space)        //7x dot = tone for so long (rf carrier)
-                {
-                  count_high = limiar_space;      //7x dot = just to limit the counter
-                }
-              }
-            else  // cw_level == 0   was low and changed to high (look for spaces)
-              {
-                // ********************************************************************* 
-                // *************************** level raising ***************************
-                // ********************************************************************* 
-
-                cw_in(-count_low, tdot);  //make a list of info to send through serial when out of CW mode
-
-                if(count_low < limiar_min_dot)   // 1/2 dot = noise ?   faster wpm ?
-                {
-                  //possible noise, but counts as space between dots and dashs  
-                  new_space_dot_dash();
-                  //wpm_up();    //lev_low = LEV_SHORT;
-                  //wpm_up(0);   //increase wpm
-                }
-                else if(count_low < limiar_min_dash)   //2x_dot
-                {
-                  new_space_dot_dash();
-                  //wpm_ok(count_low, SPACE_DOT_DASH);    //lev_low = LEV_OK;
-                }
-                else if(count_low < limiar_min_space)        //5x dot  = space between letter
-                {
-                  new_space_letters();
-                  //wpm_ok(count_low, SPACE_LETTERS);    //lev_low = LEV_OK;
-                }
-                else  //big space
-                {
-                  new_space_words();
-                  //cw_limiar_down();  //decrease limiar to detect level high (no high level detected)
-                  //wpm_ok(count_low, SPACE_WORDS);    //lev_low = LEV_OK;
-                }
-
-                //cw_in(-count_low, cw_letter);  //make a list of info to send through serial when out of CW mode
-
-
-                //wpm_adjust();
-
-              }
-            count_low = 0;
-            cw_level = 1;   //receiving the high level
-          }
-        else
-          {
-            // *******************  input signal level = low  *******************
-
-            if(cw_level == 0)  //if it was already low
-              {
-                count_low++;
-                if(count_low == limiar_min_space)         //5x dot = space between words (no more signal)
-                {
-                  new_space_letters();
-                  count_low = limiar_space;      //7x dot = just to limit the counter
-                }
-/*
-                if(count_low > limiar_space)        //7x dot =  space between words (no more signal)
-                {
-                  new_space_words();
-                  count_low = limiar_space;      //7x dot = just to limit the counter
-                }
-*/
-              }
-            else  // cw_level == 1   was high and changed to low (look for dots and dashs)
-              { 
-                // *********************************************************************
-                // *************************** level falling ***************************
-                // *********************************************************************
-
-                //to_scw((count_high / tdot) + '0');
-/*
-                if(count_high < limiar_min_dot)   // 1/2 dot = noise ?   faster wpm ?
-                {
-                  //ignores this level - noise?
-                  count_low++;
-                  lev_high = LEV_SHORT;
-                  //wpm_up(1);  //increase wpm
-                  cw_limiar_up();  //increase limiar to detect level high (getting spikes os sound)
-                }
-                else
-*/
-                  
-                //cw_in(count_high, tdot);  //make a list of info to send through serial when out of CW mode
-                
-                if(count_high < limiar_min_dot)   // 1/2 dot = noise ?   faster wpm ?
-                {
-                  new_dot();
-                  wpm_up();    //lev_high = LEV_SHORT;
-                }
-                if(count_high < limiar_min_dash)    //2x_dot  =  dot time
-                {
-                  new_dot();
-                  wpm_ok(count_high, DOT);    //lev_high = LEV_OK;
-                }
-                else if(count_high < limiar_min_space)  //5x dot  = dash time
-                {
-                  new_dash();
-                  wpm_ok(count_high, DASH);    //lev_high = LEV_OK;
-                }
-                else    // noise?  lower wpm ?
-                {
-                  new_dash();
-                  wpm_down();    //lev_high = LEV_LONG;
-                  //wpm_down();   //decrease wpm
-                }
-
-                cw_in(count_high, cw_letter);  //make a list of info to send through serial when out of CW mode
-
-                //wpm_adjust();
-
-              }
-            count_high = 0;
-            cw_level = 0;   //receiving the low level
-          }
-      }
-    cw_rx_array_old = cw_rx_array;
+    __dmb();   // index read before the frame, the slot is given back at the end (64 bit time: two loads)
+    time = cw_ring[rd].time;
+    level = cw_ring[rd].level;
+    dt = time - time_last;
+    gap = 0;
+    if(dt < (uint64_t)CW_RING_SIZE * CW_FRAME_US)  //not after a pause of the decoding (other mode, TX)
+      gap = ((uint32_t)dt + CW_FRAME_US/2) / CW_FRAME_US;
+    for(; gap > 1; gap--)
+      cw_dec_level(&cw_main, level_last);
+    cw_dec_level(&cw_main, level);
+    time_last = time;
+    level_last = level;
+    cw_ring_rd = (rd + 1) & CW_RING_MASK;
+    n++;
   }
+
+  if((n > 0) && cw_pitch_auto)  //follow the tone
+    cw_pitch_evaluate();
 }
 
 
@@ -748,127 +889,12 @@ void CwDecoder_Loop(void)
 **************************************************************************************/
 void CwDecoder_InicTable(void)
 {
+  uint16_t b;
 
-
-// TABCW1
-tabcw['E'].nbit = 1;
-tabcw['E'].cod = 0x0000;    /* 00000000B  ;E      */
-tabcw['T'].nbit = 1;
-tabcw['T'].cod = 0x8000;    /* 10000000B  ;T      */
-
-// TABCW2
-tabcw['A'].nbit = 2;
-tabcw['A'].cod = 0x4000;    /* 01000000B  ;A      */
-tabcw['I'].nbit = 2;
-tabcw['I'].cod = 0x0000;    /* 00000000B  ;I      */
-tabcw['M'].nbit = 2;
-tabcw['M'].cod = 0xc000;    /* 11000000B  ;M      */
-tabcw['N'].nbit = 2;
-tabcw['N'].cod = 0x8000;    /* 10000000B  ;N      */
-
-// TABCW3
-tabcw['K'].nbit = 3;
-tabcw['K'].cod = 0xa000;    /* 10100000B  ;K  */
-tabcw['U'].nbit = 3;
-tabcw['U'].cod = 0x2000;    /* 00100000B  ;U      */
-tabcw['S'].nbit = 3;
-tabcw['S'].cod = 0x0000;    /* 00000000B  ;S      */
-tabcw['D'].nbit = 3;
-tabcw['D'].cod = 0x8000;    /* 10000000B  ;D      */
-tabcw['G'].nbit = 3;
-tabcw['G'].cod = 0xc000;    /* 11000000B  ;G      */
-tabcw['O'].nbit = 3;
-tabcw['O'].cod = 0xe000;    /* 11100000B  ;O      */
-tabcw['R'].nbit = 3;
-tabcw['R'].cod = 0x4000;    /* 01000000B  ;R      */
-tabcw['W'].nbit = 3;
-tabcw['W'].cod = 0x6000;    /* 01100000B  ;W      */
-
-// TABCW4
-tabcw['L'].nbit = 4;
-tabcw['L'].cod = 0x4000;    /* 01000000B  ;L      */
-tabcw['F'].nbit = 4;
-tabcw['F'].cod = 0x2000;    /* 00100000B  ;F      */
-tabcw['B'].nbit = 4;
-tabcw['B'].cod = 0x8000;    /* 10000000B  ;B      */
-tabcw['C'].nbit = 4;
-tabcw['C'].cod = 0xa000;    /* 10100000B  ;C      */
-tabcw['H'].nbit = 4;
-tabcw['H'].cod = 0x0000;    /* 00000000B  ;H      */
-tabcw['J'].nbit = 4;
-tabcw['J'].cod = 0x7000;    /* 01110000B  ;J      */
-tabcw['P'].nbit = 4;
-tabcw['P'].cod = 0x6000;    /* 01100000B  ;P      */
-tabcw['Q'].nbit = 4;
-tabcw['Q'].cod = 0xd000;    /* 11010000B  ;Q      */
-tabcw['V'].nbit = 4;
-tabcw['V'].cod = 0x1000;    /* 00010000B  ;V      */
-tabcw['X'].nbit = 4;
-tabcw['X'].cod = 0x9000;    /* 10010000B  ;X      */
-tabcw['Y'].nbit = 4;
-tabcw['Y'].cod = 0xb000;    /* 10110000B  ;Y      */
-tabcw['Z'].nbit = 4;
-tabcw['Z'].cod = 0xc000;    /* 11000000B  ;Z      */
-
-// TABCW5
-tabcw['1'].nbit = 5;
-tabcw['1'].cod = 0x7800;    /* 01111000B  ;1      */
-tabcw['2'].nbit = 5;
-tabcw['2'].cod = 0x3800;    /* 00111000B  ;2      */
-tabcw['3'].nbit = 5;
-tabcw['3'].cod = 0x1800;    /* 00011000B  ;3      */
-tabcw['4'].nbit = 5;
-tabcw['4'].cod = 0x0800;    /* 00001000B  ;4      */
-tabcw['5'].nbit = 5;
-tabcw['5'].cod = 0x0000;    /* 00000000B  ;5      */
-tabcw['6'].nbit = 5;
-tabcw['6'].cod = 0x8000;    /* 10000000B  ;6      */
-tabcw['7'].nbit = 5;
-tabcw['7'].cod = 0xc000;    /* 11000000B  ;7      */
-tabcw['8'].nbit = 5;
-tabcw['8'].cod = 0xe000;    /* 11100000B  ;8      */
-tabcw['9'].nbit = 5;
-tabcw['9'].cod = 0xf000;    /* 11110000B  ;9      */
-tabcw['0'].nbit = 5;
-tabcw['0'].cod = 0xf800;    /* 11111000B  ;0      */
-tabcw['='].nbit = 5;
-tabcw['='].cod = 0x8800;    /* 10001000B  ; =     */
-tabcw['/'].nbit = 5;
-tabcw['/'].cod = 0x9000;    /* 10010000B  ; /     */
-
-// TABCW5
-tabcw['.'].nbit = 6;
-tabcw['.'].cod = 0x5400;    /* 01010100B  ; .     */
-tabcw[','].nbit = 6;
-tabcw[','].cod = 0xcc00;    /* 11001100B  ; ,     */
-tabcw[';'].nbit = 6;
-tabcw[';'].cod = 0xa800;    /* 10101000B  ; ;     */
-tabcw[':'].nbit = 6;
-tabcw[':'].cod = 0xe000;    /* 11100000B  ; :     */
-tabcw['-'].nbit = 6;
-tabcw['-'].cod = 0x8400;    /* 10000100B  ; -     */
-tabcw['\''].nbit = 6;
-tabcw['\''].cod = 0x4800;   /* 01001000B  ; '     */
-tabcw['?'].nbit = 6;
-tabcw['?'].cod = 0x3000;    /* 00110000B  ; ?     */  
-
-// TABCW7
-tabcw['*'].nbit = 8;
-tabcw['*'].cod = 0x0000;    /* 00000000B  ; ERRO  */
-
-
-
-//tabcw['E'].nbit = 5;
-//tabcw['E'].cod = 0x2000;    /* 00100000B  ; E'    */
-//tabcw['~'].nbit = 5;
-//tabcw['~'].cod = 0x2800;    /* 00101000B  ; A~O   */
-//tabcw['€'].nbit = 5;
-//tabcw['€'].cod = 0xa000;    /* 10100000B  ; C,    */
-//tabcw['A'].nbit = 4;
-//tabcw['A'].cod = 0x5000;    /* 01010000B  ; A'    */
-
-
-
+  //Goertzel coefficients of the pitch bank, and the decoder Goertzel on the default pitch
+  for(b=0; b<CW_PITCH_NBIN; b++)
+    cw_pitch_coeff[b] = (int16_t)(2.0f * cosf(2.0f * (float)M_PI * (float)(CW_PITCH_MIN + b*CW_PITCH_STEP) / (float)CW_FSAMP) * (1<<CW_GZ_Q));
+  cw_pitch_set(cw_pitch);
 }
 
 
@@ -16,14 +16,100 @@ extern "C" {
 
 
 
-#define  MAX_CW_RX_CNT  40   // 40 * 
-#define  MAX_CW_RX_INDEX  40   // 40 * 
-extern uint16_t cw_rx[MAX_CW_RX_INDEX][2];
-extern uint16_t cw_rx_array;
-extern uint16_t cw_rx_index;
-extern uint32_t cw_rx_avg;
+#define  MAX_CW_RX_CNT  40   // audio samples per level frame
 extern uint16_t cw_rx_cnt;
 
+/* CW level frames: rx() (DSP IRQ, core0_irq_handler) puts one every MAX_CW_RX_CNT samples, the decoder
+ * (hmi_evaluate, main loop on the same core) takes them at its pace
+ * single producer / single consumer ring from the IRQ to the main loop: the IRQ can come at any point of
+ * the reading, so a slot is given back (cw_ring_rd) only after it was read
+ * a frame that finds the ring full is counted and dropped */
+#define CW_RING_SIZE     128                  // power of 2: 640ms @ 5ms
+#define CW_RING_MASK     (CW_RING_SIZE - 1)
+typedef struct
+{
+  uint16_t level;
+  uint64_t time;                              // time_us_64() at the end of the frame
+} cw_frame_t;
+extern volatile cw_frame_t cw_ring[CW_RING_SIZE];
+extern volatile uint16_t cw_ring_wr;          // written only by rx()
+extern volatile uint16_t cw_ring_rd;          // written only by the decoder
+extern volatile uint32_t cw_ring_drops;
+void cw_ring_put(uint16_t level);
+
+/* CW tone level: Goertzel at the CW pitch on the audio (8kHz in CW), see rx() in dsp.cpp
+ * two filters of CW_GZ_N samples started MAX_CW_RX_CNT apart, one ends every MAX_CW_RX_CNT samples */
+#define CW_FSAMP         (FSAMP_AUDIO/2u)     // CW RX runs the audio @ 8kHz
+#define CW_FRAME_US      ((1000000u * MAX_CW_RX_CNT) / CW_FSAMP)   // 5ms per level frame
+#define CW_GZ_N          (2*MAX_CW_RX_CNT)    // 80 samples = 10ms, ~100Hz wide
+#define CW_GZ_Q          14                   // coefficients Q14
+#define CW_GZ_SHIFT      5                    // magnitude (N/2 * amplitude) to the frame level
+extern volatile int16_t cw_gz_coeff;          // 2cos(w)
+extern volatile int16_t cw_gz_cos, cw_gz_sin;
+
+/* pitch acquisition: a bank of Goertzel bins over CW_PITCH_NSAMP audio samples, strongest tone */
+#define CW_PITCH_NSAMP   256                  // 32ms
+#define CW_PITCH_MIN     400                  // Hz
+#define CW_PITCH_MAX     1000
+#define CW_PITCH_STEP    25
+#define CW_PITCH_NBIN    ((CW_PITCH_MAX - CW_PITCH_MIN) / CW_PITCH_STEP + 1)
+#define CW_PITCH_SNR     8                    // peak power >= 8x the bank average (9dB)
+#define CW_PITCH_INIC    700
+extern int16_t cw_pitch_buf[CW_PITCH_NSAMP];
+extern volatile uint16_t cw_pitch_pos;        // filled by rx() up to CW_PITCH_NSAMP
+extern uint16_t cw_pitch;                     // Hz
+extern bool cw_pitch_auto;
+void cw_pitch_set(uint16_t hz);
+
+
+/* Rolling histograms of the decoder: log2 bins (4 per octave) over the last values of a ring */
+#define CW_HIST_NBIN    64   // bin of a 16 bit value, see cw_bin()
+#define CW_LVL_NHIST    256  // levels in the level histogram (power of 2): 1.28s, skimmer 640ms
+#define CW_DUR_NHIST    16   // marks / spaces in the duration histograms (power of 2)
+typedef struct
+{
+  uint16_t n;                // values in the histogram, up to the ring size
+  uint16_t pos;              // next position in the ring
+  uint16_t cnt[CW_HIST_NBIN];
+} cw_hist_t;
+
+/* Decoder state, one per signal: the main decoder (audio level from rx()) and the skimmer channels */
+#define CW_OUT_LEN      32   // decoded characters not read yet, power of 2
+#define CW_LETTER_NMARK  8   // mark durations kept for a letter held during acquisition (longest code)
+typedef struct
+{
+  uint16_t tdot;             // dot time in levels (5ms main decoder, 2.5ms skimmer channels)
+  uint16_t limiar_min_dot;   // 1/4 dot: shorter level changes are noise
+  uint16_t limiar_min_dash;  // dot/dash boundary, from the mark clusters (2x dot)
+  uint16_t limiar_letter;    // element/letter space boundary, from the space clusters (2x dot)
+  uint16_t limiar_min_space; // letter/word space boundary (5x dot)
+  uint16_t limiar_space;     // 7x dot
+  uint16_t t_letter;         // letter space cluster, 0 = not known
+  uint16_t cw_rx_limiar;     // level threshold, from the level clusters
+  uint16_t count_low;
+  uint16_t count_high;
+  uint16_t count_pend;       // level changed for so many counts, not accepted yet
+  uint16_t cw_level;
+  uint16_t cw_letter_pos;
+  uint16_t cw_letter;
+  uint8_t  lvl_cnt;          // levels since the last threshold
+  bool     locked;           // dot and dash clusters known (acquisition done)
+  bool     held;             // letter started before the lock: decoded again from letter_mark at its end
+  uint16_t letter_mark[CW_LETTER_NMARK];
+  char     last;             // last character out (no double spaces)
+  bool     show;             // main decoder: text and timing on the display
+  cw_hist_t h_lvl, h_mark, h_space;
+  uint8_t  r_lvl[CW_LVL_NHIST];     // bins of the last levels
+  uint16_t r_mark[CW_DUR_NHIST];    // last mark and space durations
+  uint16_t r_space[CW_DUR_NHIST];
+  /* last: cw_dec_init() clears up to out, the reader (other core) may be reading them */
+  char     out[CW_OUT_LEN];  // characters out (not shown), written by the decoder
+  volatile uint8_t out_head;
+} cw_dec_t;
+
+void cw_dec_init(cw_dec_t *d, bool show);
+void cw_dec_level(cw_dec_t *d, uint16_t level);   // one level (5ms main decoder, 2.5ms skimmer)
+
 void CwDecoder_InicTable(void);
 void CwDecoder_Inic(void);
 void CwDecoder_Exit(void);
@@ -0,0 +1,118 @@
+#ifndef __CWMORSE_H__
+#define __CWMORSE_H__
+
+/*
+ * CwMorse.h
+ *
+ * Created: Oct 2026
+ *
+ * Morse code table of the CW decoder (CwDecoder.cpp) and the packing of a letter:
+ * the elements of a letter go into a 16 bit word, first one in bit 15, dash = 1,
+ * the character is found in a binary tree made from the table at compile time.
+ * No Arduino headers, the host test Aux/cw_morse_test.cpp uses it as it is.
+ */
+
+#include <stdint.h>
+
+
+/* morse code of the characters decoded, dot = '.'  dash = '-' */
+struct st_morse
+{
+  char c;
+  const char *code;
+};
+
+static constexpr st_morse tab_morse[] = {
+  {'E', "."},      {'T', "-"},
+  {'A', ".-"},     {'I', ".."},     {'M', "--"},     {'N', "-."},
+  {'K', "-.-"},    {'U', "..-"},    {'S', "..."},    {'D', "-.."},
+  {'G', "--."},    {'O', "---"},    {'R', ".-."},    {'W', ".--"},
+  {'L', ".-.."},   {'F', "..-."},   {'B', "-..."},   {'C', "-.-."},
+  {'H', "...."},   {'J', ".---"},   {'P', ".--."},   {'Q', "--.-"},
+  {'V', "...-"},   {'X', "-..-"},   {'Y', "-.--"},   {'Z', "--.."},
+  {'1', ".----"},  {'2', "..---"},  {'3', "...--"},  {'4', "....-"},  {'5', "....."},
+  {'6', "-...."},  {'7', "--..."},  {'8', "---.."},  {'9', "----."},  {'0', "-----"},
+  {'=', "-...-"},  {'/', "-..-."},
+  {'.', ".-.-.-"}, {',', "--..--"}, {';', "-.-.-."}, {':', "---..."}, {'-', "-....-"},
+  {'\'', ".----."}, {'?', "..--.."},
+  {'*', "........"},   // error
+};
+
+/* binary tree of the codes in an array: root = 1, dot = 2n, dash = 2n+1
+ * a letter of pos elements is at (1<<pos) | (letter>>(16-pos)) */
+#define CW_TREE_DEPTH   8                         // longest code
+#define CW_TREE_SIZE    (2u << CW_TREE_DEPTH)
+
+struct st_morse_tree
+{
+  char c[CW_TREE_SIZE];   // 0 = no character
+};
+
+static constexpr uint16_t morse_len(const char *code)
+{
+  uint16_t n = 0;
+  while(code[n]) n++;
+  return n;
+}
+
+static constexpr uint16_t morse_index(const char *code)
+{
+  uint16_t i = 1;
+  for(; *code; code++)
+    i = 2*i + ((*code == '-') ? 1 : 0);
+  return i;
+}
+
+static constexpr st_morse_tree morse_tree_make(void)
+{
+  st_morse_tree t = {};
+  for(const st_morse &m : tab_morse)
+    t.c[morse_index(m.code)] = m.c;
+  return t;
+}
+
+static constexpr st_morse_tree tree_morse = morse_tree_make();
+
+/* checked at compile time: every code fits the tree, and decodes back to its character (no code twice) */
+static constexpr bool morse_tree_ok(void)
+{
+  for(const st_morse &m : tab_morse)
+  {
+    if((morse_len(m.code) == 0) || (morse_len(m.code) > CW_TREE_DEPTH)) return false;
+    for(const char *e = m.code; *e; e++)
+      if((*e != '.') && (*e != '-')) return false;
+    if(tree_morse.c[morse_index(m.code)] != m.c) return false;
+  }
+  return true;
+}
+static_assert(morse_tree_ok(), "tab_morse: code too long, not dot/dash or used twice");
+
+
+/* one element into the letter (new_dot, new_dash), elements after the 16th only count */
+static inline void cw_letter_add(uint16_t *letter, uint16_t *pos, bool dash)
+{
+  if(dash && (*pos < 16))
+    *letter |= (uint16_t)(0x8000u >> *pos);
+  (*pos)++;
+}
+
+/* letter from its mark durations: dash when >= the dot/dash boundary (held letters, see cw_dec_level) */
+static inline uint16_t cw_letter_marks(const uint16_t *mark, uint16_t pos, uint16_t limiar_min_dash)
+{
+  uint16_t i, letter = 0, n = 0;
+
+  for(i=0; i<pos; i++)
+    cw_letter_add(&letter, &n, mark[i] >= limiar_min_dash);
+  return letter;
+}
+
+/* character of a letter, 0 = none (no elements, too long or not a code of the table) */
+static inline char cw_letter_char(uint16_t letter, uint16_t pos)
+{
+  if((pos == 0) || (pos > CW_TREE_DEPTH))
+    return 0;
+  return tree_morse.c[(1u << pos) | (letter >> (16 - pos))];
+}
+
+
+#endif
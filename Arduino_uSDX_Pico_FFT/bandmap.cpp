@@ -0,0 +1,190 @@
+/*
+ * bandmap.cpp
+ *
+ * Created: Oct 2026
+ *
+ * Band map: index of the signals in the current waterfall span (+-80kHz around the LO),
+ * updated from every FFT line that core1 delivers for the waterfall.
+ * Per line:
+ *  - the noise floor is the median of the used bins (histogram, the values are 8 bit)
+ *  - local maxima above the detect level are the peaks, peaks within BM_MERGE_BINS are one
+ *    signal (SSB, AM sidebands), the frequency is interpolated with a parabola through the
+ *    peak bin and its neighbours
+ *  - a peak within BM_MATCH_HZ of an entry updates it, otherwise a new entry is made
+ *  - the duty of the entries in the span follows seen/not seen (IIR, 1/8 per line),
+ *    entries not seen for BM_EXPIRE_MS are dropped
+ * The work is done in place on the line, nothing is kept of the line itself.
+ * display_tft_loop() draws a marker per entry above the waterfall, bm_next() tunes to the
+ * next signal (Signal submenu, monitor "bm").
+ */
+
+#include "Arduino.h"
+#include "uSDR.h"
+#include "hmi.h"
+#include "dsp.h"
+#include "TFT_eSPI.h"
+#include "display_tft.h"
+#include "bandmap.h"
+
+
+#define BM_USED(i)			(((i) >= BM_EDGE_BINS) && ((i) < GRAPH_NUM_COLS-BM_EDGE_BINS) && \
+							 (abs((int16_t)(i) - (int16_t)FFT_NUMFREQ) > BM_DC_BINS))
+#define BM_BIT(j)			(1UL << (j))
+
+bm_sig_t bm_sig[BM_NSIG];
+uint8_t  bm_nsig = 0;
+
+
+/*
+ * FFT column of a frequency in the span of LO fc, -1 when outside
+ */
+static int16_t bm_bin(uint32_t f, uint32_t fc)
+{
+	int32_t d = (int32_t)(f - fc);
+	int32_t col;
+
+	col = (d >= 0) ? (d + (int32_t)FRES/2) / (int32_t)FRES : -((-d + (int32_t)FRES/2) / (int32_t)FRES);
+	col += FFT_NUMFREQ;
+	if ((col < 0) || (col >= (int32_t)GRAPH_NUM_COLS)) return -1;
+	return (int16_t)col;
+}
+
+/*
+ * Peak at column i: update the matching entry or make a new one, returns the entry or -1
+ */
+static int bm_peak(const uint8_t *line, int16_t i, uint32_t fc, uint32_t now, uint32_t seen)
+{
+	int32_t l = line[i-1], c = line[i], r = line[i+1];
+	int32_t den = l - 2*c + r;
+	int32_t d = 0;
+	uint32_t f;
+	int j, weak = -1;
+
+	if (den != 0) d = ((l - r) * (int32_t)FRES) / (2*den);		// parabolic interpolation
+	d = constrain(d, -(int32_t)FRES/2, (int32_t)FRES/2);
+	f = fc + ((int32_t)i - (int32_t)FFT_NUMFREQ) * (int32_t)FRES + d;
+
+	for (j=0; j<bm_nsig; j++)
+	{
+		if (seen & BM_BIT(j)) continue;
+		if (abs((int32_t)(bm_sig[j].freq - f)) > BM_MATCH_HZ) continue;
+		bm_sig[j].freq = f;
+		bm_sig[j].bin = i;
+		bm_sig[j].level = (uint8_t)((3*bm_sig[j].level + c + 2) >> 2);
+		bm_sig[j].last = now;
+		return j;
+	}
+
+	if (bm_nsig < BM_NSIG)
+		j = bm_nsig++;
+	else
+	{
+		for (j=0; j<bm_nsig; j++)									// full: the least active entry goes
+			if (!(seen & BM_BIT(j)) && ((weak < 0) || (bm_sig[j].duty < bm_sig[weak].duty))) weak = j;
+		if (weak < 0) return -1;
+		j = weak;
+	}
+	bm_sig[j].freq = f;
+	bm_sig[j].bin = i;
+	bm_sig[j].level = (uint8_t)c;
+	bm_sig[j].duty = 0;
+	bm_sig[j].first = now;
+	bm_sig[j].last = now;
+	return j;
+}
+
+/*
+ * One FFT line (GRAPH_NUM_COLS), fc is the LO it was collected on
+ */
+void bm_fft_line(const uint8_t *line, uint32_t fc)
+{
+	static uint16_t hist[256];
+	uint32_t now = millis();
+	uint32_t seen = 0;
+	uint16_t n = 0, half, nf, level;
+	int16_t i, pk = -1;
+	int j, last;
+	bm_sig_t *s;
+
+	if (fc < FFT_NUMFREQ*FRES) return;								// not tuned yet
+
+	/* Noise floor: median of the used bins */
+	memset(hist, 0, sizeof(hist));
+	for (i=0; i<(int16_t)GRAPH_NUM_COLS; i++)
+	{
+		if (!BM_USED(i)) continue;
+		hist[line[i]]++;
+		n++;
+	}
+	for (nf=0, half=0; nf<255; nf++)
+	{
+		half += hist[nf];
+		if (2*half >= n) break;
+	}
+	level = ((nf * BM_SNR) >> 2) + BM_MIN;
+
+	/* Peaks, the strongest of a group within BM_MERGE_BINS */
+	for (i=0; i<(int16_t)GRAPH_NUM_COLS; i++)
+	{
+		if (!BM_USED(i) || (line[i] < level) || (line[i] < line[i-1]) || (line[i] <= line[i+1])) continue;
+		if ((pk >= 0) && ((i - pk) <= BM_MERGE_BINS))
+		{
+			if (line[i] > line[pk]) pk = i;
+			continue;
+		}
+		if ((pk >= 0) && ((j = bm_peak(line, pk, fc, now, seen)) >= 0)) seen |= BM_BIT(j);
+		pk = i;
+	}
+	if ((pk >= 0) && ((j = bm_peak(line, pk, fc, now, seen)) >= 0)) seen |= BM_BIT(j);
+
+	/* Duty of the entries in the span, expiry */
+	j = 0;
+	while (j < bm_nsig)
+	{
+		s = &bm_sig[j];
+		if ((now - s->last) > BM_EXPIRE_MS)
+		{
+			last = --bm_nsig;										// last entry moves here, with its seen bit
+			*s = bm_sig[last];
+			seen = (seen & ~BM_BIT(j)) | (((seen >> last) & 1UL) << j);
+			continue;
+		}
+		s->bin = bm_bin(s->freq, fc);
+		if (s->bin >= 0)
+		{
+			if (seen & BM_BIT(j))
+				s->duty += (255 - s->duty + 7) >> 3;
+			else
+				s->duty -= (s->duty + 7) >> 3;
+		}
+		j++;
+	}
+}
+
+
+/*
+ * Tune to the next signal above/below the current frequency (wraps)
+ */
+int bm_next(bool up)
+{
+	int j, best = -1, wrap = -1;
+	uint32_t f;
+
+	for (j=0; j<bm_nsig; j++)
+	{
+		f = bm_sig[j].freq;
+		if (up)
+		{
+			if ((f > hmi_freq + FRES) && ((best < 0) || (f < bm_sig[best].freq))) best = j;
+			if ((wrap < 0) || (f < bm_sig[wrap].freq)) wrap = j;
+		}
+		else
+		{
+			if ((f + FRES < hmi_freq) && ((best < 0) || (f > bm_sig[best].freq))) best = j;
+			if ((wrap < 0) || (f > bm_sig[wrap].freq)) wrap = j;
+		}
+	}
+	if (best < 0) best = wrap;
+	if (best >= 0) hmi_freq = bm_sig[best].freq;
+	return best;
+}
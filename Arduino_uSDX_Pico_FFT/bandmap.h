@@ -0,0 +1,46 @@
+#ifndef __BANDMAP_H__
+#define __BANDMAP_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * bandmap.h
+ *
+ * Created: Oct 2026
+ *
+ * See bandmap.cpp for more information
+ */
+
+
+#define BM_NSIG				32		// signal index (bit mask per frame)
+#define BM_EDGE_BINS		10		// bins left out at the span edges (filter roll-off)
+#define BM_DC_BINS			1		// bins around the LO left out (DC offset)
+#define BM_SNR				8		// detect level = floor * BM_SNR/4 (6dB) + BM_MIN
+#define BM_MIN				3
+#define BM_MERGE_BINS		6		// peaks closer than this (3kHz) are one signal
+#define BM_MATCH_HZ			750		// a peak this close to an entry is the same signal
+#define BM_EXPIRE_MS		10000	// entry dropped when not seen for this time
+#define BM_DUTY_STEADY		128		// duty above this: steady carrier marker
+
+typedef struct
+{
+	uint32_t freq;					// Hz, interpolated between the bins
+	int16_t  bin;					// FFT column in the current span, -1 = outside
+	uint8_t  level;					// FFT magnitude, averaged over the frames seen
+	uint8_t  duty;					// fraction of the frames seen, 255 = every frame
+	uint32_t first;					// millis() first/last seen
+	uint32_t last;
+} bm_sig_t;
+
+extern bm_sig_t bm_sig[BM_NSIG];
+extern uint8_t  bm_nsig;
+
+void bm_fft_line(const uint8_t *line, uint32_t freq);	// FFT line and its LO, from display_tft_loop()
+int  bm_next(bool up);									// tune to the next signal above/below, -1 = none
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,212 @@
+/*
+ * bandscan.cpp
+ *
+ * Created: Oct 2026
+ *
+ * Band scan with the waterfall FFT: the 320 bins cover 160kHz around the LO (hmi_freq_lo),
+ * so hmi_freq is stepped by BS_STEP (150kHz, the edges with the filter roll-off are not used).
+ * Per step:
+ *  - hmi_freq is set with the LO recentered on it (no DDC offset), hmi_evaluate()/si_evaluate()
+ *    retune, the FFT lines of the next BS_SETTLE_MS are dropped (a line must be collected
+ *    after the settle time)
+ *  - BS_NAVG lines are averaged
+ *  - the noise floor is the median of the used bins (histogram, the values are 8 bit)
+ *  - every local maximum above the detect level goes into the signal table (frequency order),
+ *    peaks within BS_MERGE_BINS are one signal (SSB, AM sidebands)
+ * While scanning, display_tft_loop() hands the FFT lines to bs_fft_line() instead of drawing
+ * them, so a step takes about BS_SETTLE_MS + BS_NAVG FFT frames.
+ * After the scan the frequency is set back, bs_next() tunes to the found signals.
+ */
+
+#include "Arduino.h"
+#include "uSDR.h"
+#include "hmi.h"
+#include "dsp.h"
+#include "TFT_eSPI.h"
+#include "display_tft.h"
+#include "bandscan.h"
+
+
+#define BS_CENTER			(FFT_NUMFREQ)			// column of the LO: col = hmi_freq_lo + (col - BS_CENTER) * FRES
+
+bs_sig_t bs_sig[BS_NSIG];
+uint8_t  bs_nsig = 0;
+bool     bs_scanning = false;
+uint16_t bs_steps;
+uint32_t bs_ms;
+
+static uint32_t bs_from, bs_to;
+static uint32_t bs_f;								// hmi_freq of the step
+static uint32_t bs_lo;								// LO of the step (RIT)
+static uint32_t bs_save_freq;
+static uint32_t bs_settle;							// millis() from when lines are valid
+static uint32_t bs_release;							// millis() when the collection of the next line started
+static uint32_t bs_t0;
+static uint8_t  bs_navg;
+static uint16_t bs_acc[2*BS_HALF_BINS+1];
+
+
+static void bs_tune(uint32_t f)
+{
+	bs_f = f;
+	hmi_freq = f;									// hmi_evaluate() sets the Si5351
+	hmi_lo_recenter = true;
+	bs_settle = millis() + BS_SETTLE_MS;
+	bs_navg = 0;
+	memset(bs_acc, 0, sizeof(bs_acc));
+	dsp_mute(BS_SETTLE_MS + 100);
+	bs_steps++;
+}
+
+void bs_start(uint32_t from, uint32_t to)
+{
+	if (to <= from) return;
+	bs_from = from;
+	bs_to = to;
+	bs_nsig = 0;
+	bs_steps = 0;
+	bs_save_freq = hmi_freq;
+	bs_t0 = millis();
+	bs_release = 0;
+	bs_scanning = true;
+	bs_tune(from + BS_HALF_BINS*FRES);
+}
+
+void bs_stop(void)
+{
+	if (!bs_scanning) return;
+	bs_scanning = false;
+	bs_ms = millis() - bs_t0;
+	hmi_freq = bs_save_freq;
+}
+
+
+/*
+ * Signal table in frequency order; when full the weakest signal makes room for a stronger one
+ */
+static void bs_add(uint32_t f, uint8_t level, uint8_t nf)
+{
+	uint8_t i, weak = 0;
+
+	if (bs_nsig == BS_NSIG)
+	{
+		for (i=1; i<bs_nsig; i++)
+			if (bs_sig[i].level < bs_sig[weak].level) weak = i;
+		if (bs_sig[weak].level >= level) return;
+		memmove(&bs_sig[weak], &bs_sig[weak+1], (bs_nsig-weak-1)*sizeof(bs_sig_t));
+		bs_nsig--;
+	}
+	for (i=bs_nsig; (i>0) && (bs_sig[i-1].freq > f); i--)
+		bs_sig[i] = bs_sig[i-1];
+	bs_sig[i].freq = f;
+	bs_sig[i].level = level;
+	bs_sig[i].noise = nf;
+	bs_sig[i].time = millis();
+	bs_nsig++;
+}
+
+/*
+ * Noise floor and peaks of the averaged step
+ */
+static void bs_detect(void)
+{
+	static uint16_t hist[256];
+	uint8_t v[2*BS_HALF_BINS+1];
+	uint16_t i, n = 0, half;
+	uint16_t nf, level;
+	int16_t last = -BS_MERGE_BINS-1;				// bin of the last signal of this step
+	uint32_t f, f_lo;
+
+	memset(hist, 0, sizeof(hist));
+	f_lo = bs_lo - BS_HALF_BINS*FRES;
+	for (i=0; i<=2*BS_HALF_BINS; i++)
+	{
+		v[i] = bs_acc[i] / BS_NAVG;
+		f = f_lo + i*FRES;
+		if ((f < bs_from) || (f > bs_to) || (abs((int16_t)i - BS_HALF_BINS) <= BS_DC_BINS)) continue;
+		hist[v[i]]++;
+		n++;
+	}
+	if (n == 0) return;
+	for (nf=0, half=0; nf<255; nf++)				// median
+	{
+		half += hist[nf];
+		if (2*half >= n) break;
+	}
+	level = ((nf * BS_SNR) >> 2) + BS_MIN;
+
+	for (i=1; i<2*BS_HALF_BINS; i++)
+	{
+		f = f_lo + i*FRES;
+		if ((f < bs_from) || (f > bs_to) || (abs((int16_t)i - BS_HALF_BINS) <= BS_DC_BINS)) continue;
+		if ((v[i] < level) || (v[i] < v[i-1]) || (v[i] <= v[i+1])) continue;
+		if (((int16_t)i - last) <= BS_MERGE_BINS)	// same signal: keep the strongest peak
+		{
+			if ((bs_nsig > 0) && (v[i] > bs_sig[bs_nsig-1].level) && (bs_sig[bs_nsig-1].freq == f_lo + last*FRES))
+			{
+				bs_sig[bs_nsig-1].freq = f;
+				bs_sig[bs_nsig-1].level = v[i];
+				last = i;
+			}
+			continue;
+		}
+		bs_add(f, v[i], nf);
+		last = i;
+	}
+}
+
+
+/*
+ * One FFT line (GRAPH_NUM_COLS), called from the main loop when core1 has a new one
+ */
+void bs_fft_line(const uint8_t *line)
+{
+	bool valid = ((int32_t)(bs_release - bs_settle) >= 0);
+	uint16_t i;
+
+	bs_release = millis();							// the next line is collected from now on
+	if (!bs_scanning) return;
+	if (hmi_freq != bs_f)							// tuned by the operator
+	{
+		bs_scanning = false;
+		bs_ms = millis() - bs_t0;
+		return;
+	}
+	if (!valid) return;
+	if (bs_navg == 0) bs_lo = hmi_freq_lo;
+
+	for (i=0; i<=2*BS_HALF_BINS; i++)
+		bs_acc[i] += line[BS_CENTER - BS_HALF_BINS + i];
+	if (++bs_navg < BS_NAVG) return;
+
+	bs_detect();
+	if (bs_f + BS_STEP - BS_HALF_BINS*FRES >= bs_to)
+		bs_stop();
+	else
+		bs_tune(bs_f + BS_STEP);
+}
+
+
+/*
+ * Tune to the next signal above/below the current frequency
+ */
+int bs_next(bool up)
+{
+	int i;
+
+	if (bs_nsig == 0) return -1;
+	if (up)
+	{
+		for (i=0; i<bs_nsig; i++)
+			if (bs_sig[i].freq > hmi_freq) break;
+		if (i == bs_nsig) i = 0;
+	}
+	else
+	{
+		for (i=bs_nsig-1; i>=0; i--)
+			if (bs_sig[i].freq < hmi_freq) break;
+		if (i < 0) i = bs_nsig-1;
+	}
+	hmi_freq = bs_sig[i].freq;
+	return i;
+}
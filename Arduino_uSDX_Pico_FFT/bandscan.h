@@ -0,0 +1,49 @@
+#ifndef __BANDSCAN_H__
+#define __BANDSCAN_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * bandscan.h
+ *
+ * Created: Oct 2026
+ *
+ * See bandscan.cpp for more information
+ */
+
+
+#define BS_NSIG				64		// detected signal table
+#define BS_HALF_BINS		150		// used bins each side of the LO: 150 * FRES = 75kHz
+#define BS_DC_BINS			1		// bins around the LO left out (DC offset)
+#define BS_STEP				(2*BS_HALF_BINS*FRES)	// 150kHz per step
+#define BS_SETTLE_MS		50		// after the retune: hmi/si tasks, PLL, relays
+#define BS_NAVG				4		// FFT lines averaged per step
+#define BS_SNR				8		// detect level = floor * BS_SNR/4 (6dB) + BS_MIN
+#define BS_MIN				3
+#define BS_MERGE_BINS		6		// peaks closer than this (3kHz) are one signal
+
+typedef struct
+{
+	uint32_t freq;					// Hz
+	uint8_t  level;					// averaged FFT magnitude at the peak
+	uint8_t  noise;					// noise floor of the step
+	uint32_t time;					// millis() when found
+} bs_sig_t;
+
+extern bs_sig_t bs_sig[BS_NSIG];
+extern uint8_t  bs_nsig;
+extern bool     bs_scanning;
+extern uint16_t bs_steps;			// steps of the last scan
+extern uint32_t bs_ms;				// duration of the last scan
+
+void bs_start(uint32_t from, uint32_t to);
+void bs_stop(void);
+void bs_fft_line(const uint8_t *line);			// from display_tft_loop() while scanning
+int  bs_next(bool up);							// next signal above/below hmi_freq, -1 = none
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -15,6 +15,9 @@
 #include "TFT_eSPI.h"
 #include "display_tft.h"
 #include "hmi.h"
+#include "bandscan.h"
+#include "bandmap.h"
+#include "skimmer.h"
 
 
 // Use hardware SPI
@@ -322,50 +325,58 @@ int16_t triang_x_min, triang_x_max;
 void display_fft_graf_top(void) 
 {
   int16_t siz, j, x;  //i, y
+  int16_t xc;  //column of the RX frequency (LO + DDC offset)
   uint32_t freq_graf_ini;
   uint32_t freq_graf_fim;
 
 
 
-    //graph min freq
-    freq_graf_ini = (hmi_freq - ((FFT_NSAMP/2)*FRES) )/1000;
+    //graph min freq  (the waterfall is centered on the LO)
+    freq_graf_ini = (hmi_freq_lo - ((FFT_NSAMP/2)*FRES) )/1000;
   
     //graph max freq
-    freq_graf_fim = (hmi_freq + ((FFT_NSAMP/2)*FRES) )/1000;
+    freq_graf_fim = (hmi_freq_lo + ((FFT_NSAMP/2)*FRES) )/1000;
+
+    xc = (display_WIDTH/2) + (int16_t)(hmi_ddc_offset / (int32_t)FRES);
+
+    //erase the old triangle, it moves with the DDC offset
+    tft.fillRect(0, Y_MIN_DRAW - TRIANG_TOP, display_WIDTH, TRIANG_TOP - ABOVE_SCALE + 1, TFT_BACKGROUND);
 
    
     //little triangle indicating the center freq
     switch(dsp_getmode())  //{"USB","LSB","AM","CW"}
     {
       case 0:  //USB
-        triang_x_min = (display_WIDTH/2);
-        triang_x_max = (display_WIDTH/2)+TRIANG_WIDTH;
-        tft.fillTriangle(display_WIDTH/2, Y_MIN_DRAW - ABOVE_SCALE, display_WIDTH/2, Y_MIN_DRAW - TRIANG_TOP, (display_WIDTH/2)+TRIANG_WIDTH, Y_MIN_DRAW - ABOVE_SCALE, TFT_YELLOW);
-        tft.fillTriangle((display_WIDTH/2)-1, Y_MIN_DRAW - ABOVE_SCALE, display_WIDTH/2, Y_MIN_DRAW - TRIANG_TOP, (display_WIDTH/2)-TRIANG_WIDTH, Y_MIN_DRAW - ABOVE_SCALE, TFT_BACKGROUND);
+        triang_x_min = xc;
+        triang_x_max = xc+TRIANG_WIDTH;
+        tft.fillTriangle(xc, Y_MIN_DRAW - ABOVE_SCALE, xc, Y_MIN_DRAW - TRIANG_TOP, xc+TRIANG_WIDTH, Y_MIN_DRAW - ABOVE_SCALE, TFT_YELLOW);
+        tft.fillTriangle(xc-1, Y_MIN_DRAW - ABOVE_SCALE, xc, Y_MIN_DRAW - TRIANG_TOP, xc-TRIANG_WIDTH, Y_MIN_DRAW - ABOVE_SCALE, TFT_BACKGROUND);
         break;
       case 1:  //LSB
-        triang_x_min = (display_WIDTH/2)-TRIANG_WIDTH;
-        triang_x_max = (display_WIDTH/2);
-        tft.fillTriangle(display_WIDTH/2, Y_MIN_DRAW - ABOVE_SCALE, 
-                         display_WIDTH/2, Y_MIN_DRAW - TRIANG_TOP, (display_WIDTH/2)-TRIANG_WIDTH, Y_MIN_DRAW - ABOVE_SCALE, 
+        triang_x_min = xc-TRIANG_WIDTH;
+        triang_x_max = xc;
+        tft.fillTriangle(xc, Y_MIN_DRAW - ABOVE_SCALE, 
+                         xc, Y_MIN_DRAW - TRIANG_TOP, xc-TRIANG_WIDTH, Y_MIN_DRAW - ABOVE_SCALE, 
                          TFT_YELLOW);
-        tft.fillTriangle((display_WIDTH/2)+1, Y_MIN_DRAW - ABOVE_SCALE, 
-                          display_WIDTH/2, Y_MIN_DRAW - TRIANG_TOP, (display_WIDTH/2)+TRIANG_WIDTH, Y_MIN_DRAW - ABOVE_SCALE, 
+        tft.fillTriangle(xc+1, Y_MIN_DRAW - ABOVE_SCALE, 
+                          xc, Y_MIN_DRAW - TRIANG_TOP, xc+TRIANG_WIDTH, Y_MIN_DRAW - ABOVE_SCALE, 
                           TFT_BACKGROUND);
         break;
       case 2:  //AM
-        triang_x_min = (display_WIDTH/2)-TRIANG_WIDTH;
-        triang_x_max = (display_WIDTH/2)+TRIANG_WIDTH;
-        tft.fillTriangle((display_WIDTH/2)-TRIANG_WIDTH, Y_MIN_DRAW - ABOVE_SCALE, display_WIDTH/2, Y_MIN_DRAW - TRIANG_TOP, (display_WIDTH/2)+TRIANG_WIDTH, Y_MIN_DRAW - ABOVE_SCALE, TFT_YELLOW);
+      case 5:  //SAM
+      case 6:  //FM
+        triang_x_min = xc-TRIANG_WIDTH;
+        triang_x_max = xc+TRIANG_WIDTH;
+        tft.fillTriangle(xc-TRIANG_WIDTH, Y_MIN_DRAW - ABOVE_SCALE, xc, Y_MIN_DRAW - TRIANG_TOP, xc+TRIANG_WIDTH, Y_MIN_DRAW - ABOVE_SCALE, TFT_YELLOW);
         break;
       case 3:  //CW = LSB
-        triang_x_min = (display_WIDTH/2)-(TRIANG_WIDTH*2/4);
-        triang_x_max = (display_WIDTH/2);   //-(TRIANG_WIDTH*1/4);
-        tft.fillTriangle(display_WIDTH/2, Y_MIN_DRAW - ABOVE_SCALE, 
-                         display_WIDTH/2, Y_MIN_DRAW - TRIANG_TOP, (display_WIDTH/2)-TRIANG_WIDTH, Y_MIN_DRAW - ABOVE_SCALE, 
+        triang_x_min = xc-(TRIANG_WIDTH*2/4);
+        triang_x_max = xc;   //-(TRIANG_WIDTH*1/4);
+        tft.fillTriangle(xc, Y_MIN_DRAW - ABOVE_SCALE, 
+                         xc, Y_MIN_DRAW - TRIANG_TOP, xc-TRIANG_WIDTH, Y_MIN_DRAW - ABOVE_SCALE, 
                          TFT_YELLOW);
-        tft.fillTriangle((display_WIDTH/2)+1, Y_MIN_DRAW - ABOVE_SCALE, 
-                          display_WIDTH/2, Y_MIN_DRAW - TRIANG_TOP, (display_WIDTH/2)+TRIANG_WIDTH, Y_MIN_DRAW - ABOVE_SCALE, 
+        tft.fillTriangle(xc+1, Y_MIN_DRAW - ABOVE_SCALE, 
+                          xc, Y_MIN_DRAW - TRIANG_TOP, xc+TRIANG_WIDTH, Y_MIN_DRAW - ABOVE_SCALE, 
                           TFT_BACKGROUND);
         break;
     }
@@ -496,6 +507,19 @@ void initColorLUTFire() {
 
 
 
+#ifdef USE_TOUCH_SCREEN
+bool lutoption = false;   // false = Jet palette, true = Fire palette
+
+/*********************************************************
+  toggle the waterfall palette (touch on the scale)
+*********************************************************/
+void display_fft_palette_toggle(void)
+{
+  lutoption = !lutoption;
+}
+#endif
+
+
 //**** draws the waterfall, is time critical, now pushes an entire line instead of drawing pixels 
 
 void display_fft_graf(uint16_t freq) {
@@ -503,6 +527,11 @@ void display_fft_graf(uint16_t freq) {
   int16_t freq_change = (int16_t)freq - (int16_t)freq_old;
 
   uint16_t extra_color = 0xc658;
+#ifdef USE_TOUCH_SCREEN
+  const uint16_t *lut = lutoption ? colorLUTFire : colorLUTJet;
+#else
+  const uint16_t *lut = colorLUTJet; // only Jet palette available
+#endif
 
   // Plot waterfall
   for (int y = 0; y < GRAPH_NUM_LINES; y ++) {
@@ -516,19 +545,7 @@ for (int x = 0; x < GRAPH_NUM_COLS; x++) {
 
 
   uint16_t re;
-#ifdef USE_TOUCH_SCREEN
-  static bool lutoption = false;
-
-  if (tox > 150 && tox < 170 && toy > 175 && toy < 185) { // toggle to alternative palette
-    lutoption = !lutoption;
-    tox = toy = 0;
-    touch_delay = 5; // block for a while to avoid toggeling
-  }
-
-  re = lutoption ? swapBytes(colorLUTFire[val]) : swapBytes(colorLUTJet[val]);  //need to swap byte order for tft.pushImage
-#else
-  re = swapBytes(colorLUTJet[val]); // only Jet palette available
-#endif
+  re = swapBytes(lut[val]);  //need to swap byte order for tft.pushImage
 
 
   if (val) {
@@ -572,108 +589,353 @@ static inline uint16_t swapBytes(uint16_t c) {
 }
 
 
+/*********************************************************
+  band map markers, 2 lines just above the waterfall
+  steady carriers white, intermittent signals orange, CW skimmer channels cyan
+*********************************************************/
+#define MARKER_LINES    2
+#define MARKER_HALF     1    //marker is 3 pixels wide
 
+void display_fft_markers(void)
+{
+  static uint16_t markBuf[MARKER_LINES][GRAPH_NUM_COLS];
+  uint16_t shadow = swapBytes(tft.color565(25, 25, 25));
+  uint16_t color;
+  int16_t x, i;
 
+  for (x = 0; x < GRAPH_NUM_COLS; x++) {
+    markBuf[0][x] = (x >= triang_x_min && x <= triang_x_max) ? shadow : TFT_BACKGROUND;
+  }
+  for (i = 0; i < bm_nsig; i++) {
+    if (bm_sig[i].bin < 0) continue;
+    color = swapBytes((bm_sig[i].duty > BM_DUTY_STEADY) ? TFT_WHITE : TFT_ORANGE);
+    for (x = bm_sig[i].bin - MARKER_HALF; x <= bm_sig[i].bin + MARKER_HALF; x++) {
+      if (x >= 0 && x < GRAPH_NUM_COLS)
+        markBuf[0][x] = color;
+    }
+  }
+  for (i = 0; sk_on && i < SK_NCH; i++) {
+    if (sk_ch[i].freq == 0) continue;
+    x = FFT_NUMFREQ + (int32_t)(sk_ch[i].freq - hmi_freq_lo) / (int32_t)FRES;
+    for (int16_t c = x - MARKER_HALF; c <= x + MARKER_HALF; c++) {
+      if (c >= 0 && c < GRAPH_NUM_COLS)
+        markBuf[0][c] = swapBytes(TFT_CYAN);
+    }
+  }
+  memcpy(markBuf[1], markBuf[0], sizeof(markBuf[0]));
 
-void display_aud_graf_var(uint16_t aud_pos, uint16_t aud_var, uint16_t color)
-{  
-  int16_t x;
-  int16_t aud; 
+  tft.pushImage(0, Y_MIN_DRAW + 1 - MARKER_LINES, GRAPH_NUM_COLS, MARKER_LINES, markBuf[0]);
+}
 
 
-if (aud_var > 1 && aud_var != sel_graph && sel_graph < 6)// 6 means all graphs together
-  return;
-else if (sel_graph > 1 && aud_var < 2)
-   return;
 
 
 
+// scope graphic is redrawn incrementally: only the pixels drawn on last frame are erased (grid restored)
+#define AUD_GRAPH_NUM_ROWS   (AUD_GRAPH_MAX - AUD_GRAPH_MIN + 3)
+#define AUD_GRAPH_GRID       5       //grid dot spacing
+#define AUD_Y_NONE           0xffu   //nothing drawn on this column
+#define AUD_VEC_X0           50      //vectorscope center column
 
+const uint8_t aud_graf_order[AUD_NUM_VAR] = { AUD_SAMP_I, AUD_SAMP_Q, AUD_SAMP_A, AUD_SAMP_MIC, AUD_SAMP_PEAK, AUD_SAMP_GAIN };  //drawing order
+const uint16_t aud_graf_color[AUD_NUM_VAR] = { TFT_RED, TFT_GREEN, TFT_PINK, TFT_CYAN, TFT_YELLOW, TFT_MAGENTA };     //same order
+uint8_t aud_graf_y[AUD_NUM_VAR][AUD_GRAPH_NUM_COLS];    //y (from Y_MIN_AUD_GRAPH) drawn on last frame, in drawing order
+uint16_t aud_graf_vec[AUD_GRAPH_NUM_COLS];              //vectorscope points drawn on last frame  (x<<8)|y
+uint8_t aud_graf_sel_old = 0xff;                        //sel_graph of last frame
 
-  for(x=0; x<AUD_GRAPH_NUM_COLS; x++)
+
+/*********************************************************
+  scope pixel restore = background or grid dot
+*********************************************************/
+void display_aud_graf_erase(int16_t x, int16_t y)
+{
+  tft.drawPixel(X_MIN_AUD_GRAPH + x, Y_MIN_AUD_GRAPH + y,
+                (((x % AUD_GRAPH_GRID) == 0) && ((y % AUD_GRAPH_GRID) == 0)) ? TFT_DARKGREY : TFT_NAVY);
+}
+
+
+/*********************************************************
+  scope variable shown with actual sel_graph
+  0 = vectorscope (I x Q),  1 = I and Q,  2-5 = one variable,  6 = all except I and Q
+*********************************************************/
+bool display_aud_graf_visible(uint16_t aud_var)
+{
+  if (aud_var > 1 && aud_var != sel_graph && sel_graph < 6)// 6 means all graphs together
+    return false;
+  else if (sel_graph > 1 && aud_var < 2)
+    return false;
+  return (sel_graph != 0);
+}
+
+
+/*********************************************************
+  scope y position for a sample (clipped to the graphic)
+*********************************************************/
+uint8_t display_aud_graf_y(int16_t aud)
+{
+  if(aud < AUD_GRAPH_MIN)  //check boundaries
   {
-    aud = (aud_samp[aud_var][x+aud_pos]);
-    
-    if(aud < AUD_GRAPH_MIN)  //check boundaries
+    aud = AUD_GRAPH_MIN;    //lower line
+  }
+  else if(aud > AUD_GRAPH_MAX)  //check boundaries
+  {
+    aud = AUD_GRAPH_MAX;    //upper line
+  }
+  return (uint8_t)(AUD_GRAPH_MAX - aud);
+}
+
+
+/*********************************************************
+  vectorscope: erase the old points not used anymore, draw only the new ones
+*********************************************************/
+void display_aud_graf_vec(uint16_t aud_pos)
+{
+  uint16_t vec_new[AUD_GRAPH_NUM_COLS];
+  int16_t i, j, vi, vq;
+
+  for(i=0; i<AUD_GRAPH_NUM_COLS; i++)
+  {
+    vi = AUD_SAMP(AUD_SAMP_I, i+aud_pos);
+    vq = AUD_SAMP(AUD_SAMP_Q, i+aud_pos);
+    if ((vi < 26 && vi > -26) && (vq < 26 && vq > -26))
+      vec_new[i] = ((uint16_t)(AUD_VEC_X0 + vi) << 8) | (uint16_t)(AUD_GRAPH_MAX + vq);
+    else
+      vec_new[i] = 0xffff;
+  }
+
+  for(i=0; i<AUD_GRAPH_NUM_COLS; i++)
+  {
+    if(aud_graf_vec[i] == 0xffff) continue;
+    for(j=0; j<AUD_GRAPH_NUM_COLS; j++)
     {
-      tft.drawPixel((x + X_MIN_AUD_GRAPH), (Y_MIN_AUD_GRAPH + AUD_GRAPH_MAX - AUD_GRAPH_MIN), color);    //lower line    
+      if(vec_new[j] == aud_graf_vec[i]) break;
     }
-    else if(aud > AUD_GRAPH_MAX)  //check boundaries
+    if(j == AUD_GRAPH_NUM_COLS)   //not used anymore
     {
-      tft.drawPixel((x + X_MIN_AUD_GRAPH), (Y_MIN_AUD_GRAPH + AUD_GRAPH_MAX - AUD_GRAPH_MAX), color);    //upper line 
+      display_aud_graf_erase(aud_graf_vec[i] >> 8, aud_graf_vec[i] & 0xff);
     }
-    else
+  }
+
+  for(i=0; i<AUD_GRAPH_NUM_COLS; i++)
+  {
+    if(vec_new[i] == 0xffff) continue;
+    for(j=0; j<AUD_GRAPH_NUM_COLS; j++)
     {
-    
-    if (sel_graph) 
-       tft.drawPixel((x + X_MIN_AUD_GRAPH), (Y_MIN_AUD_GRAPH + AUD_GRAPH_MAX - aud), color);        
-    else // vectorscope
-      if (( aud_samp[0][x] < 26 && aud_samp[0][x] > -26) && (aud_samp[1][x] < 26 && aud_samp[1][x] > -26))
-       tft.drawPixel( X_MIN_AUD_GRAPH + 50 + (int32_t) aud_samp[0][x]  , (Y_MIN_AUD_GRAPH + AUD_GRAPH_MAX +  aud_samp[1][x]), TFT_WHITE);     
+      if(aud_graf_vec[j] == vec_new[i]) break;
+    }
+    if(j == AUD_GRAPH_NUM_COLS)   //not on display yet
+    {
+      tft.drawPixel(X_MIN_AUD_GRAPH + (vec_new[i] >> 8), Y_MIN_AUD_GRAPH + (vec_new[i] & 0xff), TFT_WHITE);
     }
   }
-  
-}
 
+  memcpy(aud_graf_vec, vec_new, sizeof(aud_graf_vec));
+}
 
 
-void display_aud_graf(void)
+/*********************************************************
+  traces: for each column, erase the old pixels not covered by a new one
+  and draw the new pixels where the color changes (last trace drawn is on top)
+*********************************************************/
+void display_aud_graf_traces(uint16_t aud_pos)
 {
-uint16_t aud_pos;
-int16_t x;
-int16_t aud_samp_trigger;
-  
-  //erase graphic area
-  //tft.fillRect(0, Y_MIN_DRAW - 10, display_WIDTH, 10, TFT_BACKGROUND);
-  tft.fillRect(X_MIN_AUD_GRAPH, Y_MIN_AUD_GRAPH, AUD_GRAPH_NUM_COLS, (AUD_GRAPH_MAX - AUD_GRAPH_MIN + 3), TFT_NAVY);
+  uint8_t y_new[AUD_NUM_VAR];
+  int16_t x, t, t2, top, top_old;
+
+  for(x=0; x<AUD_GRAPH_NUM_COLS; x++)
+  {
+    for(t=0; t<AUD_NUM_VAR; t++)
+    {
+      y_new[t] = display_aud_graf_visible(aud_graf_order[t]) ? display_aud_graf_y(AUD_SAMP(aud_graf_order[t], x+aud_pos)) : AUD_Y_NONE;
+    }
+
+    //erase
+    for(t=0; t<AUD_NUM_VAR; t++)
+    {
+      if(aud_graf_y[t][x] == AUD_Y_NONE) continue;
+      for(t2=0; t2<AUD_NUM_VAR; t2++)
+      {
+        if(y_new[t2] == aud_graf_y[t][x]) break;
+      }
+      if(t2 == AUD_NUM_VAR)
+      {
+        display_aud_graf_erase(x, aud_graf_y[t][x]);
+      }
+    }
+
+    //draw
+    for(t=0; t<AUD_NUM_VAR; t++)
+    {
+      if(y_new[t] == AUD_Y_NONE) continue;
+      top = -1;
+      top_old = -1;
+      for(t2=0; t2<AUD_NUM_VAR; t2++)
+      {
+        if(y_new[t2] == y_new[t]) top = t2;              //trace on top at this pixel now
+        if(aud_graf_y[t2][x] == y_new[t]) top_old = t2;  //trace on top at this pixel on last frame
+      }
+      if((top == t) && ((top_old < 0) || (aud_graf_color[top_old] != aud_graf_color[t])))
+      {
+        tft.drawPixel(X_MIN_AUD_GRAPH + x, Y_MIN_AUD_GRAPH + y_new[t], aud_graf_color[t]);
+      }
+    }
 
-for (int y = Y_MIN_AUD_GRAPH; y < Y_MIN_AUD_GRAPH + (AUD_GRAPH_MAX - AUD_GRAPH_MIN + 3); y += 5) {
-  for (int x = X_MIN_AUD_GRAPH; x < X_MIN_AUD_GRAPH + AUD_GRAPH_NUM_COLS; x += 5) {
-    tft.drawPixel(x, y, TFT_DARKGREY);  // Added grid
+    for(t=0; t<AUD_NUM_VAR; t++)
+    {
+      aud_graf_y[t][x] = y_new[t];
+    }
   }
 }
 
 
 
+void display_aud_graf(void)
+{
+int16_t aud_pos;
 
- // if(tx_enabled)
+  if(sk_on)   //the CW skimmer list is shown on the scope area
   {
- //   aud_samp_trigger = AUD_SAMP_MIC;  
+    return;
   }
-//  else
+
+  //new capture ready? (buffer swap and trigger search)
+  aud_pos = dsp_scope_frame();
+  if(aud_pos < 0)
   {
-    aud_samp_trigger = AUD_SAMP_I;
+    return;
   }
+  
+  if(aud_graf_sel_old != sel_graph)   //selection changed: redraw all
+  {
+    //erase graphic area
+    tft.fillRect(X_MIN_AUD_GRAPH, Y_MIN_AUD_GRAPH, AUD_GRAPH_NUM_COLS, AUD_GRAPH_NUM_ROWS, TFT_NAVY);
 
-  //find trigger point to start ploting
-  for(x=0; x<AUD_GRAPH_NUM_COLS; x++)
+    for (int y = 0; y < AUD_GRAPH_NUM_ROWS; y += AUD_GRAPH_GRID) {
+      for (int x = 0; x < AUD_GRAPH_NUM_COLS; x += AUD_GRAPH_GRID) {
+        tft.drawPixel(X_MIN_AUD_GRAPH + x, Y_MIN_AUD_GRAPH + y, TFT_DARKGREY);  // Added grid
+      }
+    }
+
+    memset(aud_graf_y, AUD_Y_NONE, sizeof(aud_graf_y));
+    memset(aud_graf_vec, 0xff, sizeof(aud_graf_vec));
+    aud_graf_sel_old = sel_graph;
+  }
+
+  //plot the variables
+  if(sel_graph == 0)
   {
-     if((aud_samp[aud_samp_trigger][x+0] > 0) &&
-        (aud_samp[aud_samp_trigger][x+1] > 0) &&
-        (aud_samp[aud_samp_trigger][x+2] > 0) &&
-        (aud_samp[aud_samp_trigger][x+3] > 0) &&
-        (aud_samp[aud_samp_trigger][x+4] > 0))
-        {
-          break;
-        }
+    display_aud_graf_vec(aud_pos);
   }
-  for(; x<AUD_GRAPH_NUM_COLS; x++)
+  else
   {
-     if(aud_samp[aud_samp_trigger][x] < 0)
-        {
-          break;
-        }
+    display_aud_graf_traces(aud_pos);
   }
-  aud_pos = x;
 
-  //plot each variable
-  display_aud_graf_var(aud_pos, AUD_SAMP_I, TFT_RED);
-  display_aud_graf_var(aud_pos, AUD_SAMP_Q, TFT_GREEN);
-  display_aud_graf_var(aud_pos, AUD_SAMP_A, TFT_PINK);
-  display_aud_graf_var(aud_pos, AUD_SAMP_MIC, TFT_CYAN);
-  display_aud_graf_var(aud_pos, AUD_SAMP_PEAK, TFT_YELLOW);
-  display_aud_graf_var(aud_pos, AUD_SAMP_GAIN, TFT_MAGENTA);
+}
+
+
+/*********************************************************
+  scope legend, above the scope area
+*********************************************************/
+#define AUD_LABEL_X   230
+#define AUD_LABEL_Y   95
 
+void display_aud_graf_label(void)
+{
+  tft.setFreeFont(NULL);
+  tft.setTextSize(1);
+  tft.setCursor(AUD_LABEL_X, AUD_LABEL_Y);
+
+  tft.setTextColor(TFT_RED, TFT_BACKGROUND);
+  tft.print("I");
+  tft.setTextColor(TFT_LIGHTGREY, TFT_BACKGROUND);
+  tft.print("+");
+  tft.setTextColor(TFT_GREEN, TFT_BACKGROUND);
+  tft.print("Q ");
+
+  tft.setTextColor(TFT_CYAN, TFT_BACKGROUND);
+  tft.print("MC ");
+
+  tft.setTextColor(TFT_PINK, TFT_BACKGROUND);
+  tft.print("A ");
+
+  tft.setTextColor(TFT_YELLOW, TFT_BACKGROUND);
+  tft.print("PK ");
+
+  tft.setTextColor(TFT_MAGENTA, TFT_BACKGROUND);
+  tft.print("GN"); 
+}
+
+
+/*********************************************************
+  CW skimmer list, on the scope area while the skimmer is on
+  one row per channel: kHz (last 2 digits) and callsign (yellow) or the last text
+*********************************************************/
+#define SK_LIST_X     X_MIN_AUD_GRAPH
+#define SK_LIST_Y     (AUD_LABEL_Y + 10)
+#define SK_LIST_DY    8                                                     //default font, size 1
+#define SK_LIST_COLS  ((display_WIDTH - X_MIN_AUD_GRAPH) / 6)              //15 characters
+#define SK_LIST_TEXT  (SK_LIST_COLS - 5)
+
+void display_sk_list(void)
+{
+  static bool shown = false;
+  char s[SK_LIST_COLS + 1];
+  sk_ch_t *ch;
+  uint16_t i, n, len, w;
+
+  if (!sk_on) {
+    if (shown) {                      //back to the scope: legend and full redraw
+      tft.fillRect(SK_LIST_X, AUD_LABEL_Y, display_WIDTH - SK_LIST_X, SK_LIST_Y - AUD_LABEL_Y + SK_NCH * SK_LIST_DY, TFT_BACKGROUND);
+      display_aud_graf_label();
+      aud_graf_sel_old = 0xff;
+      shown = false;
+    }
+    return;
+  }
+  if (!shown) {
+    tft.fillRect(SK_LIST_X, AUD_LABEL_Y, display_WIDTH - SK_LIST_X, SK_LIST_Y - AUD_LABEL_Y + SK_NCH * SK_LIST_DY, TFT_BACKGROUND);
+    tft.setFreeFont(NULL);
+    tft.setTextSize(1);
+    tft.setTextColor(TFT_CYAN, TFT_BACKGROUND);
+    tft.setCursor(AUD_LABEL_X, AUD_LABEL_Y);
+    tft.print("CW skimmer");
+    shown = true;
+    sk_changed = true;
+  }
+  if (!sk_changed) return;
+  sk_changed = false;
+
+  tft.setFreeFont(NULL);
+  tft.setTextSize(1);
+  for (n = 0; n < SK_NCH; n++) {
+    ch = &sk_ch[n];
+    memset(s, ' ', SK_LIST_COLS);
+    s[SK_LIST_COLS] = 0;
+    tft.setCursor(SK_LIST_X, SK_LIST_Y + n * SK_LIST_DY);
+    if (ch->freq == 0) {
+      tft.print(s);
+      continue;
+    }
+    sprintf(s, "%02lu.%lu ", (unsigned long)((ch->freq / 1000) % 100), (unsigned long)((ch->freq % 1000) / 100));
+    tft.setTextColor(TFT_WHITE, TFT_BACKGROUND);
+    tft.print(s);
+    if (ch->call[0] != 0) {
+      tft.setTextColor(TFT_YELLOW, TFT_BACKGROUND);
+      len = strlen(ch->call);
+      tft.print(ch->call);
+    } else {
+      len = 0;
+    }
+    //last characters of the text fill the rest of the row
+    tft.setTextColor(TFT_LIGHTGREY, TFT_BACKGROUND);
+    w = SK_LIST_TEXT - len - ((len > 0) ? 1 : 0);
+    for (i = 0; i < w; i++)
+      s[i] = ch->text[SK_TEXT_LEN - w + i];
+    s[w] = 0;
+    if (len > 0) tft.print(" ");
+    tft.print(s);
+  }
 }
 
 
@@ -733,8 +995,6 @@ void display_intro(void) {
 *********************************************************/
 void display_static_elements(void) {
 
-uint16_t xPos = 230, yPos = 95;
-
 tft.fillScreen(TFT_BACKGROUND);
 
 
@@ -753,31 +1013,7 @@ tft.setCursor(165, 152);
 tft.print("-VAL+");
 #endif
 
-  tft.setFreeFont(NULL);
-
-  tft.setTextSize(1);
-
-  
-tft.setCursor(xPos, yPos);
-
-tft.setTextColor(TFT_RED, TFT_BACKGROUND);
-tft.print("I");
-tft.setTextColor(TFT_LIGHTGREY, TFT_BACKGROUND);
-tft.print("+");
-tft.setTextColor(TFT_GREEN, TFT_BACKGROUND);
-tft.print("Q ");
-
-tft.setTextColor(TFT_CYAN, TFT_BACKGROUND);
-tft.print("MC ");
-
-tft.setTextColor(TFT_PINK, TFT_BACKGROUND);
-tft.print("A ");
-
-tft.setTextColor(TFT_YELLOW, TFT_BACKGROUND);
-tft.print("PK ");
-
-tft.setTextColor(TFT_MAGENTA, TFT_BACKGROUND);
-tft.print("GN"); 
+display_aud_graf_label();
 
 
 tft.setCursor (245, 45); // display frequency KHz label
@@ -823,6 +1059,15 @@ void display_tft_countdown(bool show, uint16_t val)
 }
 
 
+/*********************************************************
+  display task is ready to run: new FFT line for the waterfall (only during RX)
+*********************************************************/
+bool display_tft_ready(void)
+{
+  return ((tx_enabled == false) && (fft_display_graf_new == 1));
+}
+
+
 void display_tft_loop(void) 
 {
   static uint32_t hmi_freq_fft;
@@ -831,16 +1076,30 @@ void display_tft_loop(void)
   {
     if (fft_display_graf_new == 1)    //design a new graphic only when a new line is ready from FFT
     {
-      if(hmi_freq == hmi_freq_fft)
+      if(bs_scanning)  //band scan: the line goes to the scanner, not to the display
       {
-        //plot waterfall graphic     
-        display_fft_graf((uint16_t)(hmi_freq/500));  // warefall 110ms
+        bs_fft_line(vet_graf_fft[GRAPH_NUM_LINES - 1]);
       }
       else
       {
-        //plot waterfall graphic     
-        display_fft_graf((uint16_t)(hmi_freq_fft/500));  // warefall 110ms
-        hmi_freq_fft = hmi_freq;
+        //band map, before display_fft_graf() shifts the line out
+        bm_fft_line(vet_graf_fft[GRAPH_NUM_LINES - 1], hmi_freq_fft);
+        sk_fft_line();  //CW skimmer channels follow the band map
+
+        if(hmi_freq_lo == hmi_freq_fft)  //waterfall moves only with the LO, not with the DDC offset
+        {
+          //plot waterfall graphic     
+          display_fft_graf((uint16_t)(hmi_freq_lo/500));  // warefall 110ms
+        }
+        else
+        {
+          //plot waterfall graphic     
+          display_fft_graf((uint16_t)(hmi_freq_fft/500));  // warefall 110ms
+          hmi_freq_fft = hmi_freq_lo;
+        }
+
+        display_fft_markers();
+        display_sk_list();
       }
 
       fft_display_graf_new = 0;  
@@ -849,3 +1108,76 @@ void display_tft_loop(void)
   }
 
 }
+
+
+
+/*********************************************************
+  Screen snapshot to the serial port (monitor "ss")
+  Each display line is read back from the TFT (MISO) and sent RLE compressed:
+    frame start:  SNAP_SYNC 'F' width(2) height(2)
+    line:         SNAP_SYNC 'L' y(2) len(2) payload(len) checksum(2)
+                  payload = runs of count(1) color(2)   (RGB565, count 1..255)
+    frame end:    SNAP_SYNC 'E' lines(2) 
+  all 16 bit values are big endian, checksum = 16 bit sum of the payload bytes
+  only one line is handled at a time, the interrupts (audio) are not blocked
+*********************************************************/
+#define SNAP_SYNC       0xA5
+#define SNAP_RUN_MAX    255
+
+void display_tft_snapshot_put16(uint8_t *p, uint16_t v)
+{
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+void display_tft_snapshot(void)
+{
+  static uint16_t line_pix[display_WIDTH];
+  static uint8_t line_rec[6 + (3 * display_WIDTH) + 2];   //header + worst case payload + checksum
+  uint16_t x, y, len, sum, i;
+  uint16_t color;
+  uint8_t run;
+
+  line_rec[0] = SNAP_SYNC;
+  line_rec[1] = 'F';
+  display_tft_snapshot_put16(&line_rec[2], display_WIDTH);
+  display_tft_snapshot_put16(&line_rec[4], display_HEIGHT);
+  Serialx.write(line_rec, 6);
+
+  for(y = 0; y < display_HEIGHT; y++)
+  {
+    tft.readRect(0, y, display_WIDTH, 1, line_pix);
+
+    len = 6;
+    x = 0;
+    while(x < display_WIDTH)
+    {
+      color = line_pix[x];
+      run = 1;
+      while(((x + run) < display_WIDTH) && (line_pix[x + run] == color) && (run < SNAP_RUN_MAX))
+      {
+        run++;
+      }
+      line_rec[len++] = run;
+      display_tft_snapshot_put16(&line_rec[len], swapBytes(color));   //readRect gives the pushImage byte order
+      len += 2;
+      x += run;
+    }
+
+    sum = 0;
+    for(i = 6; i < len; i++)
+    {
+      sum += line_rec[i];
+    }
+    line_rec[1] = 'L';
+    display_tft_snapshot_put16(&line_rec[2], y);
+    display_tft_snapshot_put16(&line_rec[4], len - 6);
+    display_tft_snapshot_put16(&line_rec[len], sum);
+    Serialx.write(line_rec, len + 2);
+  }
+
+  line_rec[1] = 'E';
+  display_tft_snapshot_put16(&line_rec[2], display_HEIGHT);
+  Serialx.write(line_rec, 4);
+  Serialx.flush();
+}
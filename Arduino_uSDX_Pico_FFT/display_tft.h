@@ -139,11 +139,19 @@ void TxPower_bargraph(int16_t index_new);
 
 void display_fft_graf(uint16_t freq);
 void display_fft_graf_top(void);
+void display_fft_palette_toggle(void);
+#ifdef USE_TOUCH_SCREEN
+extern bool lutoption;
+#endif
 void display_intro(void);
 void display_static_elements(void);
 void display_tft_countdown(bool show, uint16_t val);
+bool display_tft_ready(void);
 void display_tft_loop(void);
 void display_aud_graf(void);
+void display_aud_graf_label(void);
+void display_sk_list(void);
+void display_tft_snapshot(void);
 
 
 
@@ -40,11 +40,13 @@
 #include "hardware/structs/bus_ctrl.h"
 #include "uSDR.h"
 #include "dsp.h"
+#include "si5351.h"
 #include "kiss_fftr.h"
 #include "TFT_eSPI.h"
 #include "display_tft.h"
 #include "pico/multicore.h"
 #include "CwDecoder.h"
+#include "skimmer.h"
 
 #if TX_METHOD == PHASE_AMPLITUDE    // uSDX TX method used for Class E RF amplifier
 #include "uSDX_I2C.h"
@@ -80,6 +82,7 @@ volatile uint16_t dac_iq, dac_audio;
 bool rx(void);
 void tx(void);
 bool vox(void);
+void rx2_block(volatile int16_t *samp);
 
 
 
@@ -323,6 +326,45 @@ static int16_t am_lpf2_taps[AM_LPF2_TAP_NUM] = {
 
 
 
+/*
+FIR filter for FM (channel filter before the discriminator)
+windowed sinc (Blackman), fc = 6000 Hz
+
+sampling frequency: 16000 Hz
+
+fixed point precision: 16 bits, same DC gain as the AM filter
+
+* 0 Hz - 4000 Hz
+  gain = 1
+  actual ripple = 0.2 dB
+
+* -3 dB at 5400 Hz (NBFM, +-2.5kHz deviation and 3kHz audio)
+
+* 8000 Hz
+  actual attenuation = -26 dB
+
+*/
+
+#define FM_LPF_TAP_NUM 13
+
+static int16_t fm_lpf_taps[FM_LPF_TAP_NUM] = {
+  27,
+  -107,
+  0,
+  904,
+  -2980,
+  5434,
+  19672,
+  5434,
+  -2980,
+  904,
+  0,
+  -107,
+  27
+};
+
+
+
 // Obs.:  LPF time critical, use max 25 filter taps
 // Obs.:  The input signal ADC should be previous filthered to < half sampling frequency
 
@@ -398,6 +440,10 @@ uint16_t dsp_mode;				// For values see hmi.c, assume {USB,LSB,AM,CW}
 void dsp_setmode(int mode)  //MODE_USB=0 MODE_LSB=1  MODE_AM=2  MODE_CW=3
 {
 	dsp_mode = (uint16_t)mode;
+  if(dsp_mode == MODE_SAM)
+    sam_reset();
+  if(dsp_mode == MODE_FM)
+    fm_reset();
 
   //mode filter selection
   //MODE_USB=0 MODE_LSB=1  MODE_AM=2  MODE_CW=3
@@ -406,7 +452,7 @@ void dsp_setmode(int mode)  //MODE_USB=0 MODE_LSB=1  MODE_AM=2  MODE_CW=3
     mode_filter_tap_num = SSB_LPF_TAP_NUM;      // band pass filter for SSB
     mode_filter_taps = ssb_lpf_taps;
   }
-  else if(dsp_mode == MODE_AM)  //AM
+  else if((dsp_mode == MODE_AM) || (dsp_mode == MODE_SAM))  //AM
   {
     mode_filter_tap_num = AM_LPF_TAP_NUM;      // band pass filter for AM
     mode_filter_taps = am_lpf_taps;
@@ -417,6 +463,12 @@ void dsp_setmode(int mode)  //MODE_USB=0 MODE_LSB=1  MODE_AM=2  MODE_CW=3
     mode_filter_tap_num = AM_LPF2_TAP_NUM;      //band pass filter for AM (stronger low freq attenuation)
     mode_filter_taps = am_lpf2_taps;
   }
+
+  else if(dsp_mode == MODE_FM)  //FM
+  {
+    mode_filter_tap_num = FM_LPF_TAP_NUM;      // channel filter for NBFM
+    mode_filter_taps = fm_lpf_taps;
+  }
   
 
   else  //CW
@@ -432,6 +484,33 @@ int dsp_getmode(void)
 }
 
 
+/**************************************************************************************
+ * Audio mute, used while the VFO is re-programmed (PLL reset)
+ * The count is in 16kHz samples, decremented on rx()
+ **************************************************************************************/
+volatile uint16_t dsp_mute_count = 0;
+void dsp_mute(uint16_t ms)
+{
+  dsp_mute_count = ms * (FSAMP_AUDIO / 1000u);
+}
+
+
+/**************************************************************************************
+ * DDC = digital down converter: the I/Q samples (160kHz) are mixed with an NCO before the
+ * 16kHz low pass, so the RX frequency can be LO + offset without moving the Si5351
+ * Phase accumulator 32 bits, sine table with DDC_LUT_BITS of the phase, Q15
+ * offset > 0 = RX above the LO (same I/Q convention as the USB demodulator)
+ **************************************************************************************/
+int16_t ddc_sin[DDC_LUT_SIZE];
+volatile uint32_t ddc_phase_step = 0;       //0 = DDC off
+uint32_t ddc_phase = 0;
+void dsp_setddc(int32_t offset)
+{
+  //the NCO turns the other way: RX freq is shifted down to 0Hz
+  ddc_phase_step = (uint32_t)(((int64_t)offset * 4294967296LL) / (int64_t)DDC_FSAMP);
+}
+
+
 /**************************************************************************************
  * VOX LINGER is the number of 16us cycles to wait before releasing TX mode
  * The level of detection is related to the maximum ADC range.
@@ -481,8 +560,7 @@ void dsp_setvox(int vox)
 //fft_samp[] is a buffer for the FFT samples 
 //the samples for FFT are taken from time to time when FFT to waterfall graphic is ready with last samples
 //there are some extra previous samples for FFT/Hilbert/Graph because to calculate the first result, it needs some previous samples
-#define BLOCK_NSAMP    (FSAMP/FSAMP_AUDIO)    //block = 480k / 16k = 30 samples
-#define BLOCK_NSET     (BLOCK_NSAMP/3)        //block = 10 sets of 3 samples
+//BLOCK_NSAMP, BLOCK_NSET: see dsp.h
 #define NBLOCK       ((FFT_NSAMP+(BLOCK_NSET-1)) / BLOCK_NSET)  // number of blocks necessary for FFT  320 / 30 = 10.666  =11
 #if LOW_PASS_16KHZ == LOW_PASS_16KHZ
 #define ADC_NUM_BLOCK  (2u)  //save last 2 blocks
@@ -513,9 +591,18 @@ volatile uint16_t fft_samp_block_pos = 0;
 volatile uint16_t fft_samples_ready = 0;  //all buffer filled
 volatile uint16_t fft_display_graf_new = 0;   //new data for graphic ready
 
-volatile int16_t aud_samp[AUD_NUM_VAR][AUD_NUM_SAMP];  //samples buffer for audio process, filter and demodulation
-volatile uint16_t aud_samp_block_pos = 0;   
-volatile uint16_t aud_samples_state = AUD_STATE_SAMP_IN;  //filling buffer
+volatile int16_t aud_samp[2][AUD_NUM_SAMP][AUD_NUM_VAR];  //scope capture buffers, one written by the ISR, the other read by the display
+volatile int16_t *aud_samp_wr = &aud_samp[0][0][0];  //sample set being written by the ISR
+volatile uint32_t aud_samp_pos = 0;   //write position, 24.8 fixed point
+volatile uint16_t aud_samp_step = (1u<<AUD_POS_SHIFT);   //position increment per sample = 256 / decimation
+volatile uint16_t aud_samp_wbuf = 0;  //buffer owned by the ISR
+uint16_t aud_samp_rd = 1;             //buffer owned by the display
+uint32_t aud_samp_swap_pos = 0;       //write position at last buffer swap
+uint8_t  aud_trig_var = AUD_SAMP_I;
+int16_t  aud_trig_level = 0;
+uint8_t  aud_trig_slope = AUD_TRIG_FALL;
+uint16_t aud_pretrig = 0;
+uint16_t aud_decim = 1;
 
 volatile uint16_t i_int, j_int;
 volatile uint16_t cw_int_count=0;  //used to count 2 times the 16kHz int to generate the 8kHz for CW (only for CW reception)
@@ -629,6 +716,86 @@ void __not_in_flash_func(dma_handler)(void)
 
 
 
+  //collect FFT raw samples  (before the DDC: the waterfall stays centered on the LO)
+  if(fft_samples_ready == 0)  //receiving the samples
+  {
+/*
+    if(hmi_freq != hmi_freq_fft)   //freq must be the same for all fft samples - if freq changing, wait
+    {
+      fft_samp_block_pos = 0;
+      hmi_freq_fft = hmi_freq;
+    }
+*/
+    //copy new samples to FFT buffer  (raw adc sample values for FFT)
+    for(i_int=0; i_int<BLOCK_NSAMP; )
+    {  
+      fft_samp[fft_samp_block_pos][i_int] = adc_samp[adc_samp_last_block_pos][i_int];
+      i_int++;
+      fft_samp[fft_samp_block_pos][i_int] =  adc_samp[adc_samp_last_block_pos][i_int];
+      i_int++;
+      //fft_samp[fft_samp_block_pos][i_int] =  adc_samp[adc_samp_last_block_pos][i_int];   // MIC is not necessary, but lets save it too
+      i_int++;
+    }
+    
+    fft_samp_block_pos++;
+    if(fft_samp_block_pos >= FFT_NUM_BLOCK)
+    {
+      fft_samples_ready = 1;
+    }
+  }
+  else if(fft_samples_ready == 1)  //waiting FFT 
+  {
+       //just wait
+  }
+  else // fft_samples_ready == 2  ready with graphic
+  {
+    //start filling FFT samples buffer over again
+    fft_samp_block_pos = 0;
+    fft_samples_ready = 0;
+  }
+
+
+
+  //second receiver, from the samples before the main DDC
+  if((rx2_on == true) && (tx_enabled == false))
+  {
+    rx2_block(&adc_samp[adc_samp_last_block_pos][0]);
+  }
+
+  //CW skimmer channels, also from the samples before the main DDC
+  if((sk_on == true) && (tx_enabled == false))
+  {
+    sk_block(&adc_samp[adc_samp_last_block_pos][0]);
+  }
+
+
+
+  //DDC: mix the I/Q samples with the NCO, in place, the 16kHz low pass below uses the mixed blocks
+  //(I + jQ) * (cos - j sin)
+  if((ddc_phase_step != 0) && (tx_enabled == false))
+  {
+#if LOW_PASS_16KHZ == LOW_PASS_16KHZ_AVERAGE_SUM
+    adc_samp_sum[adc_samp_last_block_pos][0] = 0;
+    adc_samp_sum[adc_samp_last_block_pos][1] = 0;
+#endif
+    for(i_int=0; i_int<BLOCK_NSAMP; i_int+=3)
+    {
+      int32_t ddc_i = adc_samp[adc_samp_last_block_pos][i_int];
+      int32_t ddc_q = adc_samp[adc_samp_last_block_pos][i_int+1];
+      uint32_t k = ddc_phase >> (32u - DDC_LUT_BITS);
+      int32_t s = ddc_sin[k];
+      int32_t c = ddc_sin[(k + (DDC_LUT_SIZE/4u)) & DDC_LUT_MASK];
+
+      adc_samp[adc_samp_last_block_pos][i_int]   = (int16_t)((ddc_i * c + ddc_q * s) >> 15);
+      adc_samp[adc_samp_last_block_pos][i_int+1] = (int16_t)((ddc_q * c - ddc_i * s) >> 15);
+#if LOW_PASS_16KHZ == LOW_PASS_16KHZ_AVERAGE_SUM
+      adc_samp_sum[adc_samp_last_block_pos][0] += adc_samp[adc_samp_last_block_pos][i_int];
+      adc_samp_sum[adc_samp_last_block_pos][1] += adc_samp[adc_samp_last_block_pos][i_int+1];
+#endif
+      ddc_phase += ddc_phase_step;
+    }
+  }
+
 
 
 #if LOW_PASS_16KHZ == LOW_PASS_16KHZ_FIR
@@ -824,45 +991,6 @@ The sampling is at 160kHz but for audio we only need 16kHz samples, so the filte
 
 
 
-  //collect FFT raw samples
-  if(fft_samples_ready == 0)  //receiving the samples
-  {
-/*
-    if(hmi_freq != hmi_freq_fft)   //freq must be the same for all fft samples - if freq changing, wait
-    {
-      fft_samp_block_pos = 0;
-      hmi_freq_fft = hmi_freq;
-    }
-*/
-    //copy new samples to FFT buffer  (raw adc sample values for FFT)
-    for(i_int=0; i_int<BLOCK_NSAMP; )
-    {  
-      fft_samp[fft_samp_block_pos][i_int] = adc_samp[adc_samp_last_block_pos][i_int];
-      i_int++;
-      fft_samp[fft_samp_block_pos][i_int] =  adc_samp[adc_samp_last_block_pos][i_int];
-      i_int++;
-      //fft_samp[fft_samp_block_pos][i_int] =  adc_samp[adc_samp_last_block_pos][i_int];   // MIC is not necessary, but lets save it too
-      i_int++;
-    }
-    
-    fft_samp_block_pos++;
-    if(fft_samp_block_pos >= FFT_NUM_BLOCK)
-    {
-      fft_samples_ready = 1;
-    }
-  }
-  else if(fft_samples_ready == 1)  //waiting FFT 
-  {
-       //just wait
-  }
-  else // fft_samples_ready == 2  ready with graphic
-  {
-    //start filling FFT samples buffer over again
-    fft_samp_block_pos = 0;
-    fft_samples_ready = 0;
-  }
-
-
   //prepare next block position
 #if LOW_PASS_16KHZ == LOW_PASS_16KHZ_FIR  
   adc_samp_last_block_pos3 = adc_samp_last_block_pos2;  //16kHz LP FIR use one more block
@@ -887,6 +1015,7 @@ The sampling is at 160kHz but for audio we only need 16kHz samples, so the filte
 
 
   static bool ptt_internal_active_old = false;
+  static bool tx_enabled_old = false;
 
 /************************************************************************************** 
  * CORE0:  FIFO IRQ
@@ -922,6 +1051,11 @@ void core0_irq_handler()
     ptt_vox_active = vox();     // Compress + store sample audio + check level    if (VOX enable and audio)  vox = true
     ptt_internal_active = ptt_vox_active || ptt_mon_active || ptt_aud_active;
     tx_enabled = ptt_external_active || ptt_internal_active;     //tx_enabled is used at next DMA int
+    if (tx_enabled != tx_enabled_old)  // PTT edge: Si5351 to the TX or RX image (only queues the I2C write)
+    {
+      si_txrx(tx_enabled ? SI_IMG_TX : SI_IMG_RX);
+      tx_enabled_old = tx_enabled;
+    }
 
     if ((ptt_internal_active == true) && (ptt_internal_active_old == false))      // TX enabled internally
     {
@@ -949,6 +1083,10 @@ void core0_irq_handler()
     }
 
     ptt_internal_active_old = ptt_internal_active;
+
+    //next scope sample set (step = 0 keeps overwriting the same set while the scope is hidden)
+    aud_samp_pos += aud_samp_step;
+    aud_samp_wr = &aud_samp[aud_samp_wbuf][(aud_samp_pos >> AUD_POS_SHIFT) & AUD_SAMP_MASK][0];
   }
 
          
@@ -959,6 +1097,83 @@ void core0_irq_handler()
 
 
 
+/************************************************************************************** 
+ * CORE0: main loop
+ * dsp_scope_set - scope trigger (source, level, slope), pre-trigger depth and decimation
+ * decim = 0 hides the scope: the ISR keeps overwriting the same sample set
+ **************************************************************************************/
+void dsp_scope_set(uint8_t var, int16_t level, uint8_t slope, uint16_t pretrig, uint16_t decim)
+{
+  aud_trig_var = (var < AUD_NUM_VAR) ? var : AUD_SAMP_I;
+  aud_trig_level = level;
+  aud_trig_slope = slope;
+  aud_pretrig = (pretrig < AUD_GRAPH_NUM_COLS) ? pretrig : (AUD_GRAPH_NUM_COLS - 1u);
+  aud_decim = (decim > (1u<<AUD_POS_SHIFT)) ? (1u<<AUD_POS_SHIFT) : decim;
+  aud_samp_step = (aud_decim == 0) ? 0 : ((1u<<AUD_POS_SHIFT) / aud_decim);
+}
+
+
+/************************************************************************************** 
+ * CORE0: main loop
+ * dsp_scope_frame - when the ISR has filled its buffer, swap the buffers and look for
+ * the trigger on the buffer now owned by the display
+ * returns the position of the first sample to plot (pre-trigger included), or -1 if no new frame
+ * without trigger (auto mode) it returns the most recent samples
+ **************************************************************************************/
+int16_t dsp_scope_frame(void)
+{
+  uint32_t ints;
+  uint16_t oldest, t, t_max;
+  int16_t aud;
+  bool armed = false;
+
+  if((uint32_t)(aud_samp_pos - aud_samp_swap_pos) < ((uint32_t)AUD_NUM_SAMP << AUD_POS_SHIFT))
+  {
+    return -1;   //capture still running (or scope hidden)
+  }
+
+  //swap buffers, the ISR must not store on the old buffer after this point
+  ints = save_and_disable_interrupts();
+  aud_samp_rd = aud_samp_wbuf;
+  aud_samp_wbuf ^= 1u;
+  aud_samp_swap_pos = aud_samp_pos;
+  aud_samp_wr = &aud_samp[aud_samp_wbuf][(aud_samp_pos >> AUD_POS_SHIFT) & AUD_SAMP_MASK][0];
+  restore_interrupts(ints);
+
+  //the set at the write position was not complete, the oldest valid one is the next
+  oldest = (uint16_t)((aud_samp_swap_pos >> AUD_POS_SHIFT) + 1u);
+
+  //trigger must leave room for the pre-trigger and for the rest of the graphic
+  t_max = (AUD_NUM_SAMP - 1u) - (AUD_GRAPH_NUM_COLS - aud_pretrig);
+  for(t = 0; t <= t_max; t++)
+  {
+    aud = AUD_SAMP(aud_trig_var, oldest + t);
+    if(aud_trig_slope == AUD_TRIG_RISE)
+    {
+      if(aud < (aud_trig_level - AUD_TRIG_HYST))
+        armed = true;
+      else if(armed && (aud >= aud_trig_level) && (t >= aud_pretrig))
+        break;
+    }
+    else
+    {
+      if(aud > (aud_trig_level + AUD_TRIG_HYST))
+        armed = true;
+      else if(armed && (aud <= aud_trig_level) && (t >= aud_pretrig))
+        break;
+    }
+  }
+  if(t > t_max)   //no trigger = auto, show the last samples
+  {
+    t = t_max;
+  }
+
+  return (int16_t)((oldest + t - aud_pretrig) & AUD_SAMP_MASK);
+}
+
+
+
+
 #define HILBERT_TAP_NUM  15u  //Hilbert filter 15 taps  fixed value   it uses values from 0 to 14
 
 //  int16_t out_sample_;
@@ -982,10 +1197,226 @@ volatile int16_t smeter_display_time;
 
 
 
+/**************************************************************************************
+ * SAM = synchronous AM detector, in rx() on the filtered I/Q (16kHz, AM filter)
+ * A PLL locks an NCO (ddc_sin table) on the carrier:
+ *  - I/Q rotated by the NCO phase: the carrier goes to DC on I, Q = carrier * phase error
+ *  - phase error = Q / carrier level (the inverse of the averaged level, updated every SAM_NORM_N samples)
+ *  - PI loop filter, ~20Hz natural frequency (2x while not locked, to pull in)
+ *  - lock when the averaged I is well above the averaged |Q|
+ * The audio is I (DSB) or I -+ Hilbert(Q) (one sideband, against selective fading), less the carrier.
+ * The NCO frequency is the carrier offset of the station.
+ **************************************************************************************/
+#define SAM_ERR_Q        12        // phase error Q12 (1 rad = 4096), +-1 rad max
+#define SAM_KP           1850      // NCO phase per error unit: 2*0.7*wn*T in 2^32/2pi
+#define SAM_KI           10        // NCO frequency per error unit: (wn*T)^2 in 2^32/2pi
+#define SAM_FMAX         ((int32_t)(300LL * 4294967296LL / FSAMP_AUDIO))   // +-300Hz
+#define SAM_AVG_SHIFT    10u       // carrier level and lock averages (64ms)
+#define SAM_NORM_N       64u
+#define SAM_NORM_Q       4u
+#define SAM_LVL_MIN      8         // weaker carrier: no tracking
+#define SAM_LOCK_RATIO   4         // lock: I >= 4x |Q|
+
+volatile uint8_t sam_sb = SAM_DSB;
+volatile bool    sam_lock = false;
+volatile int32_t sam_freq = 0;           // NCO step (2^32 = FSAMP_AUDIO)
+uint32_t sam_phase = 0;
+int32_t  sam_car_acc, sam_i_acc, sam_q_acc;   // averages << SAM_AVG_SHIFT
+int32_t  sam_norm = 0;                   // (1 << (SAM_ERR_Q + SAM_NORM_Q)) / carrier level
+uint16_t sam_norm_cnt = 0;
+int16_t  sam_i_s[HILBERT_TAP_NUM], sam_q_s[HILBERT_TAP_NUM];
+
+void sam_reset(void)
+{
+  sam_freq = 0;
+  sam_phase = 0;
+  sam_car_acc = sam_i_acc = sam_q_acc = 0;
+  sam_norm = 0;
+  sam_lock = false;
+}
+
+int16_t sam_offset(void)
+{
+  return (int16_t)(((int64_t)sam_freq * FSAMP_AUDIO) >> 32);
+}
+
+static inline int16_t sam_demod(int16_t i, int16_t q)
+{
+  int32_t s, c, yi, yq, err, car, q_accu;
+  uint32_t k;
+  uint16_t n;
+
+  // rotate by the NCO: carrier to DC
+  k = sam_phase >> (32u - DDC_LUT_BITS);
+  s = ddc_sin[k];
+  c = ddc_sin[(k + (DDC_LUT_SIZE/4u)) & DDC_LUT_MASK];
+  yi = (i * c + q * s) >> 15;
+  yq = (q * c - i * s) >> 15;
+
+  sam_car_acc += MAG(yi, yq) - (sam_car_acc >> SAM_AVG_SHIFT);
+  sam_i_acc += yi - (sam_i_acc >> SAM_AVG_SHIFT);
+  sam_q_acc += ABS(yq) - (sam_q_acc >> SAM_AVG_SHIFT);
+  if(++sam_norm_cnt >= SAM_NORM_N)
+  {
+    sam_norm_cnt = 0;
+    car = sam_car_acc >> SAM_AVG_SHIFT;
+    sam_norm = (car >= SAM_LVL_MIN) ? (1L << (SAM_ERR_Q + SAM_NORM_Q)) / car : 0;
+    sam_lock = (sam_norm != 0) && ((sam_i_acc >> SAM_AVG_SHIFT) >= SAM_LOCK_RATIO * (sam_q_acc >> SAM_AVG_SHIFT));
+  }
+
+  // phase error and loop filter
+  err = (yq * sam_norm) >> SAM_NORM_Q;
+  if(err > (1L << SAM_ERR_Q)) err = (1L << SAM_ERR_Q);
+  if(err < -(1L << SAM_ERR_Q)) err = -(1L << SAM_ERR_Q);
+  if(sam_lock)
+  {
+    sam_freq += err * SAM_KI;
+    sam_phase += sam_freq + err * SAM_KP;
+  }
+  else
+  {
+    sam_freq += err * (4 * SAM_KI);
+    sam_phase += sam_freq + err * (2 * SAM_KP);
+  }
+  if(sam_freq > SAM_FMAX) sam_freq = SAM_FMAX;
+  if(sam_freq < -SAM_FMAX) sam_freq = -SAM_FMAX;
+
+  // audio: carrier level out
+  yi -= sam_i_acc >> SAM_AVG_SHIFT;
+  if(sam_sb == SAM_DSB)
+    return (int16_t)yi;
+
+  for (n=0; n<(HILBERT_TAP_NUM-1u); n++)
+  {
+    sam_i_s[n] = sam_i_s[n+1];
+    sam_q_s[n] = sam_q_s[n+1];
+  }
+  sam_i_s[HILBERT_TAP_NUM-1u] = (int16_t)yi;
+  sam_q_s[HILBERT_TAP_NUM-1u] = (int16_t)yq;
+  q_accu = (sam_q_s[0]-sam_q_s[14])*315L + (sam_q_s[2]-sam_q_s[12])*440L + (sam_q_s[4]-sam_q_s[10])*734L + (sam_q_s[6]-sam_q_s[ 8])*2202L;
+  q_accu >>= 12;
+  return (int16_t)((sam_sb == SAM_USB) ? (sam_i_s[7] - q_accu) : (sam_i_s[7] + q_accu));
+}
+
+
+/**************************************************************************************
+ * Phase of an I/Q sample, 65536 = 2pi (so the phase differences wrap as int16)
+ * atan(z) of the smaller/larger component, z in Q15, from a table of FM_ATAN_SIZE segments
+ * with linear interpolation; the octant gives the rest.
+ * One hardware divide, one multiply and two table reads, no float.
+ * Error and time against arctan3(), other tables and atan2f(): Aux/fm_atan_bench.cpp (host)
+ **************************************************************************************/
+uint16_t fm_atan[FM_ATAN_SIZE+2];       // atan(k/FM_ATAN_SIZE), filled in dsp_init(); +1: z = 1.0 (|i| == |q|) reads k+1
+
+int16_t rectangular_2_phase(int16_t i, int16_t q)
+{
+  int32_t ai = ABS((int32_t)i), aq = ABS((int32_t)q), a;
+  uint32_t z, k, f;
+
+  if(aq <= ai)
+  {
+    if(ai == 0) return 0;
+    z = ((uint32_t)aq << 15) / (uint32_t)ai;
+  }
+  else
+    z = ((uint32_t)ai << 15) / (uint32_t)aq;
+  k = z >> (15u - FM_ATAN_BITS);
+  f = z & ((1u << (15u - FM_ATAN_BITS)) - 1u);
+  a = fm_atan[k] + ((((int32_t)fm_atan[k+1] - fm_atan[k]) * (int32_t)f) >> (15u - FM_ATAN_BITS));
+  if(aq > ai) a = 16384 - a;            // atan(z) = 90 - atan(1/z)
+  if(i < 0) a = 32768 - a;
+  return (int16_t)((q < 0) ? -a : a);
+}
+
+
+/**************************************************************************************
+ * FM = NBFM demodulator, in rx() on the filtered I/Q (16kHz, FM filter)
+ *  - polar discriminator: angle(x[n] * conj(x[n-1])) = phase[n] - phase[n-1], taken as int16
+ *    (one rectangular_2_phase() per sample, no products with the squared signal range)
+ *  - the average of the discriminator is the carrier offset, it is taken out of the audio
+ *  - de-emphasis 750us, 1st order (6dB/octave above 212Hz)
+ *  - noise squelch: the noise above the voice band (4th difference of the discriminator,
+ *    +20dB at 7kHz against 3kHz) is averaged and compared with the level of fm_sql, with hysteresis
+ **************************************************************************************/
+#define FM_DC_SHIFT       12u       // carrier offset average (256ms)
+#define FM_DEEMPH         2620      // Q15: 1 - exp(-1/(16000 * 750us))
+#define FM_AUDIO_SHIFT    2u        // discriminator to audio (2.5kHz deviation = 10240)
+#define FM_NOISE_SHIFT    8u        // squelch noise average (16ms)
+
+// noise average at which the squelch opens, for fm_sql 1..FM_SQL_MAX (0 = always open)
+static const uint16_t fm_sql_level[FM_SQL_MAX] = { 16000, 13000, 10500, 8000, 6500, 5000, 3800, 2700, 1900 };
+
+volatile uint8_t fm_sql = 3;
+volatile bool    fm_open = false;
+int16_t  fm_phase_old = 0;
+int16_t  fm_d[4];                       // last discriminator outputs
+int32_t  fm_dc_acc = 0;                 // average << FM_DC_SHIFT
+int32_t  fm_noise_acc = 0;              // average << FM_NOISE_SHIFT
+int32_t  fm_deemph = 0;
+
+void fm_reset(void)
+{
+  fm_phase_old = 0;
+  fm_d[0] = fm_d[1] = fm_d[2] = fm_d[3] = 0;
+  fm_dc_acc = 0;
+  fm_noise_acc = (int32_t)fm_sql_level[0] << FM_NOISE_SHIFT;   // starts closed
+  fm_deemph = 0;
+  fm_open = false;
+}
+
+int16_t fm_offset(void)
+{
+  return (int16_t)(((fm_dc_acc >> FM_DC_SHIFT) * (int32_t)FSAMP_AUDIO) >> 16);
+}
+
+uint16_t fm_noise(void)
+{
+  return (uint16_t)(fm_noise_acc >> FM_NOISE_SHIFT);
+}
+
+static inline int16_t fm_demod(int16_t i, int16_t q)
+{
+  int16_t phase, d;
+  int32_t noise, h;
+  uint8_t sql = fm_sql;
+
+  // discriminator
+  phase = rectangular_2_phase(i, q);
+  d = (int16_t)(phase - fm_phase_old);
+  fm_phase_old = phase;
+
+  // squelch: noise above the voice
+  h = ((int32_t)d - 4 * ((int32_t)fm_d[0] + fm_d[2]) + 6 * (int32_t)fm_d[1] + fm_d[3]) >> 2;
+  fm_d[3] = fm_d[2];
+  fm_d[2] = fm_d[1];
+  fm_d[1] = fm_d[0];
+  fm_d[0] = d;
+  fm_noise_acc += ABS(h) - (fm_noise_acc >> FM_NOISE_SHIFT);
+  noise = fm_noise_acc >> FM_NOISE_SHIFT;
+  if((sql == 0) || (sql > FM_SQL_MAX))
+    fm_open = true;
+  else if(noise < fm_sql_level[sql-1])
+    fm_open = true;
+  else if(noise > fm_sql_level[sql-1] + (fm_sql_level[sql-1] >> 2))
+    fm_open = false;
+
+  // carrier offset out, de-emphasis
+  fm_dc_acc += d - (fm_dc_acc >> FM_DC_SHIFT);
+  h = (int32_t)d - (fm_dc_acc >> FM_DC_SHIFT);
+  fm_deemph += ((h - fm_deemph) * FM_DEEMPH) >> 15;
+
+  return fm_open ? (int16_t)(fm_deemph >> FM_AUDIO_SHIFT) : 0;
+}
+
+
+int32_t cw_gz_s1[2], cw_gz_s2[2];    // CW Goertzel filters, staggered
+uint8_t cw_gz_k = 0;                  // the one that ends next
+
 bool rx(void) 
 {
   int16_t out_sample;
 	int32_t q_accu, i_accu;
+	int32_t gz_s0, gz_re, gz_im;
 	int16_t qh;
 	uint16_t i;
 	uint16_t k;
@@ -1036,19 +1467,9 @@ bool rx(void)
 
 
 
-if(aud_samples_state == AUD_STATE_SAMP_IN)    //store variables for scope graphic
-  {
-    //aud_samp[AUD_SAMP_I][aud_samp_block_pos] = i_accu ;
-     
-    //aud_samp[AUD_SAMP_Q][aud_samp_block_pos] =  q_accu; 
-  
-    aud_samp[AUD_SAMP_I][aud_samp_block_pos] =  (i_accu * fft_gain / agc_a_sample)>>6;  // adjust to signal strength and fft gain
-     
-    aud_samp[AUD_SAMP_Q][aud_samp_block_pos] =  (q_accu * fft_gain / agc_a_sample)>>6;
-  
-  
-  
-  }
+  //store variables for scope graphic
+  AUD_SAMP_STORE(AUD_SAMP_I, (i_accu * fft_gain / agc_a_sample)>>6);  // adjust to signal strength and fft gain
+  AUD_SAMP_STORE(AUD_SAMP_Q, (q_accu * fft_gain / agc_a_sample)>>6);
 
 
 	/*** DEMODULATION ***/
@@ -1098,6 +1519,15 @@ a_sample = absi > absq ? absi + absq / 4 : absq + absi / 4;
     break;
   
   
+  case MODE_SAM:                    // synchronous AM
+    a_sample = sam_demod(i_s[7], q_s[7]);
+    break;
+
+  case MODE_FM:                     // NBFM
+    a_sample = fm_demod(i_s[(HILBERT_TAP_NUM-1u)], q_s[(HILBERT_TAP_NUM-1u)]);  // no Hilbert, the last sample
+    break;
+
+
   case MODE_CW:                     // CW
     /*
      * Rx CW = LSB
@@ -1152,25 +1582,34 @@ a_sample = absi > absq ? absi + absq / 4 : absq + absi / 4;
 
 
 
-  // CwDecoder - save the audio level to analize on hmi.cpp
+  // CwDecoder - save the CW tone level to analize on hmi.cpp
   if(dsp_mode == MODE_CW)
   {
-    cw_rx_avg += avg_a_sample;  //average 40 samples = ((1/16kHz) * 40) = 2.5ms
-    if(++cw_rx_cnt >= MAX_CW_RX_CNT)  // 40 samples to average
+    // two Goertzel filters at the CW pitch (narrow band, the noise and QRM beside the tone are not in the level)
+    // CW_GZ_N samples each, started MAX_CW_RX_CNT apart: one ends every MAX_CW_RX_CNT samples
+    for(k=0; k<2; k++)
     {
-      cw_rx[cw_rx_index][cw_rx_array] = (cw_rx_avg >> 5); // save the 2.5ms average on array for further analysis  (40 samples / 32 - I don't like to make divisions)
-      cw_rx_avg = 0;
-      cw_rx_cnt = 0;
+      gz_s0 = a_sample + (int32_t)(((int64_t)cw_gz_coeff * cw_gz_s1[k]) >> CW_GZ_Q) - cw_gz_s2[k];
+      cw_gz_s2[k] = cw_gz_s1[k];
+      cw_gz_s1[k] = gz_s0;
+    }
 
-      if(++cw_rx_index >= MAX_CW_RX_INDEX)  // 40 averages of 2.5ms saved on array = 100ms
-      {
-        if(cw_rx_array==0)  // 0 or 1   change the array  (one array is to fill, another to analize/show on display)
-          { cw_rx_array = 1; }
-        else
-          { cw_rx_array = 0; }
+    if(cw_pitch_pos < CW_PITCH_NSAMP)  // audio for the pitch acquisition (hmi.cpp)
+    {
+      cw_pitch_buf[cw_pitch_pos++] = a_sample;
+    }
 
-        cw_rx_index = 0;
-      }
+    if(++cw_rx_cnt >= MAX_CW_RX_CNT)  // 40 samples @ 8kHz = 5ms
+    {
+      k = cw_gz_k;
+      cw_gz_k ^= 1;
+      gz_re = cw_gz_s1[k] - (int32_t)(((int64_t)cw_gz_cos * cw_gz_s2[k]) >> CW_GZ_Q);
+      gz_im = (int32_t)(((int64_t)cw_gz_sin * cw_gz_s2[k]) >> CW_GZ_Q);
+      gz_s0 = MAG(gz_re, gz_im) >> CW_GZ_SHIFT;
+      cw_ring_put((gz_s0 > 0xffff) ? 0xffff : (uint16_t)gz_s0); // level frame to the decoder (main loop)
+      cw_gz_s1[k] = 0;  // this filter starts again
+      cw_gz_s2[k] = 0;
+      cw_rx_cnt = 0;
     }
   }
 
@@ -1232,14 +1671,24 @@ a_sample = absi > absq ? absi + absq / 4 : absq + absi / 4;
 	/*
 	 * Scale and clip output,  
 	 * Send to audio DAC output
+	 * the second receiver is added here (or replaces the main one), after the AGC detector
 	 */
-	out_sample = agc_a_sample + DAC_BIAS;			// Add bias level
+	if (rx2_on)
+		out_sample = ((rx2_out == RX2_OUT_SOLO) ? rx2_sample : (agc_a_sample + rx2_sample)) + DAC_BIAS;
+	else
+		out_sample = agc_a_sample + DAC_BIAS;			// Add bias level
 	if (out_sample > (int16_t)DAC_RANGE)						// Clip to DAC range
 		out_sample = DAC_RANGE;
 	else if (out_sample<0)
 		out_sample = 0;
 
 
+    if (dsp_mute_count > 0)  // muted while the VFO settles
+    {
+      dsp_mute_count--;
+      out_sample = DAC_BIAS;
+    }
+
     /* audio output in normal use */
     pwm_set_chan_level(dac_audio, PWM_CHAN_A, out_sample);  //rx audio out
 
@@ -1247,18 +1696,9 @@ a_sample = absi > absq ? absi + absq / 4 : absq + absi / 4;
 
 
   //store variables for scope graphic
-  if(aud_samples_state == AUD_STATE_SAMP_IN)
-  {
-    aud_samp[AUD_SAMP_A][aud_samp_block_pos] = agc_a_sample>>1;
-    aud_samp[AUD_SAMP_PEAK][aud_samp_block_pos] = k;  //peak_avg_shifted>>PEAK_AVG_SHIFT;
-    aud_samp[AUD_SAMP_GAIN][aud_samp_block_pos] = agc_gain;
-
-    if(++aud_samp_block_pos >= AUD_NUM_SAMP)
-    {
-      aud_samp_block_pos = 0;
-      aud_samples_state = AUD_STATE_SAMP_RDY;
-    }
-  }
+  AUD_SAMP_STORE(AUD_SAMP_A, agc_a_sample>>1);
+  AUD_SAMP_STORE(AUD_SAMP_PEAK, k);  //peak_avg_shifted>>PEAK_AVG_SHIFT;
+  AUD_SAMP_STORE(AUD_SAMP_GAIN, agc_gain);
 
 
 
@@ -1272,6 +1712,160 @@ a_sample = absi > absq ? absi + absq / 4 : absq + absi / 4;
 }
 
 
+/**************************************************************************************
+ * RX2 = second receiver (dual watch)
+ * Runs on core1 in the DMA IRQ (core0 has no time left in rx()), one block = 10 I/Q samples:
+ *  - own NCO on the raw 160kHz I/Q samples (the main DDC is applied after it)
+ *  - CIC decimator, 3rd order, 160kHz -> 16kHz: -1.5dB at 3kHz, the alias of 13kHz (folds to 3kHz)
+ *    is 39dB down (2nd order: 26dB), the SSB/AM filter after it does not help against aliases
+ *  - SSB or AM filter (same taps as rx()), Hilbert, demodulation
+ *  - own AGC (envelope, fast attack, slow decay)
+ * The result goes to rx() on core0 through rx2_sample, added to the audio or replacing it.
+ * The RX2 frequency must stay inside LO +- RX2_SPAN, else it is muted
+ **************************************************************************************/
+#define RX2_SPAN         70000L   // Hz, the edges of the 160kHz span have the filter roll off
+#define RX2_CIC_N        3u       // CIC order (the integrators in rx2_block() are written out)
+#define RX2_CIC_SHIFT    7u       // CIC gain 10^3 = 1000, /128 gives about the level of the main FIR (mixer out < 2900: < 23000)
+#define RX2_AGC_REF      48       // output level
+#define RX2_ENV_MIN      (8L<<8)  // max gain
+#define RX2_ATTACK_SHIFT 3u
+#define RX2_DECAY_SHIFT  12u      // ~250ms
+
+volatile bool     rx2_on = false;
+volatile uint8_t  rx2_mode = MODE_USB;
+volatile uint8_t  rx2_out = RX2_OUT_MIX;
+volatile int16_t  rx2_sample = 0;
+uint32_t rx2_freq = 0;
+volatile uint32_t rx2_phase_step = 0;
+uint32_t rx2_phase = 0;
+uint32_t rx2_int_i[RX2_CIC_N], rx2_int_q[RX2_CIC_N];    // CIC integrators, modulo 2^32 (unsigned: the wrap is defined)
+uint32_t rx2_comb_i[RX2_CIC_N], rx2_comb_q[RX2_CIC_N];  // CIC comb delays
+int16_t rx2_i_raw[AM_LPF_TAP_NUM], rx2_q_raw[AM_LPF_TAP_NUM];
+int16_t rx2_i_s[HILBERT_TAP_NUM], rx2_q_s[HILBERT_TAP_NUM];
+int32_t rx2_env = RX2_ENV_MIN;           // envelope << 8
+
+/*
+ * RX2 frequency relative to the LO, called when the LO or the RX2 settings change
+ * rx2_freq = 0 switches RX2 off
+ */
+void dsp_rx2_tune(uint32_t lo)
+{
+  int32_t offset = (int32_t)(rx2_freq - lo);
+
+  if((rx2_freq == 0) || (offset > RX2_SPAN) || (offset < -RX2_SPAN))
+  {
+    rx2_on = false;
+    rx2_sample = 0;
+    return;
+  }
+  rx2_phase_step = (uint32_t)(((int64_t)offset * 4294967296LL) / (int64_t)DDC_FSAMP);
+  rx2_on = true;
+}
+
+void __not_in_flash_func(rx2_block)(volatile int16_t *samp)
+{
+  int32_t x_i, x_q, y_i, y_q;
+  uint32_t c_i, c_q, d;
+  int32_t i_accu, q_accu;
+  int16_t ntaps, qh, a, out;
+  const int16_t *taps;
+  uint16_t i;
+  uint32_t k;
+
+  //NCO and CIC integrators @160kHz
+  for(i=0; i<BLOCK_NSAMP; i+=3)
+  {
+    x_i = samp[i];
+    x_q = samp[i+1];
+    k = rx2_phase >> (32u - DDC_LUT_BITS);
+    y_i = ddc_sin[k];                                     //sin
+    y_q = ddc_sin[(k + (DDC_LUT_SIZE/4u)) & DDC_LUT_MASK];  //cos
+    rx2_phase += rx2_phase_step;
+    rx2_int_i[0] += (uint32_t)((x_i * y_q + x_q * y_i) >> 15);
+    rx2_int_q[0] += (uint32_t)((x_q * y_q - x_i * y_i) >> 15);
+    rx2_int_i[1] += rx2_int_i[0];
+    rx2_int_q[1] += rx2_int_q[0];
+    rx2_int_i[2] += rx2_int_i[1];
+    rx2_int_q[2] += rx2_int_q[1];
+  }
+
+  //CIC combs @16kHz, modulo 2^32: the output needs 12+3*log2(10) < 23 bits, so it is exact
+  c_i = rx2_int_i[RX2_CIC_N-1];
+  c_q = rx2_int_q[RX2_CIC_N-1];
+  for(i=0; i<RX2_CIC_N; i++)
+  {
+    d = c_i - rx2_comb_i[i];
+    rx2_comb_i[i] = c_i;
+    c_i = d;
+    d = c_q - rx2_comb_q[i];
+    rx2_comb_q[i] = c_q;
+    c_q = d;
+  }
+  y_i = (int32_t)c_i;
+  y_q = (int32_t)c_q;
+
+  //mode filter
+  if((rx2_mode == MODE_AM) || (rx2_mode == MODE_AM2))
+  {
+    ntaps = AM_LPF_TAP_NUM;
+    taps = am_lpf_taps;
+  }
+  else
+  {
+    ntaps = SSB_LPF_TAP_NUM;
+    taps = ssb_lpf_taps;
+  }
+  for(i=0; i<(ntaps-1); i++)
+  {
+    rx2_i_raw[i] = rx2_i_raw[i+1];
+    rx2_q_raw[i] = rx2_q_raw[i+1];
+  }
+  rx2_i_raw[ntaps-1] = (int16_t)(y_i >> RX2_CIC_SHIFT);
+  rx2_q_raw[ntaps-1] = (int16_t)(y_q >> RX2_CIC_SHIFT);
+  i_accu = 0;
+  q_accu = 0;
+  for(i=0; i<ntaps; i++)
+  {
+    i_accu += (int32_t)rx2_i_raw[i]*taps[i];
+    q_accu += (int32_t)rx2_q_raw[i]*taps[i];
+  }
+  for(i=0; i<(HILBERT_TAP_NUM-1u); i++)
+  {
+    rx2_i_s[i] = rx2_i_s[i+1];
+    rx2_q_s[i] = rx2_q_s[i+1];
+  }
+  rx2_i_s[HILBERT_TAP_NUM-1u] = (int16_t)(i_accu >> FILTER_SHIFT);
+  rx2_q_s[HILBERT_TAP_NUM-1u] = (int16_t)(q_accu >> FILTER_SHIFT);
+
+  //demodulation, as rx()  (CW = LSB)
+  if((rx2_mode == MODE_AM) || (rx2_mode == MODE_AM2))
+  {
+    a = MAG(rx2_i_s[7], rx2_q_s[7]);
+  }
+  else
+  {
+    q_accu = (rx2_q_s[0]-rx2_q_s[14])*315L + (rx2_q_s[2]-rx2_q_s[12])*440L + (rx2_q_s[4]-rx2_q_s[10])*734L + (rx2_q_s[6]-rx2_q_s[ 8])*2202L;
+    qh = q_accu >> 12;
+    a = (rx2_mode == MODE_USB) ? (rx2_i_s[7] - qh) : (rx2_i_s[7] + qh);
+  }
+
+  //AGC
+  x_i = (int32_t)ABS(a) << 8;
+  if(x_i > rx2_env)
+    rx2_env += (x_i - rx2_env) >> RX2_ATTACK_SHIFT;
+  else
+    rx2_env -= rx2_env >> RX2_DECAY_SHIFT;
+  if(rx2_env < RX2_ENV_MIN)
+    rx2_env = RX2_ENV_MIN;
+  out = (int16_t)(((int32_t)a * (RX2_AGC_REF << 8)) / rx2_env);
+  if(out > (int16_t)DAC_BIAS)
+    out = DAC_BIAS;
+  else if(out < -(int16_t)DAC_BIAS)
+    out = -(int16_t)DAC_BIAS;
+  rx2_sample = out;
+}
+
+
 /************************************************************************************** 
  * compress - audio compression input= -+2048 output= -+1024  reducing values above -+512
  **************************************************************************************/
@@ -1323,10 +1917,7 @@ bool vox(void)
 
 
   //store variables for scope graphic
-  if(aud_samples_state == AUD_STATE_SAMP_IN)  
-  {
-    aud_samp[AUD_SAMP_MIC][aud_samp_block_pos] = vox_sample>>3;  //ADC 12 bits = 4096 steps  ->  9 bits = 512 steps
-  }
+  AUD_SAMP_STORE(AUD_SAMP_MIC, vox_sample>>3);  //ADC 12 bits = 4096 steps  ->  9 bits = 512 steps
 
  
 
@@ -1376,6 +1967,10 @@ bool vox(void)
 
 
 // 666.66Hz cw tone @ 16kHz sample freq 
+#define FM_TX_FULL   1024   // filtered mic sample for FM_TX_DEV (the mode filter has a gain of ~0.4), deviation limit
+#define FM_TX_STEP   ((int32_t)((int64_t)FM_TX_DEV * 4294967296LL / FSAMP_AUDIO / FM_TX_FULL))   // NCO step per mic unit
+uint32_t fm_tx_phase = 0;
+
 #define CW_TONE_NUM  24
 int16_t cw_tone_to_play_pos = 0;
 // ADC_RANGE 4095  >>4 = DAC_RANGE 255
@@ -1442,12 +2037,27 @@ void tx(void)
     break;
   
    case MODE_AM2:											// AM
+   case MODE_SAM:
     /*
     * I and Q values are identical
     */
     qh = a_s[7];
     
     break;
+
+  case MODE_FM:                     // FM
+    /*
+    * NCO (ddc_sin table) moved by the mic audio, no pre-emphasis
+    * I = cos, Q = sin, in the 4096 range of the filters output like CW
+    */
+    a_accu = a_s[7];
+    if(a_accu > FM_TX_FULL) a_accu = FM_TX_FULL;
+    else if(a_accu < -FM_TX_FULL) a_accu = -FM_TX_FULL;
+    fm_tx_phase += (uint32_t)(a_accu * FM_TX_STEP);
+    i = fm_tx_phase >> (32u - DDC_LUT_BITS);
+    qh = ddc_sin[i] >> 4;
+    a_s[7] = ddc_sin[(i + (DDC_LUT_SIZE/4u)) & DDC_LUT_MASK] >> 4;
+    break;
   
   
   case MODE_CW:                     // CW
@@ -1479,11 +2089,9 @@ void tx(void)
   }
 
 
-  if(aud_samples_state == AUD_STATE_SAMP_IN)    //store variables for scope graphic
-    {
-      aud_samp[AUD_SAMP_I][aud_samp_block_pos] = qh>>2;
-      aud_samp[AUD_SAMP_Q][aud_samp_block_pos] = a_s[7]>>2;
-    }
+  //store variables for scope graphic
+  AUD_SAMP_STORE(AUD_SAMP_I, qh>>2);
+  AUD_SAMP_STORE(AUD_SAMP_Q, a_s[7]>>2);
   
 
   /* 
@@ -1506,7 +2114,12 @@ void tx(void)
     i_dac = DAC_RANGE;
   else
     i_dac = a_accu;
-    
+
+  if (!si_tx_ready())  // hold the QSE until the TX frequency is loaded in the Si5351 (split, XIT)
+  {
+    i_dac = DAC_BIAS;
+    q_dac = DAC_BIAS;
+  }
 
 
   // pwm_set_both_levels(dac_iq, q_dac, i_dac);		// Set both channels of the IQ slice simultaneously
@@ -1520,20 +2133,6 @@ void tx(void)
 //pwm_set_chan_level(dac_audio, PWM_CHAN_A, i_dac);  //debug LSB to audio out
 //pwm_set_chan_level(dac_audio, PWM_CHAN_A, q_dac);  //debug LSB to audio out
 
-  //store variables for scope graphic
-  if(aud_samples_state == AUD_STATE_SAMP_IN)
-  {
-    //aud_samp[AUD_SAMP_A][aud_samp_block_pos] = a_sample>>1;
-    //aud_samp[AUD_SAMP_PEAK][aud_samp_block_pos] = k;  //peak_avg_shifted>>PEAK_AVG_SHIFT;
-    //aud_samp[AUD_SAMP_GAIN][aud_samp_block_pos] = agc_gain;
-
-    if(++aud_samp_block_pos >= AUD_NUM_SAMP)
-    {
-      aud_samp_block_pos = 0;
-      aud_samples_state = AUD_STATE_SAMP_RDY;
-    }
-  }
-
 
 
 //	return true;
@@ -1720,6 +2319,9 @@ if (!win_init) {
   
 //    gpio_set_mask(1<<14);
 
+    //CW skimmer decoders, between the FFTs
+    sk_decode();
+
 
 
     //wait for FFT input data to be processed
@@ -1874,6 +2476,18 @@ void dsp_init()
   
   tx_enabled = false;
 
+  //DDC sine table, Q15
+  for (int k = 0; k < (int)DDC_LUT_SIZE; k++)
+  {
+    ddc_sin[k] = (int16_t)(32767.0f * sinf(2.0f * (float)M_PI * k / DDC_LUT_SIZE));
+  }
+
+  //atan table of rectangular_2_phase(), 65536 = 2pi
+  for (int k = 0; k <= (int)FM_ATAN_SIZE + 1; k++)
+  {
+    fm_atan[k] = (uint16_t)(65536.0f / (2.0f * (float)M_PI) * atanf((float)k / FM_ATAN_SIZE) + 0.5f);
+  }
+
   //analogWriteResolution(12);
 
 
@@ -19,6 +19,8 @@ extern "C" {
 #define FSAMP 480000UL  // freq AD sample / 3 channels = 160kHz
 #define FSAMP_AUDIO 16000U  // audio freq sample   32kHz=critical time
 #define ADC_CLOCK_DIV ((uint16_t)(48000000UL/FSAMP))  //48Mhz / 480Khz = 100 
+#define BLOCK_NSAMP    (FSAMP/FSAMP_AUDIO)    //DMA block = 480k / 16k = 30 samples  (I, Q, MIC)
+#define BLOCK_NSET     (BLOCK_NSAMP/3)        //block = 10 sets of 3 samples
 #define FRES   500u    //Hz resolucao de frequencias desejado para cada bin
 #define FFT_NSAMP      ((((uint16_t)((FSAMP / 3u) / FRES))+1u) & (~(uint16_t)1u))  // must be even  160k / 500 = 320
 //FFT max freq = (FSAMP/3) / 2
@@ -76,8 +78,50 @@ void dsp_setagc(int agc);
 void dsp_setmode(int mode);
 void dsp_setvox(int vox);
 int dsp_getmode(void);
+void dsp_mute(uint16_t ms);
+extern volatile uint16_t dsp_mute_count;
+void dsp_setddc(int32_t offset);
+
+//NCO sine table of the DDC, also used by RX2 and the CW skimmer channels
+#define DDC_LUT_BITS    10u
+#define DDC_LUT_SIZE    (1u<<DDC_LUT_BITS)
+#define DDC_LUT_MASK    (DDC_LUT_SIZE-1u)
+#define DDC_FSAMP       (FSAMP/3u)           //I/Q sample freq
+extern int16_t ddc_sin[DDC_LUT_SIZE];
+
+//second receiver (dual watch) inside the span of the LO, see dsp.cpp
+#define RX2_OUT_MIX    0   //added to the main audio
+#define RX2_OUT_SOLO   1   //only RX2 on the audio
+extern volatile bool     rx2_on;
+extern volatile uint8_t  rx2_mode;   //MODE_USB, MODE_LSB, MODE_AM (CW and AM2 as LSB and AM)
+extern volatile uint8_t  rx2_out;
+extern volatile int16_t  rx2_sample; //audio, written on core1, used by rx()
+extern uint32_t rx2_freq;            //Hz, 0 = off
+void dsp_rx2_tune(uint32_t lo);
+
+//phase of an I/Q sample (65536 = 2pi), atan table with interpolation, see dsp.cpp
+#define FM_ATAN_BITS   5u
+#define FM_ATAN_SIZE   (1u<<FM_ATAN_BITS)
 int16_t rectangular_2_phase(int16_t i, int16_t q);
 
+//synchronous AM (MODE_SAM): carrier PLL in rx(), see dsp.cpp
+#define SAM_DSB        0   //both sidebands
+#define SAM_USB        1   //one sideband only (selective fading, QRM on the other side)
+#define SAM_LSB        2
+extern volatile uint8_t  sam_sb;
+extern volatile bool     sam_lock;
+void sam_reset(void);
+int16_t sam_offset(void);            //carrier offset in Hz, > 0 = station above the dial
+
+//NBFM (MODE_FM): polar discriminator, de-emphasis and noise squelch in rx(), see dsp.cpp
+#define FM_SQL_MAX     9   //fm_sql 0 = open, 1..9 = the squelch needs a better signal
+#define FM_TX_DEV      2500   //Hz deviation at full mic level
+extern volatile uint8_t  fm_sql;
+extern volatile bool     fm_open;
+void fm_reset(void);
+int16_t fm_offset(void);             //carrier offset in Hz, > 0 = station above the dial
+uint16_t fm_noise(void);             //squelch noise level (average of the discriminator noise)
+
 //extern volatile uint16_t adc_audio_ready;
 extern volatile uint16_t tim_count;
 //extern volatile uint16_t fft_samples_ready;
@@ -88,19 +132,37 @@ extern volatile uint16_t fft_display_graf_new;
 #define AUD_GRAPH_NUM_COLS  93 // was 100
 
 #define AUD_NUM_VAR    (6u)  // number of variables on buffer for low freq = audio graphic
-#define AUD_NUM_SAMP   (AUD_GRAPH_NUM_COLS*3u)  // number of variables on buffer for low freq = audio graphic
+#define AUD_NUM_SAMP   (256u)  // samples on each scope capture buffer (ring, power of 2, > 2*AUD_GRAPH_NUM_COLS)
+#define AUD_SAMP_MASK  (AUD_NUM_SAMP-1u)
 #define AUD_SAMP_I     0u
 #define AUD_SAMP_Q     1u
 #define AUD_SAMP_MIC   2u
 #define AUD_SAMP_A     3u
 #define AUD_SAMP_PEAK  4u
 #define AUD_SAMP_GAIN  5u
-#define AUD_STATE_SAMP_IN      0
-#define AUD_STATE_SAMP_RDY     10
-//#define AUD_STATE_SAMP_GRAPH   20
-//#define AUD_STATE_SAMP_DONE    30
-extern volatile int16_t aud_samp[AUD_NUM_VAR][AUD_NUM_SAMP];  //samples buffer for FFT and waterfall    only 0-1 used for I and Q  (3=MIC)  [NL][NCOL]
-extern volatile uint16_t aud_samples_state;
+
+// scope capture: the ISR writes the actual sample set into one buffer (ring) while the display reads the other one
+// the write position is a 24.8 fixed point counter, the step is 256/decimation (step 0 = scope hidden, capture stopped)
+#define AUD_POS_SHIFT      8u
+#define AUD_TRIG_RISE      0u
+#define AUD_TRIG_FALL      1u
+#define AUD_TRIG_HYST      2    // trigger hysteresis (scope units)
+extern volatile int16_t aud_samp[2][AUD_NUM_SAMP][AUD_NUM_VAR];  //scope capture buffers  [buffer][sample][var]
+extern volatile int16_t *aud_samp_wr;    //sample set being written by the ISR
+extern uint16_t aud_samp_rd;             //buffer owned by the display
+extern uint8_t  aud_trig_var;            //AUD_SAMP_x used as trigger source
+extern int16_t  aud_trig_level;
+extern uint8_t  aud_trig_slope;          //AUD_TRIG_RISE or AUD_TRIG_FALL
+extern uint16_t aud_pretrig;             //samples shown before the trigger point
+extern uint16_t aud_decim;               //1 = every 16kHz sample, 0 = scope hidden
+
+// ISR side: one store per variable, the position is incremented once per sample in core0_irq_handler()
+#define AUD_SAMP_STORE(var, val)   (aud_samp_wr[(var)] = (int16_t)(val))
+// display side: sample x (from dsp_scope_frame() start) of the buffer owned by the display
+#define AUD_SAMP(var, x)           (aud_samp[aud_samp_rd][(x) & AUD_SAMP_MASK][(var)])
+
+void dsp_scope_set(uint8_t var, int16_t level, uint8_t slope, uint16_t pretrig, uint16_t decim);
+int16_t dsp_scope_frame(void);   //swap buffers when a capture is complete, returns the start position or -1
 
 #define PEAK_AVG_SHIFT   2     //affects agc speed 
 extern volatile int32_t peak_avg_shifted;     // signal level detector after AGC = average of positive values
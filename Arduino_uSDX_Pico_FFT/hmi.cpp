@@ -61,6 +61,9 @@ It saves the actual band setup on flash memory, so when we come back to this ban
 
 Menu Waterfall Gain: Press Enter and keep pressed. Change waterfall gain while pressed. Release.
 
+Menu Signal:
+Turning the encoder tunes to the next/previous signal of the band map (markers above the waterfall).
+
 
 
  */
@@ -83,6 +86,10 @@ Menu Waterfall Gain: Press Enter and keep pressed. Change waterfall gain while p
 #include "SPI.h"
 #include "TFT_eSPI.h"
 #include "display_tft.h"
+#include "hmi_pio.h"
+#include "i2c_async.h"
+#include "bandmap.h"
+#include "skimmer.h"
 
 #include "CwDecoder.h"
 
@@ -142,10 +149,11 @@ Menu Waterfall Gain: Press Enter and keep pressed. Change waterfall gain while p
 
 
 //char hmi_o_menu[NUMBER_OF_MENUES][8] = {"Tune","Mode","AGC","Pre","VOX"};	// Indexed by hmi_menu  not used - menus done direct in Evaluate()
-char hmi_o_mode[HMI_NUM_OPT_MODE][8] = { "USB", "LSB", "AM", "AM2", "CW " };           // Indexed by band_vars[hmi_band][HMI_S_MODE]  MODE_USB=0 MODE_LSB=1  MODE_AM=2  MODE_CW=3
+char hmi_o_mode[HMI_NUM_OPT_MODE][8] = { "USB", "LSB", "AM", "AM2", "CW ", "SAM", "FM" };           // Indexed by band_vars[hmi_band][HMI_S_MODE]  MODE_USB=0 MODE_LSB=1  MODE_AM=2  MODE_CW=3
 char hmi_o_agc[HMI_NUM_OPT_AGC][8] = { "OFF", "Slow ", "Fast " };                      // Indexed by band_vars[hmi_band][HMI_S_AGC]
 char hmi_o_pre[HMI_NUM_OPT_PRE][8] = { "-30dB", "-20dB", "-10dB", "0dB  ", "+10dB" };  // Indexed by band_vars[hmi_band][HMI_S_PRE]
 char hmi_o_vox[HMI_NUM_OPT_VOX][8] = { "OFF", "LOW", "Mid", "HIGH" };                  // Indexed by band_vars[hmi_band][HMI_S_VOX]                                                            //index for NoVOX option
+char hmi_o_vfo[HMI_NUM_OPT_VFO][8] = { "A", "B", "SPLIT" };                                // Indexed by band_vars[hmi_band][HMI_S_VFO]
 char hmi_o_bpf[NUMBER_OF_BANDS][16] = { "<2.5", "2-6", "5-12", "5-12", "10-24", "10-24", "10-24", "20-40", "20-40", "20-40", "20-40", "<2.5", "2-6", "5-12", "10-24", "20-40" };
 
 
@@ -231,12 +239,21 @@ uint8_t band_vars[NUMBER_OF_BANDS][NUMBER_OF_MENUES] = {
   { 4, 2, 2, 3, 0, 15 }
 };
 
+static uint8_t hmi_sig_idx = 0;  // band map entry of the Signal menu, RAM only: band_vars go to the settings journal
+
+// option of a menu, as stored in band_vars (Signal: the band map entry, not stored)
+static int8_t hmi_menu_opt(uint8_t menu) {
+  return (menu == HMI_S_SIG) ? hmi_sig_idx : band_vars[hmi_band][menu];
+}
+
 uint32_t band_starting_freq[NUMBER_OF_BANDS] = { b0, b1, b2, b3, b4, b5, b6, b7, b8, b9, b10, b11, b12, b13, b14, b15 };
 
 
-uint32_t hmi_freq;  // Frequency from Tune state
+uint32_t hmi_freq;    // Frequency from Tune state (VFO tuned, A or B)
+uint32_t hmi_freq_b;  // the other VFO, TX frequency on split
 
 const uint32_t hmi_step[HMI_NUM_OPT_TUNE] = { 10000000L, 1000000L, 100000L, 10000L, 1000L, 100L, 10L };  // Frequency digit increments (tune option = cursor position)
+uint16_t hmi_step_mult = 1;  // encoder acceleration: number of hmi_step units for the next INCREMENT/DECREMENT
 
 const uint32_t hmi_minfreq[NUMBER_OF_BANDS] = { 0000000L, 2000000L, 5000000L, 5000000L, 10000000L, 10000000L, 10000000L, 20000000L, 20000000L, 20000000L, 20000000L, 000000L, 2000000L, 5000000L, 10000000L, 20000000L };      // min freq for each band from pass band filters
 const uint32_t hmi_maxfreq[NUMBER_OF_BANDS] = { 2500000L, 6000000L, 12000000L, 12000000L, 24000000L, 24000000L, 24000000L, 40000000L, 40000000L, 40000000L, 40000000L, 2500000L, 6000000L, 12000000L, 24000000L, 40000000L };  // max freq for each band from pass band filters
@@ -281,6 +298,39 @@ void Store_Last_Band(uint8_t band) {
 }
 
 
+//***********************************************************************
+//
+// RX and TX frequency to the Si5351
+// RX = tuned VFO + RIT, TX = tuned VFO (VFO B on split) + XIT
+// RX is LO + DDC offset: tuning inside LO +- HMI_DDC_WINDOW only changes the NCO,
+// the LO (and the waterfall center) moves to the RX frequency when it goes outside
+//
+//***********************************************************************
+uint32_t hmi_freq_lo = 0;
+int32_t hmi_ddc_offset = 0;
+bool hmi_lo_recenter = false;
+
+void hmi_setfreq(void) {
+  uint32_t f_rx, f_tx;
+
+  f_rx = hmi_freq + (int8_t)band_vars[hmi_band][HMI_S_RIT] * HMI_RIT_STEP;
+  f_tx = (band_vars[hmi_band][HMI_S_VFO] == HMI_VFO_SPLIT) ? hmi_freq_b : hmi_freq;
+  f_tx += (int8_t)band_vars[hmi_band][HMI_S_XIT] * HMI_RIT_STEP;
+
+  if (hmi_lo_recenter || (f_rx > hmi_freq_lo + HMI_DDC_WINDOW) || (f_rx + HMI_DDC_WINDOW < hmi_freq_lo)) {
+    hmi_freq_lo = f_rx;
+    hmi_lo_recenter = false;
+  }
+  hmi_ddc_offset = (int32_t)(f_rx - hmi_freq_lo);
+  dsp_setddc(hmi_ddc_offset);
+  dsp_rx2_tune(hmi_freq_lo);  // second receiver follows the LO
+  sk_tune(hmi_freq_lo);       // CW skimmer channels too
+
+  SI_SETFREQ_TX(HMI_MULFREQ * f_tx);  // both images are calculated by si_evaluate(), RX only loaded when changed
+  SI_SETFREQ(0, HMI_MULFREQ * hmi_freq_lo);
+}
+
+
 //***********************************************************************
 //
 // get band info from band_vars -> and set  freq
@@ -311,7 +361,9 @@ void Setup_Band(uint8_t band) {
 
   //set the new band to display and freq
 
-  SI_SETFREQ(0, HMI_MULFREQ * hmi_freq);  // Set freq to hmi_freq (MULFREQ depends on mixer type)
+  si_plan_band(HMI_MULFREQ * band_lower_limit[band], HMI_MULFREQ * band_upper_limit[band]);  // MSi/Ri segments for the band
+  hmi_freq_b = hmi_freq;                  // VFO B starts on the same frequency
+  hmi_setfreq();                          // Set RX and TX freq from hmi_freq (MULFREQ depends on mixer type)
   SI_SETPHASE(0, 1);                      // Set phase to 90deg (depends on mixer type)
 
   //ptt_state = 0;
@@ -419,17 +471,9 @@ void hmi_handler(uint8_t event) {
     }
 
 
-    if (toy > 190) {  // snippet to adjust hmi_freq when tapping on waterfall
-      if (tox < 160)
-        hmi_freq -= (80 - tox / 2) * 1000;
-      if (tox > 160)
-        hmi_freq += (tox / 2 - 80) * 1000;
-      touch_delay = 2;
-
-      if (band_vars[hmi_band][HMI_S_TUNE] != 4) {
-        hmi_menu_opt_display = 4;
-        band_vars[hmi_band][HMI_S_TUNE] = hmi_menu_opt_display;  // set to 1KHz step
-      }
+    if (tox > 150 && tox < 170 && toy > 175 && toy < 185) {  // toggle to alternative waterfall palette
+      display_fft_palette_toggle();
+      touch_delay = 5;  // block for a while to avoid toggeling
       return;
     }
 
@@ -492,7 +536,7 @@ void hmi_handler(uint8_t event) {
     {
 #endif
       band_vars[hmi_band][HMI_S_MODE]++;
-      if (band_vars[hmi_band][HMI_S_MODE] > 4)
+      if (band_vars[hmi_band][HMI_S_MODE] >= HMI_NUM_OPT_MODE)
         band_vars[hmi_band][HMI_S_MODE] = 0;
       hmi_menu_opt_display = band_vars[hmi_band][HMI_S_MODE];
     }
@@ -506,27 +550,32 @@ void hmi_handler(uint8_t event) {
 
 
 
-      hmi_menu_opt_display = band_vars[hmi_band][hmi_menu];  // Restore selection of new menu
+      hmi_menu_opt_display = hmi_menu_opt(hmi_menu);  // Restore selection of new menu
     }
 
     else if (event == HMI_E_INCREMENT || event == HMI_E_DECREMENT) {
 
 
       uint8_t step_index = band_vars[hmi_band][HMI_S_TUNE];  // fixes step change bug
-      int32_t step = hmi_step[step_index];
+      int64_t step = (int64_t)hmi_step[step_index] * hmi_step_mult;
+      int32_t freq = (int32_t)hmi_freq;  // signed, a big step must not wrap around zero
+
+      if (step > (int64_t)(band_upper_limit[hmi_band] - band_lower_limit[hmi_band]))  // more wraps anyway, int32 below
+        step = band_upper_limit[hmi_band] - band_lower_limit[hmi_band];
 
       // Apply increment or decrement
       if (event == HMI_E_INCREMENT) {
-        hmi_freq += step;
-        if (hmi_freq > band_upper_limit[hmi_band]) {
-          hmi_freq = band_lower_limit[hmi_band];  // wrap
+        freq += (int32_t)step;
+        if (freq > (int32_t)band_upper_limit[hmi_band]) {
+          freq = band_lower_limit[hmi_band];  // wrap
         }
       } else {  // HMI_E_DECREMENT
-        hmi_freq -= step;
-        if (hmi_freq < band_lower_limit[hmi_band]) {
-          hmi_freq = band_upper_limit[hmi_band];  // wrap
+        freq -= (int32_t)step;
+        if (freq < (int32_t)band_lower_limit[hmi_band]) {
+          freq = band_upper_limit[hmi_band];  // wrap
         }
       }
+      hmi_freq = (uint32_t)freq;
     }
 
 
@@ -620,6 +669,26 @@ void hmi_handler(uint8_t event) {
           sel_graph--;
 
         break;
+      case HMI_S_VFO:
+        if (event == HMI_E_INCREMENT)
+          hmi_menu_opt_display = (hmi_menu_opt_display < HMI_NUM_OPT_VFO - 1) ? hmi_menu_opt_display + 1 : HMI_NUM_OPT_VFO - 1;
+        else if (event == HMI_E_DECREMENT)
+          hmi_menu_opt_display = (hmi_menu_opt_display > 0) ? hmi_menu_opt_display - 1 : 0;
+        break;
+      case HMI_S_RIT:  // offset in HMI_RIT_STEP units, 0 = off
+      case HMI_S_XIT:
+        if (event == HMI_E_INCREMENT)
+          hmi_menu_opt_display = (hmi_menu_opt_display < HMI_RIT_MAX) ? hmi_menu_opt_display + 1 : HMI_RIT_MAX;
+        else if (event == HMI_E_DECREMENT)
+          hmi_menu_opt_display = (hmi_menu_opt_display > -HMI_RIT_MAX) ? hmi_menu_opt_display - 1 : -HMI_RIT_MAX;
+        break;
+      case HMI_S_SIG:  // encoder tunes to the next/previous signal of the band map
+        if (event == HMI_E_INCREMENT || event == HMI_E_DECREMENT) {
+          int sig = bm_next(event == HMI_E_INCREMENT);
+          if (sig >= 0)
+            hmi_menu_opt_display = sig;
+        }
+        break;
     }
 
     /* General actions for all submenus */
@@ -638,9 +707,12 @@ void hmi_handler(uint8_t event) {
       hmi_band = hmi_menu_opt_display;  //band changed
     else {
 
-      hmi_menu = constrain(hmi_menu, 2, 7);  // 2=AGC 3=Pre 4=VOX 5=Band
+      hmi_menu = constrain(hmi_menu, 2, NUMBER_OF_MENUES - 1);  // 2=AGC 3=Pre 4=VOX 5=Band ... 10=XIT 11=Signal
 
-      band_vars[hmi_band][hmi_menu] = hmi_menu_opt_display;  // Store selected option
+      if (hmi_menu == HMI_S_SIG)
+        hmi_sig_idx = hmi_menu_opt_display;
+      else
+        band_vars[hmi_band][hmi_menu] = hmi_menu_opt_display;  // Store selected option
     }
 
     if (event == HMI_E_SUBMENU) {
@@ -653,19 +725,114 @@ void hmi_handler(uint8_t event) {
       }
     } else if (event == HMI_E_RIGHT) {
       hmi_menu = (hmi_menu < NUMBER_OF_MENUES - 1) ? (hmi_menu + 1) : 1;  // Change submenu
-      hmi_menu_opt_display = band_vars[hmi_band][hmi_menu];               // Restore selection of new state
+      hmi_menu_opt_display = hmi_menu_opt(hmi_menu);                      // Restore selection of new state
     } else if (event == HMI_E_LEFT) {
       hmi_menu = (hmi_menu > 1) ? (hmi_menu - 1) : NUMBER_OF_MENUES - 1;  // Change submenu
-      hmi_menu_opt_display = band_vars[hmi_band][hmi_menu];               // Restore selection of new state
+      hmi_menu_opt_display = hmi_menu_opt(hmi_menu);                      // Restore selection of new state
     }
   }
 }
 
 
 
+/*
+ * HMI event queue
+ * The GPIO IRQ only stores the event with a time stamp (single producer),
+ * hmi_event_evaluate() in the main loop takes them out (single consumer) and runs the state machine.
+ */
+#define HMI_EVQ_SIZE 32  // power of 2
+#define HMI_EVQ_MASK (HMI_EVQ_SIZE - 1)
+
+// encoder acceleration, time between detents -> hmi_step units per detent
+#define HMI_ACC_T8_US  10000
+#define HMI_ACC_T4_US  25000
+#define HMI_ACC_T2_US  50000
+#define HMI_NET_MAX    256    // hmi_step units of one drain: 32 fast detents, more is a stall of the main loop
+
+typedef struct {
+  uint8_t event;
+  uint32_t time;  // time_us_32() at the IRQ
+} hmi_evq_t;
+
+volatile hmi_evq_t hmi_evq[HMI_EVQ_SIZE];
+volatile uint8_t hmi_evq_wr = 0;  // written only by the IRQ
+volatile uint8_t hmi_evq_rd = 0;  // written only by the main loop
+volatile uint32_t hmi_evq_drops = 0;
+
+
+void hmi_event_put_time(uint8_t evt, uint32_t time) {
+  uint8_t wr = hmi_evq_wr;
+
+  if ((uint8_t)((wr + 1) & HMI_EVQ_MASK) == hmi_evq_rd) {  // full
+    hmi_evq_drops++;
+    return;
+  }
+  hmi_evq[wr].event = evt;
+  hmi_evq[wr].time = time;
+  __compiler_memory_barrier();  // entry written before the index (IRQ and main loop on core0)
+  hmi_evq_wr = (wr + 1) & HMI_EVQ_MASK;
+}
+
+
+void hmi_event_put(uint8_t evt) {
+  hmi_event_put_time(evt, time_us_32());
+}
+
+
+/*
+ * apply the encoder detents collected (net = signed hmi_step units)
+ */
+void hmi_event_encoder(int32_t net) {
+  if (net == 0)
+    return;
+  net = constrain(net, -HMI_NET_MAX, HMI_NET_MAX);
+  hmi_step_mult = (uint16_t)((net > 0) ? net : -net);
+  hmi_handler((net > 0) ? HMI_E_INCREMENT : HMI_E_DECREMENT);
+  hmi_step_mult = 1;
+}
+
+
+/*
+ * Drain the event queue (main loop)
+ * Encoder detents in a row are coalesced: on Tune, the step is multiplied by the spin speed,
+ * on the submenus each detent is one step
+ */
+void hmi_event_evaluate(void) {
+  static uint32_t enc_time_last = 0;
+  int32_t net = 0;
+  uint32_t dt;
+  uint8_t rd, evt;
+  int8_t dir;
+  int32_t mult;
+
+  while ((rd = hmi_evq_rd) != hmi_evq_wr) {
+    __compiler_memory_barrier();
+    evt = hmi_evq[rd].event;
+
+    if ((evt == HMI_E_INCREMENT) || (evt == HMI_E_DECREMENT)) {
+      dir = (evt == HMI_E_INCREMENT) ? 1 : -1;
+      if (hmi_menu == HMI_S_TUNE) {
+        dt = hmi_evq[rd].time - enc_time_last;
+        mult = (dt < HMI_ACC_T8_US) ? 8 : ((dt < HMI_ACC_T4_US) ? 4 : ((dt < HMI_ACC_T2_US) ? 2 : 1));
+        net += dir * mult;
+      } else {
+        hmi_handler(evt);
+      }
+      enc_time_last = hmi_evq[rd].time;
+    } else {
+      hmi_event_encoder(net);  // keep the order of the events
+      net = 0;
+      hmi_handler(evt);
+    }
+    hmi_evq_rd = (rd + 1) & HMI_EVQ_MASK;
+  }
+  hmi_event_encoder(net);
+}
+
+
 /*
  * GPIO IRQ callback routine
- * Sets the detected event and invokes the HMI state machine
+ * Sets the detected event and puts it on the HMI event queue
  */
 void hmi_callback(uint gpio, uint32_t events) {
   uint8_t evt = HMI_E_NOEVENT;
@@ -734,7 +901,14 @@ void hmi_callback(uint gpio, uint32_t events) {
 
 
 
-  hmi_handler(evt);  // Invoke state machine
+  if ((evt == HMI_PTT_ON) && (ptt_internal_active == false))  // PTT is not delayed by the queue
+  {
+    ptt_external_active = true;
+  } else if (evt == HMI_PTT_OFF) {
+    ptt_external_active = false;
+  } else if (evt != HMI_E_NOEVENT) {
+    hmi_event_put(evt);  // state machine runs on main loop
+  }
 }
 
 
@@ -755,7 +929,7 @@ void hmi_init0(void) {
   Serialx.println("hmi_menu_opt_display " + String(hmi_menu_opt_display));
 
 
-  CwDecoder_InicTable();  //fill table on running time
+  CwDecoder_InicTable();  //Goertzel coefficients of the CW tone
 }
 
 
@@ -801,6 +975,9 @@ for(;;)
 */
 
 
+#ifdef HMI_USE_PIO_INPUT
+  hmi_pio_init(GP_ENC_A);  // encoder and keys read by PIO, no GPIO IRQ
+#else
   // Enable interrupt on level low
   gpio_set_irq_enabled(GP_ENC_A, GPIO_IRQ_EDGE_ALL, true);
   gpio_set_irq_enabled(GP_AUX_0_Enter, GPIO_IRQ_EDGE_ALL, true);
@@ -812,6 +989,7 @@ for(;;)
 
   // Set callback, one for all GPIO, not sure about correctness!
   gpio_set_irq_enabled_with_callback(GP_ENC_A, GPIO_IRQ_EDGE_ALL, true, hmi_callback);
+#endif
 
 #ifdef USE_TOUCH_SCREEN
   uint16_t calData[5] = { 379, 3519, 197, 3591, 1 };  // modify as needed
@@ -979,7 +1157,7 @@ void hmi_smeter(void) {
 #if I2C_Arduino_Pro_Mini == 1  //only used when together with Arduino Pro Mini for relays control (and allow SWR reading)
 
 
-#define TIME_SHOW 6  // x 100ms = "some time"
+#define TIME_SHOW 3  // x 200ms (SWR task period) = "some time"
 
 /**************************************************************************************
     hmi_power_show - used to show the recent bigger power value on the display for "some time"
@@ -989,7 +1167,7 @@ bool hmi_power_show(int16_t pow) {
   static int16_t time = 0;
   bool ret;
 
-  if (++time > TIME_SHOW)  //count every 100ms
+  if (++time > TIME_SHOW)  //count every 200ms
   {
     time = 0;
     pow_big = 0;
@@ -1013,23 +1191,24 @@ const int16_t power_adc[SWR_POW_MAX] = { 20, 40, 60, 80, 100, 120, 140, 160, 180
 
 
 /**************************************************************************************
-    hmi_power_swr - reads the swr and put on display
+    hmi_power_swr - puts the swr (read by hmi_swr_evaluate) on display
 **************************************************************************************/
-void hmi_power_swr(void)  //read the swr from Arduino Pro Mini I2C
+static uint8_t i2c_data[3];  // SWR, FOR and REF from the Arduino Pro Mini
+bool hmi_swr_pending = false;
+bool hmi_swr_start = false;
+
+void hmi_power_swr(bool tx_start)  //show the swr read from Arduino Pro Mini I2C
 {
-  static uint8_t i2c_data[3];
   static uint8_t i2c_data0_old = 0;
   int16_t ret;
   int16_t pow;
 
-  ret = i2c_read_blocking(i2c1, I2C_SWR, i2c_data, 3, false);  // get 3 bytes: SWR, FOR and REF
-
   ret = 3;
   if (ret == 3)  //number os bytes received  (<0 if no answer from I2C slave)
 
   {
 
-    if (tx_enable_changed == true)  //if changed tx-rx = display clear
+    if (tx_start == true)  //if changed rx-tx = display clear
     {
       
        tft.fillRect(0,0, 180,16, TFT_BLACK);
@@ -1102,8 +1281,127 @@ void hmi_power_swr(void)  //read the swr from Arduino Pro Mini I2C
 #endif
 
 
+/*
+ * VFO B / split / RIT / XIT status, on the top line (right side) while tuning
+ * In SAM mode also the sideband and the carrier offset (or "unlock").
+ * In FM mode also the squelch level and the carrier offset (or "closed").
+ * The CW decoder uses the top line in CW mode.
+ */
+void hmi_vfo_show(void)
+{
+  int8_t rit = (int8_t)band_vars[hmi_band][HMI_S_RIT];
+  int8_t xit = (int8_t)band_vars[hmi_band][HMI_S_XIT];
+  char t[40];
+  int n = 0;
+
+  if ((hmi_menu != HMI_S_TUNE) || (band_vars[hmi_band][HMI_S_MODE] == MODE_CW))
+    return;
+
+  t[0] = 0;
+  if (band_vars[hmi_band][HMI_S_MODE] == MODE_SAM) {
+    n += sprintf(t + n, "%s ", (sam_sb == SAM_USB) ? "USB" : ((sam_sb == SAM_LSB) ? "LSB" : "DSB"));
+    if (sam_lock)
+      n += sprintf(t + n, "%+dHz ", sam_offset());
+    else
+      n += sprintf(t + n, "unlock ");
+  }
+  if (band_vars[hmi_band][HMI_S_MODE] == MODE_FM) {
+    n += sprintf(t + n, "SQL%u ", fm_sql);
+    if (fm_open)
+      n += sprintf(t + n, "%+dHz ", fm_offset());
+    else
+      n += sprintf(t + n, "closed ");
+  }
+  if (band_vars[hmi_band][HMI_S_VFO] == HMI_VFO_B)
+    n += sprintf(t + n, "VFO B ");
+  else if (band_vars[hmi_band][HMI_S_VFO] == HMI_VFO_SPLIT)
+    n += sprintf(t + n, "SPLIT ");
+  if (rit != 0)
+    n += sprintf(t + n, "R%+d ", rit * HMI_RIT_STEP);
+  if (xit != 0)
+    n += sprintf(t + n, "X%+d ", xit * HMI_RIT_STEP);
+
+  tft.fillRect(150, 0, 170, 15, TFT_BACKGROUND);
+  tft.setFreeFont(NULL);
+  tft.setTextColor(TFT_ORANGE, TFT_BACKGROUND);
+  tft.setCursor(320 - 6 * n, 4);
+  tft.print(t);
+  tft.setFreeFont(FONT1);
+}
+
+
+/*
+ * SAM lock and carrier offset changed: status line again
+ */
+void hmi_sam_show(void)
+{
+  static bool lock_old = false;
+  static int16_t offset_old = 0;
+  static uint8_t sb_old = SAM_DSB;
+  int16_t offset = sam_offset();
+
+  if ((sam_lock == lock_old) && (sam_sb == sb_old) && (!sam_lock || (abs(offset - offset_old) < HMI_SAM_SHOW_HZ)))
+    return;
+  lock_old = sam_lock;
+  offset_old = offset;
+  sb_old = sam_sb;
+  hmi_vfo_show();
+}
+
+
+/*
+ * FM squelch or carrier offset changed: status line again
+ */
+void hmi_fm_show(void)
+{
+  static bool open_old = false;
+  static int16_t offset_old = 0;
+  static uint8_t sql_old = 0;
+  int16_t offset = fm_offset();
+
+  if ((fm_open == open_old) && (fm_sql == sql_old) && (!fm_open || (abs(offset - offset_old) < HMI_FM_SHOW_HZ)))
+    return;
+  open_old = fm_open;
+  offset_old = offset;
+  sql_old = fm_sql;
+  hmi_vfo_show();
+}
 
 
+/*
+ * SWR task, reads and shows the power and SWR during TX
+ * This function is called every 200ms from the scheduler.
+ */
+#if I2C_Arduino_Pro_Mini == 1
+/*
+ * SWR read done (called from i2ca_evaluate), the last good values are kept on error
+ */
+void hmi_swr_done(i2ca_trn_t *t)
+{
+  hmi_swr_pending = false;
+  if (t->ret == 3)
+    memcpy(i2c_data, t->rdata, 3);
+  if (tx_enabled == true)
+    hmi_power_swr(hmi_swr_start);
+  hmi_swr_start = false;
+}
+#endif
+
+void hmi_swr_evaluate(void)
+{
+#if I2C_Arduino_Pro_Mini == 1  //using Arduino Pro Mini for relays control (and allow SWR reading)
+  static bool tx_old = false;
+
+  if ((tx_enabled == true) && (tx_old == false))
+    hmi_swr_start = true;  //display clear on the next result
+  if ((tx_enabled == true) && (hmi_swr_pending == false)) {  //during TX, read the SWR (queued), hmi_swr_done prints it on display
+    if (i2ca_read(I2CA_BUS_RELAY, I2C_SWR, NULL, 0, 3, hmi_swr_done, NULL) >= 0)  // get 3 bytes: SWR, FOR and REF
+      hmi_swr_pending = true;
+  }
+  tx_old = tx_enabled;
+#endif
+}
+
 
 //int16_t contk = 0;
 /*
@@ -1114,11 +1412,15 @@ void hmi_evaluate(void)  //hmi loop
 {
   static uint8_t band_vars_old[NUMBER_OF_MENUES] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };  // Stored last option selection
   static uint32_t hmi_freq_old = 0xff;
+  static uint32_t hmi_freq_b_old = 0xff;
+  uint32_t f;
   static uint8_t hmi_band_old = hmi_band;
   static bool tx_enable_old = true;
   static uint8_t hmi_menu_old = 0xff;
   static uint8_t hmi_menu_opt_display_old = 0xff;
 
+  hmi_event_evaluate();  // events from the GPIO IRQ (encoder and keys)
+
 
 
 #ifdef HMI_debug
@@ -1142,12 +1444,31 @@ void hmi_evaluate(void)  //hmi loop
 
   // if band_var changed (after <enter>), set parameters accordingly
 
+  if ((band_vars_old[HMI_S_VFO] != band_vars[hmi_band][HMI_S_VFO]) || (band_vars_old[HMI_S_RIT] != band_vars[hmi_band][HMI_S_RIT]) ||
+      (band_vars_old[HMI_S_XIT] != band_vars[hmi_band][HMI_S_XIT]) || (hmi_freq_b_old != hmi_freq_b)) {
+    if ((band_vars_old[HMI_S_VFO] == HMI_VFO_B) != (band_vars[hmi_band][HMI_S_VFO] == HMI_VFO_B)) {  // A <-> B, hmi_freq is the VFO tuned
+      f = hmi_freq;
+      hmi_freq = hmi_freq_b;
+      hmi_freq_b = f;
+    }
+    band_vars_old[HMI_S_VFO] = band_vars[hmi_band][HMI_S_VFO];
+    band_vars_old[HMI_S_RIT] = band_vars[hmi_band][HMI_S_RIT];
+    band_vars_old[HMI_S_XIT] = band_vars[hmi_band][HMI_S_XIT];
+    hmi_freq_b_old = hmi_freq_b;
+
+    hmi_setfreq();
+    hmi_vfo_show();
+    display_fft_graf_top();  //RIT moves the triangle (DDC offset)
+  }
+
   if (hmi_freq_old != hmi_freq) {
 
     if (hmi_freq > 40000000L)
       hmi_freq = 40000000L;  // limit to 40MHz
 
-    SI_SETFREQ(0, HMI_MULFREQ * hmi_freq);
+    hmi_setfreq();
+    if (hmi_band == hmi_band_old)
+      Store_Last_Band(hmi_band);  // tuned frequency of the band (kept in flash by the settings store)
     //freq  (from encoder)
 
 
@@ -1224,7 +1545,6 @@ void hmi_evaluate(void)  //hmi loop
     Store_Last_Band(hmi_band_old);  // store data from old band (save freq to have it when back to this band)
 
     //relay_setband(hmi_band);  // = hmi_band
-    sleep_ms(1);              // I2C doesn't work without...
     Setup_Band(hmi_band);     // = hmi_band  get the new band data
     hmi_band_old = hmi_band;  // = hmi_band
 
@@ -1276,15 +1596,18 @@ void hmi_evaluate(void)  //hmi loop
       CwDecoder_array_in();
     }
 
+    if (band_vars[hmi_band][HMI_S_MODE] == MODE_SAM) {
+      hmi_sam_show();
+    }
+    else if (band_vars[hmi_band][HMI_S_MODE] == MODE_FM) {
+      hmi_fm_show();
+    }
+
     hmi_smeter();  //during RX, print Smeter on display only when ! CW decoding
 
 
-  } else /* TX */
-  {
-#if I2C_Arduino_Pro_Mini == 1  //using Arduino Pro Mini for relays control (and allow SWR reading)
-    hmi_power_swr();           //during TX, read the SWR, and print it on display
-#endif
   }
+  /* TX: power and SWR are read by hmi_swr_evaluate() */
 
 
   tx_enable_changed = false;  //signal to init values at display
@@ -1334,6 +1657,7 @@ void hmi_evaluate(void)  //hmi loop
         tft.print(s);
 
         tft.setFreeFont(FONT1);
+        hmi_vfo_show();
         tft_cursor_plus(3, TFT_BLUE, 0 + (band_vars[hmi_band][HMI_S_TUNE] > 4 ? band_vars[hmi_band][HMI_S_TUNE] + 1 : band_vars[hmi_band][HMI_S_TUNE]), 0, 0, 12);  // CURSOR
         break;
 
@@ -1368,6 +1692,23 @@ void hmi_evaluate(void)  //hmi loop
         sprintf(s, "Select trace");
         tft_writexy_(1, TFT_MAGENTA, TFT_BACKGROUND, 0, 0, (uint8_t *)s);
         break;
+      case HMI_S_VFO:
+        sprintf(s, "VFO:%s %s:%lu.%02lu  ", hmi_o_vfo[hmi_menu_opt_display], (hmi_menu_opt_display == HMI_VFO_B) ? "A" : "B",
+                hmi_freq_b / 1000, (hmi_freq_b % 1000) / 10);
+        tft_writexy_(1, TFT_MAGENTA, TFT_BACKGROUND, 0, 0, (uint8_t *)s);
+        break;
+      case HMI_S_RIT:
+        sprintf(s, "Set RIT: %+d Hz   ", hmi_menu_opt_display * HMI_RIT_STEP);
+        tft_writexy_(1, TFT_MAGENTA, TFT_BACKGROUND, 0, 0, (uint8_t *)s);
+        break;
+      case HMI_S_XIT:
+        sprintf(s, "Set XIT: %+d Hz   ", hmi_menu_opt_display * HMI_RIT_STEP);
+        tft_writexy_(1, TFT_MAGENTA, TFT_BACKGROUND, 0, 0, (uint8_t *)s);
+        break;
+      case HMI_S_SIG:
+        sprintf(s, "Signal: %u found   ", bm_nsig);
+        tft_writexy_(1, TFT_MAGENTA, TFT_BACKGROUND, 0, 0, (uint8_t *)s);
+        break;
 
         tft.setTextColor(TFT_MAGENTA, TFT_BLACK);
         tft.fillRect(0, 85, 160, 16, TFT_DARKPURPLE);  // update information panel
@@ -1387,16 +1728,11 @@ void hmi_evaluate(void)  //hmi loop
 
 
 
-  if (aud_samples_state == AUD_STATE_SAMP_RDY)  //design a new graphic only when data is ready
-  {
-    //plot audio graphic
-    display_aud_graf();
-
-    aud_samples_state = AUD_STATE_SAMP_IN;
-  }
+  //plot audio graphic (only when a new triggered capture is ready)
+  display_aud_graf();
 
 
-  CwDecoder_Loop();  //task on 100ms loop
+  CwDecoder_Loop();  //task on hmi loop (20ms)
 }
 
 
@@ -1419,6 +1755,113 @@ void print_current_mode(char *s) {
 
 //#################################################################################################//
 
+// Waterfall gestures: tap = tune to the bin (snap to the peak), horizontal drag = pan
+#define TOUCH_WF_Y_MIN     190   // waterfall area (touch y)
+#define TOUCH_DRAG_MIN     4     // x movement (pixels = FFT bins) to become a drag
+#define TOUCH_SNAP_BINS    2     // peak search +- bins around the tap
+#define TOUCH_SNAP_LINES   4     // recent waterfall lines summed for the peak search
+
+#define TOUCH_IDLE         0
+#define TOUCH_WF_DOWN      1     // touching the waterfall, not moved yet
+#define TOUCH_WF_DRAG      2
+
+uint8_t touch_state = TOUCH_IDLE;
+uint16_t touch_x_start, touch_x_last;
+
+
+/*
+ * FFT bin with the strongest signal near the tapped column
+ */
+uint16_t touch_snap_bin(uint16_t x) {
+  uint16_t b, best = x;
+  uint16_t level, level_best = 0;
+  int l;
+
+  for (b = (x > TOUCH_SNAP_BINS) ? (x - TOUCH_SNAP_BINS) : 1; (b <= x + TOUCH_SNAP_BINS) && (b < GRAPH_NUM_COLS - 1); b++) {
+    level = 0;
+    for (l = GRAPH_NUM_LINES - TOUCH_SNAP_LINES; l < GRAPH_NUM_LINES; l++)
+      level += vet_graf_fft[l][b];
+    if (level > level_best) {
+      level_best = level;
+      best = b;
+    }
+  }
+  return best;
+}
+
+
+/*
+ * set a new frequency from the waterfall, limited to the band
+ */
+void touch_set_freq(int32_t freq) {
+  hmi_freq = (uint32_t)constrain(freq, (int32_t)band_lower_limit[hmi_band], (int32_t)band_upper_limit[hmi_band]);
+
+  if (band_vars[hmi_band][HMI_S_TUNE] != 4) {
+    hmi_menu_opt_display = 4;
+    band_vars[hmi_band][HMI_S_TUNE] = hmi_menu_opt_display;  // set to 1KHz step
+  }
+}
+
+
+/*
+ * frequency of a waterfall bin: the waterfall is centred on the LO, RX = hmi_freq + RIT
+ */
+int32_t touch_bin_freq(uint16_t bin) {
+  return (int32_t)hmi_freq_lo + ((int32_t)bin - (int32_t)(GRAPH_NUM_COLS / 2)) * (int32_t)FRES
+         - (int8_t)band_vars[hmi_band][HMI_S_RIT] * HMI_RIT_STEP;
+}
+
+
+/*
+ * drag: the LO moves with the VFO (same DDC offset), so the spectrum follows the finger
+ */
+void touch_drag_freq(int32_t df) {
+  uint32_t f_old = hmi_freq;
+
+  touch_set_freq((int32_t)hmi_freq + df);
+  hmi_freq_lo += hmi_freq - f_old;  // the step left after the band limits
+}
+
+
+/*
+ * gesture state machine, called on each touch sample
+ * returns true when the touch was used by a gesture
+ */
+bool touch_gesture(bool touched) {
+  int16_t dx;
+
+  if (!touched) {  // released
+    if (touch_state == TOUCH_WF_DOWN) {  // tap: tune to the (snapped) bin
+      touch_set_freq(touch_bin_freq(touch_snap_bin(touch_x_start)));
+      touch_delay = 2;
+    }
+    touch_state = TOUCH_IDLE;
+    return false;
+  }
+
+  switch (touch_state) {
+    case TOUCH_IDLE:
+      if (toy <= TOUCH_WF_Y_MIN)
+        return false;  // not on waterfall
+      touch_state = TOUCH_WF_DOWN;
+      touch_x_start = touch_x_last = tox;
+      break;
+    case TOUCH_WF_DOWN:
+      dx = (int16_t)tox - (int16_t)touch_x_start;
+      if (dx > TOUCH_DRAG_MIN || dx < -TOUCH_DRAG_MIN)
+        touch_state = TOUCH_WF_DRAG;
+      else
+        break;
+      // fall through: move already as drag
+    case TOUCH_WF_DRAG:
+      dx = (int16_t)tox - (int16_t)touch_x_last;
+      touch_drag_freq(-(int32_t)dx * (int32_t)FRES);  // spectrum follows the finger
+      touch_x_last = tox;
+      break;
+  }
+  return true;
+}
+
 
 void touch_evaluate() {
   // uses raw touch functions with reduced sampling to save time.
@@ -1447,8 +1890,10 @@ void touch_evaluate() {
     delayMicroseconds(50);  // ADC settle time
   }
 
-  if (valid == 0)
+  if (valid == 0) {
+    touch_gesture(false);
     return;  // no touch
+  }
 
   // --- Median filter ---
   for (int i = 1; i < valid; i++) {
@@ -1478,6 +1923,9 @@ void touch_evaluate() {
   tox = x;
   toy = y;
 
+  if (touch_gesture(true))
+    return;  // waterfall gesture, no menu action
+
 
   //char s[30];
   // sprintf(s, " x%d  y%d", x, y);
@@ -43,8 +43,12 @@ extern "C" {
 #define HMI_S_BPF			5
 #define HMI_S_FFT			6
 #define HMI_S_OSC			7
+#define HMI_S_VFO			8
+#define HMI_S_RIT			9
+#define HMI_S_XIT			10
+#define HMI_S_SIG			11
 
-#define NUMBER_OF_MENUES			8  //number of possible menus
+#define NUMBER_OF_MENUES			12  //number of possible menus
 
 /* Event definitions */
 #define HMI_E_NOEVENT		0
@@ -74,18 +78,38 @@ extern "C" {
 */
 
 #define HMI_NUM_OPT_TUNE	8  // = amount of fields to position cursor, tune step
-#define HMI_NUM_OPT_MODE	5 // now 5 modes
+#define HMI_NUM_OPT_MODE	7 // now 7 modes
 #define HMI_NUM_OPT_AGC	3
 #define HMI_NUM_OPT_PRE	5
 #define HMI_NUM_OPT_VOX	4
+#define HMI_NUM_OPT_VFO	3
 
+//VFO menu: tuned VFO, split = RX on A, TX on B
+#define HMI_VFO_A      0
+#define HMI_VFO_B      1
+#define HMI_VFO_SPLIT  2
 
-//"USB","LSB","AM","CW"
+//RIT and XIT menus: offset stored in band_vars as signed steps
+#define HMI_RIT_STEP   10   //Hz
+#define HMI_RIT_MAX    120  //steps (+-1.2kHz)
+
+//DDC: RX = LO (Si5351) + digital offset, the LO only moves when the RX frequency leaves LO +- window
+#define HMI_DDC_WINDOW  20000  //Hz
+
+//SAM: carrier offset shown again when it moves more
+#define HMI_SAM_SHOW_HZ  2
+//FM: the offset is noisier (discriminator average)
+#define HMI_FM_SHOW_HZ   20
+
+
+//"USB","LSB","AM","AM2","CW","SAM","FM"
 #define MODE_USB  0
 #define MODE_LSB  1
 #define MODE_AM  2
 #define MODE_AM2  3
 #define MODE_CW   4
+#define MODE_SAM  5
+#define MODE_FM   6
 
 //#define USE_TOUCH_SCREEN
 #define BAND_RELATED_FFT_GAIN 32+ hmi_freq / 1000 / 250; // This increases fft_gain automatically when switching to a higher fband
@@ -121,6 +145,13 @@ extern uint8_t  band_vars[NUMBER_OF_BANDS][NUMBER_OF_MENUES];
 
 //extern uint8_t  hmi_sub[NUMBER_OF_MENUES];							// Stored option selection per state
 extern uint32_t hmi_freq;  
+extern uint32_t hmi_freq_lo;     // LO of the Si5351 for RX = center of the waterfall
+extern int32_t  hmi_ddc_offset;  // RX frequency - LO, done by the DDC
+extern bool     hmi_lo_recenter; // next hmi_setfreq() puts the LO on the RX frequency
+extern uint32_t band_starting_freq[NUMBER_OF_BANDS];
+extern const uint32_t band_lower_limit[NUMBER_OF_BANDS];
+extern const uint32_t band_upper_limit[NUMBER_OF_BANDS];
+extern uint32_t hmi_freq_b;  
 extern uint8_t  hmi_band;	
 extern bool tx_enabled;
 extern bool tx_enable_changed;
@@ -135,10 +166,15 @@ extern uint8_t sel_graph; // select scope graphics
 extern uint16_t tox, toy; // touch coordinates
 extern uint8_t touch_delay; // blocks touch for a while
 
+void Store_Last_Band(uint8_t band);
 void Setup_Band(uint8_t band);
 void hmi_init0(void);
 void hmi_init(void);
 void hmi_evaluate(void);
+void hmi_swr_evaluate(void);
+void hmi_callback(unsigned int gpio, uint32_t events);
+void hmi_event_put(uint8_t evt);
+void hmi_event_put_time(uint8_t evt, uint32_t time);
 void print_current_mode (char *s); 
 void print_Band(uint8_t band);
 void touch_evaluate(void);
@@ -0,0 +1,208 @@
+/*
+ * hmi_pio.cpp
+ *
+ * Created: Oct 2026
+ *
+ * Encoder and keys read by PIO, so there is no GPIO IRQ for each encoder edge or contact bounce.
+ * pio0 SM0: full quadrature decoder (program from pico-examples quadrature_encoder.pio), 
+ *      pushes the signed count continuously, read by hmi_pio_evaluate() from the main loop.
+ * pio1 SM0: key debouncer, samples the keys (pins 6..9) and PTT (pin 15), pushes the state only when it 
+ *      changed and stayed stable for the debounce time, one PIO IRQ per key change (RX FIFO not empty).
+ * The events are passed to the HMI event queue the same way as the GPIO IRQ does (hmi_callback).
+ */
+
+#include "Arduino.h"
+#include "hardware/pio.h"
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hmi.h"
+#include "hmi_pio.h"
+
+
+volatile uint32_t hmi_pio_keys = (1u << HMI_PIO_KEY_NUM) - 1u;   // all released
+volatile int32_t hmi_pio_count = 0;
+
+
+/*
+ * Quadrature encoder, must be loaded at offset 0 (computed jumps)
+ *  0-13  jump table indexed by (old AB, new AB)
+ *  14    decrement:  jmp y--, update
+ *  15    update:     mov isr, y       (wrap target)
+ *  16                push noblock
+ *  17                out isr, 2
+ *  18                in pins, 2
+ *  19                mov osr, isr
+ *  20                mov pc, isr
+ *  21    increment:  mov y, ~y
+ *  22                jmp y--, 23
+ *  23                mov y, ~y        (wrap)
+ */
+#define ENC_UPDATE     15
+#define ENC_WRAP       23
+static const uint16_t hmi_pio_enc_instr[] = 
+{
+	0x000f, 0x000e, 0x0015, 0x000f,		// state 00
+	0x0015, 0x000f, 0x000f, 0x000e,		// state 01
+	0x000e, 0x000f, 0x000f, 0x0015,		// state 10
+	0x000f, 0x0015,						// state 11 (partial)
+	0x008f,
+	0xa0c2,
+	0x8000,
+	0x60c2,
+	0x4002,
+	0xa0e6,
+	0xa0a6,
+	0xa04a,
+	0x0097,
+	0xa04a
+};
+static const struct pio_program hmi_pio_enc_prog = { hmi_pio_enc_instr, sizeof(hmi_pio_enc_instr)/sizeof(uint16_t), 0 };
+
+
+/*
+ * Key debouncer, X = last candidate state
+ * the pins 10..14 (TFT SPI and touch CS) are dropped, the state is (pins 6..9 << 1) | pin 15
+ *  0  top:  mov isr, null
+ *  1        in pins, 10
+ *  2        mov osr, isr
+ *  3        out isr, 4            pins 6..9
+ *  4        out null, 5           drop pins 10..14
+ *  5        in osr, 1             pin 15 (PTT)
+ *  6        mov y, isr
+ *  7        jmp x!=y, chk
+ *  8        jmp top       [31]    sampling period
+ *  9  chk:  mov x, y      [31]    new candidate, wait
+ *  10       nop           [31]    wait
+ *  11-17    same as 0-6           sample again
+ *  18       jmp x!=y, top         still bouncing
+ *  19       push noblock          stable: report (wrap)
+ */
+#define KEY_TOP        0
+#define KEY_WRAP       19
+static const uint16_t hmi_pio_key_instr[] = 
+{
+	0xa0c3,
+	0x400a,
+	0xa0e6,
+	0x60c4,
+	0x6065,
+	0x40e1,
+	0xa046,
+	0x00a9,
+	0x1f00,
+	0xbf22,
+	0xbf42,
+	0xa0c3,
+	0x400a,
+	0xa0e6,
+	0x60c4,
+	0x6065,
+	0x40e1,
+	0xa046,
+	0x00a0,
+	0x8000
+};
+static const struct pio_program hmi_pio_key_prog = { hmi_pio_key_instr, sizeof(hmi_pio_key_instr)/sizeof(uint16_t), -1 };
+
+
+/*
+ * PIO IRQ: a new stable key state, generate the edges like the GPIO IRQ
+ */
+void hmi_pio_irq(void)
+{
+	uint32_t keys, changed, bit;
+
+	while (!pio_sm_is_rx_fifo_empty(HMI_PIO_KEY, HMI_PIO_SM_KEY))
+	{
+		keys = pio_sm_get(HMI_PIO_KEY, HMI_PIO_SM_KEY);
+		changed = keys ^ hmi_pio_keys;
+		for (bit=0; bit<HMI_PIO_KEY_NUM; bit++)
+		{
+			if (changed & (1u<<bit))
+				hmi_callback((bit == 0) ? GP_PTT : (HMI_PIO_KEY_PIN + bit - 1), (keys & (1u<<bit)) ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL);
+		}
+		hmi_pio_keys = keys;
+	}
+}
+
+
+/*
+ * Load the programs and start the state machines
+ * enc_pin = encoder A, encoder B must be enc_pin+1
+ * The pins stay as SIO inputs with pull-up (set on hmi_init), PIO only reads them
+ */
+void hmi_pio_init(uint32_t enc_pin)
+{
+	pio_sm_config c;
+	uint offset;
+
+	// quadrature encoder at full speed
+	pio_add_program_at_offset(HMI_PIO_ENC, &hmi_pio_enc_prog, 0);
+	c = pio_get_default_sm_config();
+	sm_config_set_wrap(&c, ENC_UPDATE, ENC_WRAP);
+	sm_config_set_in_pins(&c, enc_pin);
+	sm_config_set_jmp_pin(&c, enc_pin);
+	sm_config_set_in_shift(&c, false, false, 32);		// shift left, no autopush
+	sm_config_set_out_shift(&c, true, false, 32);		// shift right, no autopull
+	sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_NONE);
+	sm_config_set_clkdiv(&c, 1.0f);
+	pio_sm_init(HMI_PIO_ENC, HMI_PIO_SM_ENC, ENC_UPDATE, &c);
+	pio_sm_set_enabled(HMI_PIO_ENC, HMI_PIO_SM_ENC, true);
+
+	// key debouncer at low speed
+	offset = pio_add_program(HMI_PIO_KEY, &hmi_pio_key_prog);
+	c = pio_get_default_sm_config();
+	sm_config_set_wrap(&c, offset + KEY_TOP, offset + KEY_WRAP);
+	sm_config_set_in_pins(&c, HMI_PIO_KEY_PIN);
+	sm_config_set_in_shift(&c, false, false, 32);		// shift left, no autopush
+	sm_config_set_out_shift(&c, true, false, 32);		// shift right, no autopull
+	sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
+	sm_config_set_clkdiv(&c, (float)clock_get_hz(clk_sys) / (float)HMI_PIO_KEY_CLK);
+	pio_sm_init(HMI_PIO_KEY, HMI_PIO_SM_KEY, offset + KEY_TOP, &c);	// X = 0: first stable state is reported
+	
+	pio_set_irq0_source_enabled(HMI_PIO_KEY, pis_sm0_rx_fifo_not_empty, true);
+	irq_set_exclusive_handler(HMI_PIO_KEY_IRQ, hmi_pio_irq);
+	irq_set_enabled(HMI_PIO_KEY_IRQ, true);
+	pio_sm_set_enabled(HMI_PIO_KEY, HMI_PIO_SM_KEY, true);
+}
+
+
+/*
+ * Encoder poll (main loop)
+ * The detents since the last poll are spread over the elapsed time, so the event queue
+ * keeps the spin speed for the acceleration
+ */
+void hmi_pio_evaluate(void)
+{
+	static int32_t count_used = 0;
+	static uint32_t time_last = 0;
+	uint32_t now, dt, save;
+	int32_t count, det, n, i;
+	uint n_fifo;
+
+	// the SM pushes all the time (push noblock drops when full), so the FIFO holds old counts:
+	// drain it and wait for the next push, that one is the actual count (as pico-examples does)
+	n_fifo = pio_sm_get_rx_fifo_level(HMI_PIO_ENC, HMI_PIO_SM_ENC) + 1;
+	while (n_fifo--)
+		count = (int32_t)pio_sm_get_blocking(HMI_PIO_ENC, HMI_PIO_SM_ENC);
+	hmi_pio_count = count;
+
+	now = time_us_32();
+	det = ((count - count_used) / HMI_PIO_ENC_COUNTS);	// full detents only, keep the rest for next time
+	if (det == 0) 
+	{
+		time_last = now;
+		return;
+	}
+	count_used += det * HMI_PIO_ENC_COUNTS;
+
+	n = (det > 0) ? det : -det;
+	dt = (now - time_last) / (uint32_t)n;
+	save = save_and_disable_interrupts();				// the key IRQ also puts events on the queue
+	for (i=1; i<=n; i++)
+		hmi_event_put_time((det * HMI_PIO_ENC_DIR > 0) ? HMI_E_INCREMENT : HMI_E_DECREMENT, time_last + (uint32_t)i * dt);
+	restore_interrupts(save);
+	time_last = now;
+}
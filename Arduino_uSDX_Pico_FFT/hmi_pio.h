@@ -0,0 +1,40 @@
+#ifndef __HMI_PIO_H__
+#define __HMI_PIO_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 
+ * hmi_pio.h
+ *
+ * Created: Oct 2026
+ *
+ * See hmi_pio.cpp for more information 
+ */
+
+
+#define HMI_USE_PIO_INPUT        // encoder and keys read by PIO (comment this line to use the GPIO edge IRQs)
+
+#define HMI_PIO_ENC           pio0   // quadrature program must be at offset 0 and takes 24 instructions
+#define HMI_PIO_KEY           pio1
+#define HMI_PIO_KEY_IRQ       PIO1_IRQ_0
+#define HMI_PIO_SM_ENC        0u     // quadrature encoder state machine
+#define HMI_PIO_SM_KEY        0u     // key debouncer state machine
+#define HMI_PIO_ENC_COUNTS    4      // quadrature counts per encoder detent
+#define HMI_PIO_ENC_DIR       (-1)   // 1 or -1, encoder direction: the program counts down when A falls with B high,
+                                     // the GPIO IRQ (ENCODER_CW_A_FALL_B_HIGH in hmi.cpp) takes that as increment
+#define HMI_PIO_KEY_PIN       6u     // pins sampled: 6..15, only 6..9 (Enter, Escape, Left, Right) and 15 (PTT) are used
+#define HMI_PIO_KEY_NUM       5u     // keys reported: bit 0 = PTT, bit 1..4 = pins 6..9
+#define HMI_PIO_KEY_CLK       10000u // key state machine clock (Hz): sampling every 4ms, debounce 7.4ms
+
+extern volatile uint32_t hmi_pio_keys;   // debounced keys (bit 0 = PTT, bit 1 = HMI_PIO_KEY_PIN), low = pressed
+extern volatile int32_t hmi_pio_count;   // encoder quadrature count
+
+void hmi_pio_init(uint32_t enc_pin);
+void hmi_pio_evaluate(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,391 @@
+/*
+ * i2c_async.cpp
+ *
+ * Created: Oct 2026
+ *
+ * Queued, interrupt driven I2C transactions, one queue per bus.
+ * The main loop only puts a transaction on the queue and returns, the I2C IRQ handler sends it:
+ *  - the commands (write bytes, then read commands after a repeated start) go to the TX FIFO,
+ *    refilled on TX_EMPTY when the transaction is longer than the FIFO
+ *  - STOP_DET ends the transaction (read bytes are taken from the RX FIFO), TX_ABRT marks it failed
+ *  - the next queued transaction is started from the IRQ
+ * i2ca_evaluate() (main loop task) checks the timeout of the transaction on the bus,
+ * and calls the completion callbacks in queue order, outside the IRQ.
+ * A queued write with the same key as a new one is replaced by the new data (only the last value is sent).
+ *
+ * A missing slave ends with an abort (NACK), a slave holding the bus ends with a timeout:
+ * the queue always moves on, nothing waits for the bus except i2ca_transfer() (monitor reads).
+ */
+
+#include "Arduino.h"
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "i2c_async.h"
+
+
+#define I2CA_FIFO			16		// TX and RX FIFO depth
+#define I2CA_WAIT_US		20000	// max wait for a free slot
+
+
+typedef struct
+{
+	i2c_inst_t *i2c;
+	bool init;
+	i2ca_trn_t trn[I2CA_QSIZE];
+	volatile uint8_t wr;			// next free slot (main loop)
+	volatile uint8_t run;			// slot on the bus, or next to send (IRQ)
+	volatile uint8_t rd;			// next slot to complete (main loop)
+	volatile bool busy;
+	uint8_t cmd;					// commands written to the TX FIFO
+	bool abrt;
+	bool in_cb;
+	uint32_t seq_wr;				// sequence number of the last transaction queued
+	volatile uint32_t seq_done;		// sequence number of the last transaction finished on the bus (IRQ)
+} i2ca_bus_t;
+
+static i2ca_bus_t i2ca_bus[I2CA_NBUS];
+i2ca_stat_t i2ca_stat[I2CA_NBUS];
+
+
+/*
+ * Write the commands of the transaction on the bus to the TX FIFO, as far as it has room
+ */
+static void i2ca_fill(i2ca_bus_t *b, i2c_hw_t *hw, i2ca_trn_t *t)
+{
+	uint8_t n = t->wlen + t->rlen;
+	uint32_t c;
+
+	while ((b->cmd < n) && (hw->txflr < I2CA_FIFO))
+	{
+		if (b->cmd < t->wlen)
+			c = t->wdata[b->cmd];
+		else
+		{
+			c = I2C_IC_DATA_CMD_CMD_BITS;									// read
+			if ((b->cmd == t->wlen) && (t->wlen > 0)) c |= I2C_IC_DATA_CMD_RESTART_BITS;
+		}
+		if (b->cmd == n-1) c |= I2C_IC_DATA_CMD_STOP_BITS;
+		hw->data_cmd = c;
+		b->cmd++;
+	}
+}
+
+/*
+ * Start the next queued transaction (IRQ, or main loop with interrupts disabled)
+ */
+static void i2ca_send(i2ca_bus_t *b)
+{
+	i2c_hw_t *hw = i2c_get_hw(b->i2c);
+	i2ca_trn_t *t;
+
+	if (b->run == b->wr)
+	{
+		b->busy = false;
+		hw->intr_mask = 0;
+		return;
+	}
+	t = &b->trn[b->run];
+	hw->enable = 0;
+	hw->tar = t->addr;
+	(void)hw->clr_intr;
+	hw->enable = I2C_IC_ENABLE_ENABLE_BITS;
+	b->cmd = 0;
+	b->abrt = false;
+	b->busy = true;
+	t->state = I2CA_BUSY;
+	t->start = time_us_32();
+	i2ca_fill(b, hw, t);
+	hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS |
+	                ((b->cmd < t->wlen + t->rlen) ? I2C_IC_INTR_MASK_M_TX_EMPTY_BITS : 0);
+}
+
+/*
+ * Transaction on the bus is finished, start the next one
+ */
+static void i2ca_next(i2ca_bus_t *b, i2ca_trn_t *t)
+{
+	uint32_t us = time_us_32() - t->start;
+	i2ca_stat_t *s = &i2ca_stat[b - i2ca_bus];
+
+	if (us > s->max_us) s->max_us = us;
+	t->state = I2CA_DONE;
+	b->seq_done = t->seq;
+	b->run = (b->run + 1) & I2CA_QMASK;
+	b->busy = false;
+	i2ca_send(b);
+}
+
+static void i2ca_irq(i2ca_bus_t *b)
+{
+	i2c_hw_t *hw = i2c_get_hw(b->i2c);
+	i2ca_trn_t *t = &b->trn[b->run];
+	uint32_t stat = hw->intr_stat;
+	uint8_t i;
+
+	if (stat & I2C_IC_INTR_STAT_R_TX_ABRT_BITS)					// the controller flushes the FIFO and sends STOP
+	{
+		i2ca_stat[b - i2ca_bus].abrt_source = hw->tx_abrt_source;
+		(void)hw->clr_tx_abrt;
+		b->abrt = true;
+		hw->intr_mask &= ~I2C_IC_INTR_MASK_M_TX_EMPTY_BITS;
+	}
+	if (stat & I2C_IC_INTR_STAT_R_STOP_DET_BITS)
+	{
+		(void)hw->clr_stop_det;
+		if (!b->busy) return;
+		if (b->abrt)
+			t->ret = I2CA_ERR_ABORT;
+		else
+		{
+			for (i=0; i<t->rlen; i++)
+				t->rdata[i] = (uint8_t)hw->data_cmd;
+			t->ret = t->wlen + t->rlen;
+		}
+		i2ca_next(b, t);
+		return;
+	}
+	if ((stat & I2C_IC_INTR_STAT_R_TX_EMPTY_BITS) && b->busy && !b->abrt)
+	{
+		i2ca_fill(b, hw, t);
+		if (b->cmd >= t->wlen + t->rlen)
+			hw->intr_mask &= ~I2C_IC_INTR_MASK_M_TX_EMPTY_BITS;
+	}
+}
+
+static void i2ca_irq0(void)
+{
+	i2ca_irq(&i2ca_bus[0]);
+}
+
+static void i2ca_irq1(void)
+{
+	i2ca_irq(&i2ca_bus[1]);
+}
+
+
+/*
+ * Timeout of the transaction on the bus (main loop)
+ * The controller is disabled, this drops the transfer; the next one enables it again
+ */
+static void i2ca_check(i2ca_bus_t *b)
+{
+	i2c_hw_t *hw = i2c_get_hw(b->i2c);
+	i2ca_trn_t *t;
+	uint32_t st;
+
+	st = save_and_disable_interrupts();
+	t = &b->trn[b->run];
+	if (b->busy && ((time_us_32() - t->start) > t->timeout))
+	{
+		hw->intr_mask = 0;
+		hw->enable = 0;
+		(void)hw->clr_intr;
+		t->ret = I2CA_ERR_TIMEOUT;
+		i2ca_next(b, t);
+	}
+	restore_interrupts(st);
+}
+
+/*
+ * Completion callbacks in queue order (main loop)
+ * The slot is freed before the callback, which gets a copy: a callback may queue a new transaction
+ */
+static void i2ca_complete(i2ca_bus_t *b)
+{
+	i2ca_stat_t *s = &i2ca_stat[b - i2ca_bus];
+	i2ca_trn_t t;
+
+	if (b->in_cb) return;
+	while ((b->rd != b->run) && (b->trn[b->rd].state == I2CA_DONE))
+	{
+		t = b->trn[b->rd];
+		b->trn[b->rd].state = I2CA_FREE;
+		b->rd = (b->rd + 1) & I2CA_QMASK;
+		if (t.ret == I2CA_ERR_ABORT) s->aborts++;
+		else if (t.ret == I2CA_ERR_TIMEOUT) s->timeouts++;
+		else s->done++;
+		if (t.cb != NULL)
+		{
+			b->in_cb = true;
+			t.cb(&t);
+			b->in_cb = false;
+		}
+	}
+}
+
+
+/*
+ * Put a transaction on the queue, returns the slot or I2CA_ERR_FULL
+ * When the queue is full, waits for a slot (bounded by the timeout of the transaction on the bus)
+ */
+static int i2ca_queue(uint8_t bus, uint8_t addr, const uint8_t *wdata, uint8_t wlen, uint8_t rlen, uint16_t key, uint32_t timeout, i2ca_cb_t cb, void *arg)
+{
+	i2ca_bus_t *b = &i2ca_bus[bus];
+	i2ca_trn_t *t;
+	uint32_t st, start;
+	uint8_t i;
+
+	if ((bus >= I2CA_NBUS) || !b->init) return I2CA_ERR_FULL;
+	if (wlen > I2CA_MAXLEN) wlen = I2CA_MAXLEN;
+	if (rlen > I2CA_MAXREAD) rlen = I2CA_MAXREAD;
+
+	if (key != 0)														// replace a write not sent yet
+	{
+		st = save_and_disable_interrupts();
+		for (i = b->busy ? ((b->run + 1) & I2CA_QMASK) : b->run; i != b->wr; i = (i + 1) & I2CA_QMASK)
+		{
+			t = &b->trn[i];
+			if ((t->key == key) && (t->state == I2CA_QUEUED) && (t->addr == addr) && (t->wlen == wlen) && (t->rlen == 0))
+			{
+				memcpy(t->wdata, wdata, wlen);
+				t->cb = cb;
+				t->arg = arg;
+				i2ca_stat[bus].coalesced++;
+				restore_interrupts(st);
+				return i;
+			}
+		}
+		restore_interrupts(st);
+	}
+
+	start = time_us_32();
+	while (((b->wr + 1) & I2CA_QMASK) == b->rd)
+	{
+		i2ca_check(b);
+		i2ca_complete(b);
+		if ((time_us_32() - start) > I2CA_WAIT_US)
+		{
+			i2ca_stat[bus].full++;
+			return I2CA_ERR_FULL;
+		}
+	}
+
+	i = b->wr;
+	t = &b->trn[i];
+	t->addr = addr;
+	t->wlen = wlen;
+	t->rlen = rlen;
+	t->key = key;
+	t->ret = 0;
+	t->timeout = timeout;
+	t->cb = cb;
+	t->arg = arg;
+	memcpy(t->wdata, wdata, wlen);
+	t->state = I2CA_QUEUED;
+
+	st = save_and_disable_interrupts();
+	t->seq = ++b->seq_wr;
+	b->wr = (i + 1) & I2CA_QMASK;
+	if (!b->busy) i2ca_send(b);
+	restore_interrupts(st);
+	return i;
+}
+
+
+/*
+ * Free slots >= n: the next n transactions are queued without waiting (may be called from an IRQ,
+ * which must not wait for a slot: that runs the completion callbacks)
+ */
+bool i2ca_room(uint8_t bus, uint8_t n)
+{
+	i2ca_bus_t *b = &i2ca_bus[bus];
+
+	if ((bus >= I2CA_NBUS) || !b->init) return false;
+	return ((I2CA_QSIZE - 1u) - ((uint8_t)(b->wr - b->rd) & I2CA_QMASK)) >= n;
+}
+
+
+/*
+ * Sequence number of the last transaction queued, and whether the bus is done with it
+ * (and so with all the ones before, the queue runs in order; failed ones count as done).
+ * i2ca_sent() reads only the state the I2C IRQ writes, it can be used in an IRQ without waiting
+ * for the completion callbacks of the main loop.
+ */
+uint32_t i2ca_last(uint8_t bus)
+{
+	return (bus < I2CA_NBUS) ? i2ca_bus[bus].seq_wr : 0;
+}
+
+bool i2ca_sent(uint8_t bus, uint32_t seq)
+{
+	return (bus >= I2CA_NBUS) || ((int32_t)(i2ca_bus[bus].seq_done - seq) >= 0);
+}
+
+
+/*
+ * Write len bytes, cb(t) is called when done (t->ret = len, or I2CA_ERR_*)
+ * key != 0: a queued write with the same key is replaced
+ */
+int i2ca_write(uint8_t bus, uint8_t addr, const uint8_t *data, uint8_t len, uint16_t key, i2ca_cb_t cb, void *arg)
+{
+	return i2ca_queue(bus, addr, data, len, 0, key, I2CA_TIMEOUT_US, cb, arg);
+}
+
+/*
+ * Write wlen bytes (may be 0), then read rlen bytes into t->rdata, cb(t) is called when done
+ */
+int i2ca_read(uint8_t bus, uint8_t addr, const uint8_t *wdata, uint8_t wlen, uint8_t rlen, i2ca_cb_t cb, void *arg)
+{
+	return i2ca_queue(bus, addr, wdata, wlen, rlen, 0, I2CA_TIMEOUT_US, cb, arg);
+}
+
+/*
+ * Blocking write and read, for the monitor: waits for the transactions queued before too
+ * Returns the bytes transferred or I2CA_ERR_*
+ */
+int i2ca_transfer(uint8_t bus, uint8_t addr, const uint8_t *wdata, uint8_t wlen, uint8_t *rdata, uint8_t rlen)
+{
+	i2ca_bus_t *b = &i2ca_bus[bus];
+	int i;
+
+	i = i2ca_queue(bus, addr, wdata, wlen, rlen, 0, I2CA_TIMEOUT_US, NULL, NULL);
+	if (i < 0) return i;
+	while (b->trn[i].state != I2CA_DONE)
+		i2ca_check(b);
+	if (b->trn[i].ret > 0)
+		memcpy(rdata, b->trn[i].rdata, (rlen > I2CA_MAXREAD) ? I2CA_MAXREAD : rlen);
+	return b->trn[i].ret;
+}
+
+
+/*
+ * Take over the I2C IRQ of the bus (the controller has been set up by Wire / i2c_init)
+ */
+void i2ca_init(uint8_t bus)
+{
+	i2ca_bus_t *b = &i2ca_bus[bus];
+	i2c_hw_t *hw;
+	uint irq;
+
+	if (bus >= I2CA_NBUS) return;
+	b->i2c = (bus == I2CA_BUS_SI) ? i2c0 : i2c1;
+	hw = i2c_get_hw(b->i2c);
+	hw->intr_mask = 0;
+	(void)hw->clr_intr;
+	b->wr = b->run = b->rd = 0;
+	b->busy = false;
+	b->in_cb = false;
+	memset(&i2ca_stat[bus], 0, sizeof(i2ca_stat_t));
+
+	irq = I2C0_IRQ + i2c_hw_index(b->i2c);
+	irq_set_exclusive_handler(irq, (bus == I2CA_BUS_SI) ? i2ca_irq0 : i2ca_irq1);
+	irq_set_enabled(irq, true);
+	b->init = true;
+}
+
+
+/*
+ * Main loop task: timeouts and completion callbacks
+ */
+void i2ca_evaluate(void)
+{
+	uint8_t bus;
+
+	for (bus=0; bus<I2CA_NBUS; bus++)
+	{
+		if (!i2ca_bus[bus].init) continue;
+		i2ca_check(&i2ca_bus[bus]);
+		i2ca_complete(&i2ca_bus[bus]);
+	}
+}
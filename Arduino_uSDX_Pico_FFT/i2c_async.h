@@ -0,0 +1,84 @@
+#ifndef __I2C_ASYNC_H__
+#define __I2C_ASYNC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * i2c_async.h
+ *
+ * Created: Oct 2026
+ *
+ * See i2c_async.cpp for more information
+ */
+
+
+#define I2CA_BUS_SI			0		// i2c0: Si5351
+#define I2CA_BUS_RELAY		1		// i2c1: BPF and RX relays, SWR
+#define I2CA_NBUS			2
+
+#define I2CA_QSIZE			16		// transactions per bus, power of 2
+#define I2CA_QMASK			(I2CA_QSIZE-1)
+#define I2CA_MAXLEN			20		// max bytes written in one transaction
+#define I2CA_MAXREAD		16		// max bytes read (RX FIFO depth)
+#define I2CA_TIMEOUT_US		5000	// default transaction timeout
+
+// transaction result (ret)
+#define I2CA_ERR_ABORT		-1		// NACK or arbitration lost (tx_abrt_source in the bus stats)
+#define I2CA_ERR_TIMEOUT	-2		// no STOP within the timeout
+#define I2CA_ERR_FULL		-3		// queue full
+
+#define I2CA_FREE			0
+#define I2CA_QUEUED			1
+#define I2CA_BUSY			2
+#define I2CA_DONE			3
+
+typedef struct i2ca_trn i2ca_trn_t;
+typedef void (*i2ca_cb_t)(i2ca_trn_t *t);
+
+struct i2ca_trn
+{
+	uint8_t  addr;
+	uint8_t  wlen;					// bytes written
+	uint8_t  rlen;					// bytes read after the write (repeated start)
+	volatile uint8_t state;
+	uint16_t key;					// coalescing key: a queued write with the same key is replaced (0 = none)
+	volatile int16_t ret;			// bytes transferred or I2CA_ERR_*
+	uint32_t timeout;				// us
+	uint32_t start;					// time_us_32() when sent
+	uint32_t seq;					// queue sequence number (i2ca_last / i2ca_sent)
+	i2ca_cb_t cb;					// called from i2ca_evaluate() (main loop), may be NULL
+	void    *arg;
+	uint8_t  wdata[I2CA_MAXLEN];
+	uint8_t  rdata[I2CA_MAXREAD];
+};
+
+typedef struct
+{
+	uint32_t done;					// transactions completed
+	uint32_t aborts;				// NACK / arbitration lost
+	uint32_t timeouts;
+	uint32_t coalesced;				// queued writes replaced by a newer value
+	uint32_t dropped;				// writes not sent because the value did not change (counted by the user)
+	uint32_t full;					// queue full
+	uint32_t lost;					// writes given up, the value is unknown (counted by the user)
+	uint32_t abrt_source;			// last tx_abrt_source
+	uint32_t max_us;				// longest transaction
+} i2ca_stat_t;
+
+extern i2ca_stat_t i2ca_stat[I2CA_NBUS];
+
+void i2ca_init(uint8_t bus);
+int  i2ca_write(uint8_t bus, uint8_t addr, const uint8_t *data, uint8_t len, uint16_t key, i2ca_cb_t cb, void *arg);
+int  i2ca_read(uint8_t bus, uint8_t addr, const uint8_t *wdata, uint8_t wlen, uint8_t rlen, i2ca_cb_t cb, void *arg);
+int  i2ca_transfer(uint8_t bus, uint8_t addr, const uint8_t *wdata, uint8_t wlen, uint8_t *rdata, uint8_t rlen);
+bool i2ca_room(uint8_t bus, uint8_t n);
+uint32_t i2ca_last(uint8_t bus);
+bool i2ca_sent(uint8_t bus, uint32_t seq);
+void i2ca_evaluate(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,250 @@
+/*
+ * memchan.cpp
+ *
+ * Created: Oct 2026
+ *
+ * Memory channels: frequency, band (BPF), mode, AGC and PRE, and a short name.
+ * The channels are kept in flash by the settings store (settings.cpp), one record per channel.
+ *
+ * Recall by number is a direct array access. For "next memory above/below" the channel numbers
+ * are kept in an index sorted by frequency (binary search), updated on every store/clear.
+ *
+ * A recall only writes band_vars and the frequency; hmi_evaluate() applies what differs from
+ * the current state (mode, AGC, PRE, VFO), Setup_Band() only runs when the band changes.
+ *
+ * Memory scan (mem_evaluate, main loop task) steps through the channels in frequency order:
+ * after the recall it waits MEM_SETTLE_MS, then takes the S-meter peak (max_a_sample) over
+ * MEM_LISTEN_MS. A quiet channel is skipped, on an active channel the scan stays until the
+ * signal is gone for MEM_HANG_MS. Tuning away or TX stops the scan.
+ */
+
+#include "Arduino.h"
+#include "uSDR.h"
+#include "hmi.h"
+#include "dsp.h"
+#include "memchan.h"
+
+
+#define MEM_S_STEP			0
+#define MEM_S_SETTLE		1
+#define MEM_S_LISTEN		2
+#define MEM_S_DWELL			3
+
+mem_chan_t mem_chan[MEM_NCHAN];
+static uint8_t mem_idx[MEM_NCHAN];					// channel numbers, sorted by frequency
+static uint8_t mem_nidx = 0;
+static int16_t mem_cur = -1;
+
+bool     mem_scanning = false;
+int16_t  mem_scan_level = MEM_LEVEL;
+static uint8_t  mem_state;
+static uint8_t  mem_pos;							// next position in mem_idx
+static uint32_t mem_t;
+static int16_t  mem_peak;
+
+
+/*
+ * First position in the index with a frequency >= f
+ */
+static uint8_t mem_lower(uint32_t f)
+{
+	uint8_t lo = 0, hi = mem_nidx, mid;
+
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (mem_chan[mem_idx[mid]].freq < f) lo = mid+1; else hi = mid;
+	}
+	return lo;
+}
+
+static void mem_idx_del(uint8_t n)
+{
+	uint8_t i;
+
+	for (i=0; i<mem_nidx; i++)
+		if (mem_idx[i] == n) break;
+	if (i == mem_nidx) return;
+	memmove(&mem_idx[i], &mem_idx[i+1], mem_nidx-i-1);
+	mem_nidx--;
+}
+
+static void mem_idx_ins(uint8_t n)
+{
+	uint8_t i = mem_lower(mem_chan[n].freq);
+
+	memmove(&mem_idx[i+1], &mem_idx[i], mem_nidx-i);
+	mem_idx[i] = n;
+	mem_nidx++;
+}
+
+
+/*
+ * Build the index from the channels restored from flash, drop invalid ones
+ */
+void mem_init(void)
+{
+	uint8_t n;
+	mem_chan_t *c;
+
+	mem_nidx = 0;
+	for (n=0; n<MEM_NCHAN; n++)
+	{
+		c = &mem_chan[n];
+		if (c->freq == 0) continue;
+		if ((MEM_BAND(c) >= NUMBER_OF_BANDS) || (MEM_MODE(c) >= HMI_NUM_OPT_MODE) ||
+		    (MEM_AGC(c) >= HMI_NUM_OPT_AGC) || (MEM_PRE(c) >= HMI_NUM_OPT_PRE))
+		{
+			memset(c, 0, sizeof(mem_chan_t));
+			continue;
+		}
+		mem_idx_ins(n);
+	}
+}
+
+bool mem_store(uint8_t n, const char *name)
+{
+	mem_chan_t *c;
+
+	if (n >= MEM_NCHAN) return false;
+	c = &mem_chan[n];
+	if (c->freq != 0) mem_idx_del(n);
+	c->freq = hmi_freq;
+	c->bm = MEM_BM(hmi_band, band_vars[hmi_band][HMI_S_MODE]);
+	c->ap = MEM_AP(band_vars[hmi_band][HMI_S_AGC], band_vars[hmi_band][HMI_S_PRE]);
+	memset(c->name, 0, MEM_NAMELEN);
+	if (name != NULL) strncpy(c->name, name, MEM_NAMELEN);
+	mem_idx_ins(n);
+	mem_cur = n;
+	return true;
+}
+
+void mem_clear(uint8_t n)
+{
+	if ((n >= MEM_NCHAN) || (mem_chan[n].freq == 0)) return;
+	mem_idx_del(n);
+	memset(&mem_chan[n], 0, sizeof(mem_chan_t));
+	if (mem_cur == n) mem_cur = -1;
+}
+
+/*
+ * Only band_vars and the frequency are written, hmi_evaluate() applies the differences
+ */
+bool mem_recall(uint8_t n)
+{
+	mem_chan_t *c;
+	uint8_t band;
+
+	if ((n >= MEM_NCHAN) || (mem_chan[n].freq == 0)) return false;
+	c = &mem_chan[n];
+	band = MEM_BAND(c);
+	band_vars[band][HMI_S_MODE] = MEM_MODE(c);
+	band_vars[band][HMI_S_AGC] = MEM_AGC(c);
+	band_vars[band][HMI_S_PRE] = MEM_PRE(c);
+	if (band != hmi_band)
+	{
+		band_starting_freq[band] = c->freq;				// Setup_Band() starts the new band here
+		hmi_band = band;
+	}
+	else
+		hmi_freq = c->freq;
+	mem_cur = n;
+	return true;
+}
+
+int mem_next(bool up)
+{
+	uint8_t i;
+
+	if (mem_nidx == 0) return -1;
+	if (up)
+	{
+		i = mem_lower(hmi_freq + 1);
+		if (i >= mem_nidx) i = 0;							// wrap
+	}
+	else
+	{
+		i = mem_lower(hmi_freq);
+		i = (i == 0) ? mem_nidx-1 : i-1;
+	}
+	return mem_idx[i];
+}
+
+int mem_current(void)
+{
+	return mem_cur;
+}
+
+uint8_t mem_count(void)
+{
+	return mem_nidx;
+}
+
+uint8_t mem_sorted(uint8_t i)
+{
+	return mem_idx[i];
+}
+
+
+/*
+ * Scan: starts with the first channel above the current frequency
+ */
+void mem_scan(bool on)
+{
+	mem_scanning = on && (mem_nidx > 0);
+	if (!mem_scanning) return;
+	mem_pos = mem_lower(hmi_freq + 1);
+	mem_state = MEM_S_STEP;
+}
+
+void mem_evaluate(void)
+{
+	uint32_t now = millis();
+	int16_t a;
+
+	if (!mem_scanning) return;
+	if (tx_enabled || (mem_nidx == 0))
+	{
+		mem_scanning = false;
+		return;
+	}
+	if ((mem_state >= MEM_S_LISTEN) && (mem_cur >= 0) && (hmi_freq != mem_chan[mem_cur].freq))
+	{
+		mem_scanning = false;									// tuned away
+		return;
+	}
+
+	a = max_a_sample;
+	switch (mem_state)
+	{
+	case MEM_S_STEP:
+		if (mem_pos >= mem_nidx) mem_pos = 0;
+		mem_recall(mem_idx[mem_pos++]);
+		mem_t = now;
+		mem_state = MEM_S_SETTLE;
+		break;
+	case MEM_S_SETTLE:
+		if ((now - mem_t) < MEM_SETTLE_MS) break;
+		mem_peak = 0;
+		mem_t = now;
+		mem_state = MEM_S_LISTEN;
+		break;
+	case MEM_S_LISTEN:
+		if (a > mem_peak) mem_peak = a;
+		if ((now - mem_t) < MEM_LISTEN_MS) break;
+		if (mem_peak >= mem_scan_level)
+		{
+			mem_t = now;
+			mem_state = MEM_S_DWELL;
+		}
+		else
+			mem_state = MEM_S_STEP;								// quiet: skip
+		break;
+	case MEM_S_DWELL:
+		if (a >= mem_scan_level)
+			mem_t = now;
+		else if ((now - mem_t) >= MEM_HANG_MS)
+			mem_state = MEM_S_STEP;
+		break;
+	}
+}
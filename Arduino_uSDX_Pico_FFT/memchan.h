@@ -0,0 +1,61 @@
+#ifndef __MEMCHAN_H__
+#define __MEMCHAN_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * memchan.h
+ *
+ * Created: Oct 2026
+ *
+ * See memchan.cpp for more information
+ */
+
+
+#define MEM_NCHAN			200
+#define MEM_NAMELEN			6		// not 0 terminated when all 6 are used
+
+/* Channel options, packed to keep a channel in one settings record (12 bytes) */
+#define MEM_BM(band,mode)	((uint8_t)(((band)<<4) | (mode)))
+#define MEM_BAND(c)			((c)->bm >> 4)
+#define MEM_MODE(c)			((c)->bm & 0x0f)
+#define MEM_AP(agc,pre)		((uint8_t)(((agc)<<4) | (pre)))
+#define MEM_AGC(c)			((c)->ap >> 4)
+#define MEM_PRE(c)			((c)->ap & 0x0f)
+
+typedef struct
+{
+	uint32_t freq;					// Hz, 0 = empty channel
+	uint8_t  bm;					// band (band_vars row, selects the BPF) and mode
+	uint8_t  ap;					// AGC and PRE option
+	char     name[MEM_NAMELEN];
+} mem_chan_t;
+
+extern mem_chan_t mem_chan[MEM_NCHAN];
+
+/* Scan */
+#define MEM_SETTLE_MS		150		// after the recall: relays, VFO and AGC
+#define MEM_LISTEN_MS		250		// S-meter peak over this time decides skip or stop
+#define MEM_HANG_MS			2000	// stays this long after the signal is gone
+#define MEM_LEVEL			9		// default scan level (max_a_sample, ~S4)
+
+extern bool     mem_scanning;
+extern int16_t  mem_scan_level;
+
+void mem_init(void);
+bool mem_store(uint8_t n, const char *name);		// current frequency and options to channel n
+void mem_clear(uint8_t n);
+bool mem_recall(uint8_t n);
+int  mem_next(bool up);								// next channel above/below hmi_freq, -1 = none
+int  mem_current(void);								// channel of the last recall/scan, -1 = none
+uint8_t mem_count(void);
+uint8_t mem_sorted(uint8_t i);						// channel number of the i-th lowest frequency
+void mem_scan(bool on);
+void mem_evaluate(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
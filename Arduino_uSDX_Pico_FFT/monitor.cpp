@@ -38,6 +38,16 @@
 #include "relay.h"
 #include "monitor.h"
 #include "uSDR.h"
+#include "TFT_eSPI.h"
+#include "display_tft.h"
+#include "sched.h"
+#include "i2c_async.h"
+#include "settings.h"
+#include "memchan.h"
+#include "bandscan.h"
+#include "bandmap.h"
+#include "skimmer.h"
+#include "CwDecoder.h"
 
 
 #define CR			13
@@ -177,17 +187,424 @@ void mon_rx(void)
 	
 }
 
+/*
+ * Scope trigger and capture setup
+ */
+void mon_sc(void)
+{
+	if (nargs>=6)
+	{
+		dsp_scope_set((uint8_t)atoi(argv[1]), (int16_t)atoi(argv[2]), (*argv[3]=='r')?AUD_TRIG_RISE:AUD_TRIG_FALL,
+		              (uint16_t)atoi(argv[4]), (uint16_t)atoi(argv[5]));
+	}
+	else if ((nargs>=2) && (strncmp(argv[1], "off", 3) == 0))
+	{
+		dsp_scope_set(aud_trig_var, aud_trig_level, aud_trig_slope, aud_pretrig, 0);
+	}
+	Serialx.println("trig var " + String(aud_trig_var) + "  level " + String(aud_trig_level) +
+	                "  slope " + String((aud_trig_slope==AUD_TRIG_RISE)?"r":"f") +
+	                "  pretrig " + String(aud_pretrig) + "  decim " + String(aud_decim));
+}
+
+/*
+ * Screen snapshot, binary RLE frame (see display_tft_snapshot), decode with Aux/snapshot_decoder.py
+ */
+void mon_ss(void)
+{
+	display_tft_snapshot();
+}
+
+/*
+ * Main loop task statistics
+ */
+void mon_ts(void)
+{
+	uint8_t i;
+
+	if ((nargs>=2) && (*argv[1]=='r'))
+	{
+		sched_reset();
+		Serialx.println("task statistics cleared");
+		return;
+	}
+	Serialx.println("task   period prio       runs   misses  wcet_us  last_us");
+	for (i=0; i<sched_ntasks; i++)
+	{
+		char s[80];
+		sprintf(s, "%-6s %6u %4u %10lu %8lu %8lu %8lu", sched_task[i].name, sched_task[i].period, sched_task[i].prio,
+		        (unsigned long)sched_task[i].runs, (unsigned long)sched_task[i].misses,
+		        (unsigned long)sched_task[i].wcet, (unsigned long)sched_task[i].last);
+		Serialx.println(s);
+	}
+}
+
+/*
+ * Si5351 tuning plan of the band and PLL reset time
+ */
+void mon_pl(void)
+{
+	uint8_t i;
+
+	for (i=0; i<si_plan_nseg; i++)
+		Serialx.println(String(si_plan[i].f_lo) + " - " + String(si_plan[i].f_hi) + "  MSi " + String(si_plan[i].msi) + "  Ri " + String(si_plan[i].ri));
+	Serialx.println("PLL resets " + String(si_reset_count) + "  last " + String(si_reset_us) + "us  max " + String(si_reset_us_max) + "us");
+}
+
+/*
+ * VFO A/B, split, RIT/XIT, LO/DDC offset and the prepared Si5351 RX/TX images
+ */
+void mon_vf(void)
+{
+	uint8_t i;
+
+	Serialx.println("VFO " + String(hmi_freq) + "  other " + String(hmi_freq_b) + "  " + String(band_vars[hmi_band][HMI_S_VFO]==HMI_VFO_SPLIT?"split":"simplex") +
+	                "  RIT " + String((int8_t)band_vars[hmi_band][HMI_S_RIT] * HMI_RIT_STEP) + "  XIT " + String((int8_t)band_vars[hmi_band][HMI_S_XIT] * HMI_RIT_STEP));
+	Serialx.println("LO " + String(hmi_freq_lo) + "  DDC " + String(hmi_ddc_offset) + "Hz  window +-" + String(HMI_DDC_WINDOW) + "Hz");
+	for (i=0; i<2; i++)
+		Serialx.println(String(i==SI_IMG_RX?"RX ":"TX ") + String(si_img[i].freq) + "  MSi " + String(si_img[i].msi) + "  Ri " + String(si_img[i].ri) +
+		                "  MSN " + String(si_img[i].msn_a) + "+" + String(si_img[i].msn_b) + "/1000000" + (i==si_img_sel?"  *":""));
+	Serialx.println("RX/TX switch last " + String(si_txrx_us) + "us  max " + String(si_txrx_us_max) + "us");
+}
+
+/*
+ * RIT and XIT offset (Hz), in HMI_RIT_STEP units
+ */
+void mon_it(uint8_t menu)
+{
+	int32_t steps;
+
+	if (nargs>=2)
+	{
+		steps = atoi(argv[1]) / HMI_RIT_STEP;
+		if (steps > HMI_RIT_MAX) steps = HMI_RIT_MAX;
+		if (steps < -HMI_RIT_MAX) steps = -HMI_RIT_MAX;
+		band_vars[hmi_band][menu] = (uint8_t)(int8_t)steps;		// hmi_evaluate() sets the frequencies
+	}
+	Serialx.println(String((menu==HMI_S_RIT)?"RIT ":"XIT ") + String((int8_t)band_vars[hmi_band][menu] * HMI_RIT_STEP) + "Hz");
+}
+
+void mon_rt(void)
+{
+	mon_it(HMI_S_RIT);
+}
+
+void mon_xt(void)
+{
+	mon_it(HMI_S_XIT);
+}
+
+/*
+ * Async I2C statistics per bus
+ */
+void mon_ic(void)
+{
+	uint8_t i;
+
+	Serialx.println("bus       done  aborts timeouts coalesc dropped  full  lost  max_us  abrt_src");
+	for (i=0; i<I2CA_NBUS; i++)
+	{
+		char s[100];
+		sprintf(s, "%-6s %7lu %7lu %8lu %7lu %7lu %5lu %5lu %7lu  %08lx", (i==I2CA_BUS_SI)?"si":"relay",
+		        (unsigned long)i2ca_stat[i].done, (unsigned long)i2ca_stat[i].aborts, (unsigned long)i2ca_stat[i].timeouts,
+		        (unsigned long)i2ca_stat[i].coalesced, (unsigned long)i2ca_stat[i].dropped, (unsigned long)i2ca_stat[i].full,
+		        (unsigned long)i2ca_stat[i].lost,		        (unsigned long)i2ca_stat[i].max_us, (unsigned long)i2ca_stat[i].abrt_source);
+		Serialx.println(s);
+	}
+}
+
+/*
+ * Settings store: statistics, w = write the changed settings now, e = erase (defaults at next boot)
+ */
+void mon_st(void)
+{
+	if ((nargs>=2) && (*argv[1]=='w'))
+	{
+		set_write();
+		Serialx.println("settings written");
+	}
+	else if ((nargs>=2) && (*argv[1]=='e'))
+	{
+		set_erase();
+		Serialx.println("settings erased");
+	}
+	Serialx.println("block " + String(set_stat.block) + "  seq " + String(set_stat.seq) + "  used " + String(set_stat.used) + " records");
+	Serialx.println("writes " + String(set_stat.writes) + "  records " + String(set_stat.records) + "  erases " + String(set_stat.erases));
+	Serialx.println("restore " + String(set_stat.restore_us) + "us  longest write " + String(set_stat.write_us) + "us");
+}
+
+/*
+ * Memory channels
+ */
+void mon_mw(void)
+{
+	if (nargs<2) return;
+	if (mem_store(atoi(argv[1]), (nargs>=3)?argv[2]:NULL))
+		Serialx.println("M" + String(atoi(argv[1])) + " " + String(hmi_freq));
+}
+
+void mon_mr(void)
+{
+	int n;
+
+	if (nargs<2) return;
+	if ((*argv[1]=='+') || (*argv[1]=='-'))
+		n = mem_next(*argv[1]=='+');
+	else
+		n = atoi(argv[1]);
+	if ((n < 0) || !mem_recall(n))
+		Serialx.println("empty");
+	else
+		Serialx.println("M" + String(n) + " " + String(mem_chan[n].freq));
+}
+
+void mon_md(void)
+{
+	if (nargs>=2) mem_clear(atoi(argv[1]));
+}
+
+void mon_ml(void)
+{
+	uint8_t i, n;
+	char s[60], name[MEM_NAMELEN+1];
+
+	Serialx.println("  ch      freq band mode agc pre name");
+	for (i=0; i<mem_count(); i++)
+	{
+		n = mem_sorted(i);
+		memset(name, 0, sizeof(name));
+		strncpy(name, mem_chan[n].name, MEM_NAMELEN);
+		sprintf(s, "%c%3u %9lu %4u %4u %3u %3u %s", (n==mem_current())?'*':' ', n, (unsigned long)mem_chan[n].freq,
+		        MEM_BAND(&mem_chan[n]), MEM_MODE(&mem_chan[n]), MEM_AGC(&mem_chan[n]), MEM_PRE(&mem_chan[n]), name);
+		Serialx.println(s);
+	}
+}
+
+void mon_ms(void)
+{
+	if ((nargs>=2) && (strncmp(argv[1], "off", 3)==0))
+		mem_scan(false);
+	else
+	{
+		if (nargs>=2) mem_scan_level = atoi(argv[1]);
+		mem_scan(true);
+	}
+	Serialx.println(String(mem_scanning?"scan on":"scan off") + "  level " + String(mem_scan_level));
+}
+
+/*
+ * Band scan with the FFT
+ */
+void mon_bs(void)
+{
+	if ((nargs>=2) && (strncmp(argv[1], "off", 3)==0))
+		bs_stop();
+	else if (nargs>=3)
+	{
+		mem_scan(false);
+		bs_start(1000UL*atol(argv[1]), 1000UL*atol(argv[2]));
+	}
+	else
+	{
+		mem_scan(false);
+		bs_start(band_lower_limit[hmi_band], band_upper_limit[hmi_band]);
+	}
+	Serialx.println(bs_scanning?"scanning":"scan off");
+}
+
+void mon_bn(void)
+{
+	int n;
+
+	n = bs_next((nargs<2) || (*argv[1]!='-'));
+	if (n < 0)
+		Serialx.println("no signals");
+	else
+		Serialx.println("S" + String(n) + " " + String(bs_sig[n].freq));
+}
+
+void mon_bl(void)
+{
+	uint8_t i;
+	uint32_t now = millis();
+	char s[60];
+
+	Serialx.println(String(bs_scanning?"scanning":"last scan") + "  steps " + String(bs_steps) + "  " + String(bs_ms) + "ms  signals " + String(bs_nsig));
+	Serialx.println("  nr      freq level floor  age(s)");
+	for (i=0; i<bs_nsig; i++)
+	{
+		sprintf(s, "%c%3u %9lu %5u %5u %7lu", (bs_sig[i].freq==hmi_freq)?'*':' ', i, (unsigned long)bs_sig[i].freq,
+		        bs_sig[i].level, bs_sig[i].noise, (unsigned long)((now - bs_sig[i].time)/1000));
+		Serialx.println(s);
+	}
+}
+
+/*
+ * Band map of the waterfall span
+ */
+void mon_bm(void)
+{
+	uint8_t i;
+	uint32_t now = millis();
+	char s[60];
+	int n;
+
+	if (nargs>=2)
+	{
+		n = bm_next(*argv[1]!='-');
+		if (n < 0)
+			Serialx.println("no signals");
+		else
+			Serialx.println("S" + String(n) + " " + String(bm_sig[n].freq));
+		return;
+	}
+	Serialx.println("  nr      freq  bin level duty  age(s) last(s)");
+	for (i=0; i<bm_nsig; i++)
+	{
+		sprintf(s, "%c%3u %9lu %4d %5u %4u %7lu %7lu", (bm_sig[i].freq==hmi_freq)?'*':' ', i, (unsigned long)bm_sig[i].freq,
+		        bm_sig[i].bin, bm_sig[i].level, bm_sig[i].duty,
+		        (unsigned long)((now - bm_sig[i].first)/1000), (unsigned long)((now - bm_sig[i].last)/1000));
+		Serialx.println(s);
+	}
+}
+
+/*
+ * Second receiver
+ */
+void mon_r2(void)
+{
+	uint8_t i;
+
+	if ((nargs>=2) && (strncmp(argv[1], "off", 3)==0))
+		rx2_freq = 0;
+	else if (nargs>=2)
+	{
+		rx2_freq = (uint32_t)(1000.0*atof(argv[1]));
+		for (i=2; i<nargs; i++)
+		{
+			if (strcmp(argv[i], "usb")==0) rx2_mode = MODE_USB;
+			else if (strcmp(argv[i], "lsb")==0) rx2_mode = MODE_LSB;
+			else if (strcmp(argv[i], "am")==0) rx2_mode = MODE_AM;
+			else if (strcmp(argv[i], "mix")==0) rx2_out = RX2_OUT_MIX;
+			else if (strcmp(argv[i], "solo")==0) rx2_out = RX2_OUT_SOLO;
+		}
+	}
+	dsp_rx2_tune(hmi_freq_lo);
+	if (rx2_on)
+		Serialx.println("RX2 " + String(rx2_freq) + "  " + String(rx2_mode==MODE_USB?"usb":(rx2_mode==MODE_AM?"am":"lsb")) +
+		                "  " + String(rx2_out==RX2_OUT_SOLO?"solo":"mix") + "  LO " + String(hmi_freq_lo));
+	else if (rx2_freq == 0)
+		Serialx.println("RX2 off");
+	else
+		Serialx.println("RX2 " + String(rx2_freq) + " outside the span, LO " + String(hmi_freq_lo));
+}
+
+/*
+ * CW skimmer
+ */
+void mon_sk(void)
+{
+	uint8_t n;
+	sk_ch_t *ch;
+	char s[80];
+
+	if (nargs>=2)
+		sk_enable(strncmp(argv[1], "on", 2)==0);
+	Serialx.println("CW skimmer " + String(sk_on?"on":"off") + " buffers dropped " + String(sk_drops));
+	for (n=0; n<SK_NCH; n++)
+	{
+		ch = &sk_ch[n];
+		if (ch->freq == 0) continue;
+		sprintf(s, "%u %9lu %3u wpm %-7s %s", n, (unsigned long)ch->freq,
+		        (ch->dec.tdot > 0) ? 1200/(ch->dec.tdot*5/2) : 0, ch->call, ch->text);
+		Serialx.println(s);
+	}
+}
+
+/*
+ * CW pitch of the decoder (Goertzel)
+ */
+void mon_cw(void)
+{
+	if ((nargs>=2) && (strncmp(argv[1], "auto", 4)==0))
+		cw_pitch_auto = true;
+	else if (nargs>=2)
+	{
+		cw_pitch_auto = false;
+		cw_pitch_set((uint16_t)atoi(argv[1]));
+	}
+	Serialx.println("CW pitch " + String(cw_pitch) + " Hz " + String(cw_pitch_auto?"auto":"fixed") +
+	                "  (" + String(CW_PITCH_MIN) + "-" + String(CW_PITCH_MAX) + ")");
+	Serialx.println("CW frames waiting " + String((cw_ring_wr - cw_ring_rd) & CW_RING_MASK) +
+	                " dropped " + String(cw_ring_drops));
+}
+
+/*
+ * Synchronous AM: sideband and PLL state
+ */
+void mon_sa(void)
+{
+	if (nargs>=2)
+	{
+		if (strcmp(argv[1], "dsb")==0) sam_sb = SAM_DSB;
+		else if (strcmp(argv[1], "usb")==0) sam_sb = SAM_USB;
+		else if (strcmp(argv[1], "lsb")==0) sam_sb = SAM_LSB;
+	}
+	Serialx.println("SAM " + String(sam_sb==SAM_USB?"usb":(sam_sb==SAM_LSB?"lsb":"dsb")) +
+	                String(sam_lock?"  lock  offset ":"  unlock  offset ") + String(sam_offset()) + " Hz" +
+	                String(dsp_getmode()==MODE_SAM?"":"  (mode is not SAM)"));
+}
+
+/*
+ * FM: squelch level, state and carrier offset
+ */
+void mon_fm(void)
+{
+	int sql;
+
+	if (nargs>=2)
+	{
+		sql = atoi(argv[1]);
+		if ((sql >= 0) && (sql <= FM_SQL_MAX)) fm_sql = sql;
+	}
+	Serialx.println("FM sql " + String(fm_sql) + String(fm_open?"  open":"  closed") +
+	                "  noise " + String(fm_noise()) + "  offset " + String(fm_offset()) + " Hz" +
+	                String(dsp_getmode()==MODE_FM?"":"  (mode is not FM)"));
+}
+
 /*
  * Command shell table, organize the command functions above
  */
-#define NCMD	6
+#define NCMD	28
 shell_t shell[NCMD]=
 {
 	{"si", 2, &mon_si, "si <start> <nr of reg>", "Dumps Si5351 registers"},
 	{"lt", 2, &mon_lt, "lt (no parameters)", "LCD test, dumps characterset on LCD"},
 	{"pt", 2, &mon_pt, "pt (no parameters)", "Toggles PTT status"},
 	{"bp", 2, &mon_bp, "bp {r|w} <value>", "Read or Write BPF relays"},
-	{"rx", 2, &mon_rx, "rx {r|w} <value>", "Read or Write RX relays"}
+	{"rx", 2, &mon_rx, "rx {r|w} <value>", "Read or Write RX relays"},
+	{"sc", 2, &mon_sc, "sc [<var 0-5> <level> {r|f} <pretrig> <decim>] | [off]", "Scope trigger and capture setup"},
+	{"ss", 2, &mon_ss, "ss (no parameters)", "Screen snapshot, binary RLE RGB565"},
+	{"ts", 2, &mon_ts, "ts [r]", "Task statistics (period 0 = on event), r = reset"},
+	{"pl", 2, &mon_pl, "pl (no parameters)", "Si5351 tuning plan (Fout) and PLL reset time"},
+	{"vf", 2, &mon_vf, "vf (no parameters)", "VFO A/B, split, RIT/XIT, LO/DDC and Si5351 RX/TX images"},
+	{"rt", 2, &mon_rt, "rt [<Hz>]", "Read or set RIT offset"},
+	{"xt", 2, &mon_xt, "xt [<Hz>]", "Read or set XIT offset"},
+	{"ic", 2, &mon_ic, "ic (no parameters)", "Async I2C statistics per bus"},
+	{"st", 2, &mon_st, "st [w|e]", "Settings store statistics, w = write now, e = erase"},
+	{"mw", 2, &mon_mw, "mw <ch> [<name>]", "Store frequency, band, mode, AGC and PRE in memory channel"},
+	{"mr", 2, &mon_mr, "mr {<ch>|+|-}", "Recall memory channel, +/- = next memory above/below"},
+	{"md", 2, &mon_md, "md <ch>", "Delete memory channel"},
+	{"ml", 2, &mon_ml, "ml (no parameters)", "List memory channels by frequency"},
+	{"ms", 2, &mon_ms, "ms [<level>|off]", "Memory scan, skips channels below the S-meter level"},
+	{"bs", 2, &mon_bs, "bs [<from kHz> <to kHz>|off]", "Band scan with the FFT, default the current band"},
+	{"bn", 2, &mon_bn, "bn [+|-]", "Tune to the next scanned signal above/below"},
+	{"bl", 2, &mon_bl, "bl (no parameters)", "List the scanned signals"},
+	{"bm", 2, &mon_bm, "bm [+|-]", "List the band map of the waterfall span, +/- = tune to the next signal"},
+	{"r2", 2, &mon_r2, "r2 [<kHz> [usb|lsb|am] [mix|solo]|off]", "Second receiver inside the waterfall span"},
+	{"sk", 2, &mon_sk, "sk [on|off]", "CW skimmer of the band map signals, list of the channels"},
+	{"cw", 2, &mon_cw, "cw [<Hz>|auto]", "CW decoder pitch (fixed or acquired from the strongest tone), level frames"},
+	{"sa", 2, &mon_sa, "sa [dsb|usb|lsb]", "Synchronous AM sideband, PLL lock and carrier offset"},
+	{"fm", 2, &mon_fm, "fm [<squelch 0-9>]", "FM squelch (0 = open), noise level and carrier offset"}
 };
 
 
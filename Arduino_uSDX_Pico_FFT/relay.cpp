@@ -42,28 +42,64 @@
 
 #include "relay.h"
 #include "uSDR.h"
+#include "i2c_async.h"
 
 
+/*
+ * The relay writes are queued on the async I2C engine (i2c_async.cpp):
+ * a value equal to the last one is not sent, a newer value replaces a queued one.
+ * A failed write is sent once more, if that fails too (or it finds the queue full) the value is unknown
+ * and the next set is sent anyway.
+ */
+typedef struct
+{
+	int16_t val;		// last value written (-1 = unknown)
+	uint8_t retry;
+} relay_t;
 
+relay_t relay_band = {-1, 0};
+relay_t relay_attn = {-1, 0};
 
-void relay_setband(uint8_t val)
+// the relay keeps its old value: the next set goes out even when it is the same
+static void relay_lost(relay_t *r)
 {
-	uint8_t data[2];
-	//int ret;
-	
-	data[0] = val&0x1f;
-//	if (i2c_write_blocking(i2c1, I2C_BPF, data, 1, false) < 0)
-	if (i2c_write_timeout_us(i2c1, I2C_BPF, data, 1, false, I2C_TIMEOUT_us) < 0)
-//		i2c_write_blocking(i2c1, I2C_BPF, data, 1, false);
-		i2c_write_timeout_us(i2c1, I2C_BPF, data, 1, false, I2C_TIMEOUT_us);
+	r->val = -1;
+	r->retry = 0;
+	i2ca_stat[I2CA_BUS_RELAY].lost++;
 }
 
-int relay_getband(void)
+static void relay_done(i2ca_trn_t *t)
+{
+	relay_t *r = (relay_t *)t->arg;
+
+	if (t->ret >= 0)
+	{
+		r->retry = 0;
+		return;
+	}
+	if ((r->retry++ != 0) || (i2ca_write(I2CA_BUS_RELAY, t->addr, t->wdata, t->wlen, t->key, relay_done, r) < 0))
+		relay_lost(r);
+}
+
+static void relay_set(relay_t *r, uint8_t addr, uint8_t val)
+{
+	if (r->val == val)
+	{
+		i2ca_stat[I2CA_BUS_RELAY].dropped++;
+		return;
+	}
+	r->val = val;
+	r->retry = 0;
+	if (i2ca_write(I2CA_BUS_RELAY, addr, &val, 1, addr, relay_done, r) < 0)
+		relay_lost(r);
+}
+
+static int relay_get(uint8_t addr)
 {
 	uint8_t data[2];
 	int ret;
 	
-	ret = i2c_read_blocking(i2c1, I2C_BPF, data, 1, false);
+	ret = i2ca_transfer(I2CA_BUS_RELAY, addr, NULL, 0, data, 1);
 	if (ret>=0) 
 		ret=data[0];
 	return(ret);
@@ -71,35 +107,31 @@ int relay_getband(void)
 
 
 
+void relay_setband(uint8_t val)
+{
+	relay_set(&relay_band, I2C_BPF, val&0x1f);
+}
+
+int relay_getband(void)
+{
+	return(relay_get(I2C_BPF));
+}
+
+
+
 void relay_setattn(uint8_t val)
 {
-	uint8_t data[2];
-	
-	data[0] = val&0x07;
-  //Serialx.println("relay_setattn  i2c_write_blocking  start");
-  //int i2c_write_blocking (i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop). 
-	//if (i2c_write_blocking(i2c1, I2C_RX, data, 1, false) < 0)  // true to keep master control of bus
-	if (i2c_write_timeout_us(i2c1, I2C_RX, data, 1, false, I2C_TIMEOUT_us) < 0)  // true to keep master control of bus
-    {
-    //Serialx.println("relay_setattn  i2c_write_blocking  if <0");  // false, we're done writing
-		i2c_write_timeout_us(i2c1, I2C_RX, data, 1, false, I2C_TIMEOUT_us);
-    }    
-  //Serialx.println("relay_setattn  i2c_write_blocking  end");  // false, we're done writing
+	relay_set(&relay_attn, I2C_RX, val&0x07);
 }
 
 int relay_getattn(void)
 {
-	uint8_t data[2];
-	int ret;
-	
-	ret = i2c_read_blocking(i2c1, I2C_RX, data, 1, false);
-	if (ret>=0) 
-		ret=data[0];
-	return(ret);
+	return(relay_get(I2C_RX));
 }
 
 void relay_init(void)
 { 
+	i2ca_init(I2CA_BUS_RELAY);
 /*  done at hmi_init()
 	relay_setattn(REL_PRE_10);
 	sleep_ms(1);
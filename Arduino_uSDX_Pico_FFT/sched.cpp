@@ -0,0 +1,110 @@
+/*
+ * sched.cpp
+ *
+ * Created: Oct 2026
+ * 
+ * Cooperative scheduler for the main loop (core0).
+ * Each task has its own period and priority, or a ready() function for event driven tasks.
+ * On each call of sched_run() only the highest priority task that is due is executed, 
+ * so a slow task delays the others by at most one execution.
+ * The deadline of a periodic task is the end of its period (next release), 
+ * the misses and the worst case execution time are kept per task (monitor "ts").
+ */
+
+#include "Arduino.h"
+#include "sched.h"
+
+
+sched_task_t sched_task[SCHED_MAX_TASKS];
+uint8_t sched_ntasks = 0;
+
+
+/*
+ * Add a task to the table
+ */
+void sched_add(const char *name, void (*task)(void), bool (*ready)(void), uint16_t period, uint8_t prio)
+{
+	sched_task_t *t;
+
+	if (sched_ntasks >= SCHED_MAX_TASKS) return;
+	t = &sched_task[sched_ntasks++];
+	t->name = name;
+	t->task = task;
+	t->ready = ready;
+	t->period = period;
+	t->prio = prio;
+	t->release = 0;
+	t->runs = 0;
+	t->misses = 0;
+	t->wcet = 0;
+	t->last = 0;
+}
+
+
+/*
+ * First release of all tasks = now
+ */
+void sched_start(void)
+{
+	uint32_t now = millis();
+	uint8_t i;
+
+	for (i=0; i<sched_ntasks; i++)
+		sched_task[i].release = now;
+}
+
+
+/*
+ * Clear the statistics
+ */
+void sched_reset(void)
+{
+	uint8_t i;
+
+	for (i=0; i<sched_ntasks; i++)
+	{
+		sched_task[i].runs = 0;
+		sched_task[i].misses = 0;
+		sched_task[i].wcet = 0;
+		sched_task[i].last = 0;
+	}
+}
+
+
+/*
+ * Run the highest priority task that is due
+ */
+void sched_run(void)
+{
+	sched_task_t *t, *best = NULL;
+	uint32_t now = millis();
+	uint32_t st;
+	uint8_t i;
+
+	for (i=0; i<sched_ntasks; i++)
+	{
+		t = &sched_task[i];
+		if ((best != NULL) && (t->prio >= best->prio)) continue;
+		if (((t->period != 0) && ((int32_t)(now - t->release) >= 0)) ||
+		    ((t->ready != NULL) && t->ready()))
+			best = t;
+	}
+	if (best == NULL) return;										// Nothing to do
+
+	st = micros();
+	best->task();
+	best->last = micros() - st;
+	if (best->last > best->wcet) best->wcet = best->last;
+	best->runs++;
+
+	if ((best->period != 0) && ((int32_t)(now - best->release) >= 0))	// Periodic release (not by ready())
+	{
+		now = millis();
+		if ((int32_t)(now - (best->release + best->period)) > 0)	// Finished after the end of its period
+		{
+			best->misses++;
+			best->release = now;									// Skip the lost releases
+		}
+		best->release += best->period;
+	}
+}
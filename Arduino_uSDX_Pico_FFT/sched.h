@@ -0,0 +1,44 @@
+#ifndef __SCHED_H__
+#define __SCHED_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 
+ * sched.h
+ *
+ * Created: Oct 2026
+ *
+ * See sched.cpp for more information 
+ */
+
+
+#define SCHED_MAX_TASKS   16
+
+typedef struct 
+{
+	const char *name;								// Task name (monitor)
+	void (*task)(void);								// Task function
+	bool (*ready)(void);							// Event task: runs when ready() is true (NULL = periodic task)
+	uint16_t period;								// Period in ms (0 = event task only)
+	uint8_t  prio;									// Priority, 0 = highest
+	uint32_t release;								// Next release time in ms
+	uint32_t runs;									// Statistics
+	uint32_t misses;								// Deadline (= end of period) misses
+	uint32_t wcet;									// Worst case execution time in us
+	uint32_t last;									// Last execution time in us
+} sched_task_t;
+
+extern sched_task_t sched_task[SCHED_MAX_TASKS];
+extern uint8_t sched_ntasks;
+
+void sched_add(const char *name, void (*task)(void), bool (*ready)(void), uint16_t period, uint8_t prio);
+void sched_start(void);
+void sched_run(void);
+void sched_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,404 @@
+/*
+ * settings.cpp
+ *
+ * Created: Oct 2026
+ *
+ * Settings kept over a power cycle: last band, frequency and menu options per band,
+ * waterfall gain and palette, Si5351 crystal calibration.
+ *
+ * The store is a log in the last SET_NBLOCKS flash sectors. A block starts with a header record
+ * (sequence number), followed by records of one setting each (12 bit key, length, CRC, value),
+ * memory channels are settings as well. A changed setting is appended,
+ * the newest record of a key is the valid one. When a block is full, the next block is erased
+ * and all settings are written there (compaction, empty memory channels are left out); the blocks are used round robin, so the
+ * erases are spread over all sectors. The header of a new block is programmed last: a block
+ * that was not completed (power loss) has no header and is ignored at restore.
+ *
+ * Writes are deferred: set_evaluate() (main loop task) compares the settings with the stored
+ * values, and writes the changed ones in one batch when nothing changed for SET_IDLE_MS and
+ * the radio is not transmitting. While the flash is erased or programmed it can not be read (XIP),
+ * so core1 is held with multicore_lockout and the interrupts of core0 are disabled.
+ * A page program takes ~1ms, a sector erase ~50ms (only on compaction).
+ *
+ * The restore at boot reads the flash directly through XIP, one pass over the newest block.
+ */
+
+#include "Arduino.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+#include "uSDR.h"
+#include "hmi.h"
+#include "dsp.h"
+#include "si5351.h"
+#include "TFT_eSPI.h"
+#include "display_tft.h"
+#include "memchan.h"
+#include "settings.h"
+
+
+#ifndef PICO_FLASH_SIZE_BYTES
+#define PICO_FLASH_SIZE_BYTES	(2*1024*1024)
+#endif
+#define SET_OFFSET			(PICO_FLASH_SIZE_BYTES - SET_NBLOCKS*FLASH_SECTOR_SIZE)
+#define SET_BLOCK(b)		(SET_OFFSET + (b)*FLASH_SECTOR_SIZE)
+
+#define SET_VALLEN			12
+#define SET_NREC			(FLASH_SECTOR_SIZE/sizeof(set_rec_t))	// records per block
+#define SET_PAGEREC			(FLASH_PAGE_SIZE/sizeof(set_rec_t))		// records per flash page
+#define SET_MAGIC			0x32544553UL							// "SET2", change when the keys change
+
+/* Keys */
+#define SET_K_HDR			0x00	// block header: magic, seq
+#define SET_K_BAND			0x01
+#define SET_K_FFTGAIN		0x02
+#define SET_K_PALETTE		0x03
+#define SET_K_XTAL			0x04
+#define SET_K_VARS			0x20	// + band: band_vars[band]
+#define SET_K_FREQ			0x40	// + band: band_starting_freq[band]
+#define SET_K_MEM			0x100	// + channel: mem_chan[channel]
+#define SET_KL_FREE			0xffff	// erased: end of the log
+
+#define SET_KL(k,l)			((uint16_t)(((l)<<12) | (k)))
+#define SET_KEY(r)			((r)->kl & 0x0fff)
+#define SET_LEN(r)			((r)->kl >> 12)
+
+#define SET_NITEMS			(4 + 2*NUMBER_OF_BANDS + MEM_NCHAN)
+
+typedef struct
+{
+	uint16_t kl;					// key (bits 0..11) and length (bits 12..15)
+	uint16_t crc;					// CRC-16 over kl and val[len]
+	uint8_t  val[SET_VALLEN];
+} set_rec_t;
+
+typedef struct
+{
+	uint16_t key;					// the items are added in ascending key order
+	uint8_t  len;
+	bool     late;					// restored by set_start(), Setup_Band() sets its own default
+	bool     sparse;				// not written on compaction when all 0 (empty memory channel)
+	bool     loaded;				// found in flash
+	volatile void *ptr;
+} set_item_t;
+
+static set_item_t set_item[SET_NITEMS];
+static uint16_t   set_nitems = 0;
+static uint8_t    set_shadow[SET_NITEMS][SET_VALLEN];	// values as stored in flash
+static set_rec_t  set_buf[SET_NITEMS+1];				// write batch
+static uint8_t    set_page[FLASH_PAGE_SIZE];
+static uint32_t   set_live_sum;							// to see the settings change
+static uint32_t   set_changed;							// millis() of the last change
+static bool       set_dirty = false;
+set_stat_t set_stat;
+
+
+/*
+ * CRC-16 CCITT
+ */
+static uint16_t set_crc(uint16_t crc, const volatile uint8_t *p, uint16_t len)
+{
+	uint8_t i;
+
+	while (len--)
+	{
+		crc ^= (uint16_t)(*p++) << 8;
+		for (i=0; i<8; i++)
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+	}
+	return crc;
+}
+
+static uint16_t set_rec_crc(const set_rec_t *r)
+{
+	return set_crc(set_crc(0xffff, (const uint8_t *)&r->kl, 2), r->val, SET_LEN(r));
+}
+
+static void set_mkrec(set_rec_t *r, uint16_t key, uint8_t len, const volatile void *val)
+{
+	memset(r, 0xff, sizeof(set_rec_t));
+	r->kl = SET_KL(key, len);
+	memcpy(r->val, (const void *)val, len);
+	r->crc = set_rec_crc(r);
+}
+
+static void set_add(uint16_t key, volatile void *ptr, uint8_t len, bool late, bool sparse)
+{
+	set_item[set_nitems].key = key;
+	set_item[set_nitems].len = len;
+	set_item[set_nitems].late = late;
+	set_item[set_nitems].sparse = sparse;
+	set_item[set_nitems].loaded = false;
+	set_item[set_nitems].ptr = ptr;
+	set_nitems++;
+}
+
+/* Binary search, the restore looks up every record */
+static int set_find(uint16_t key)
+{
+	int lo = 0, hi = set_nitems-1, i;
+
+	while (lo <= hi)
+	{
+		i = (lo + hi) / 2;
+		if (set_item[i].key == key) return i;
+		if (set_item[i].key < key) lo = i+1; else hi = i-1;
+	}
+	return -1;
+}
+
+static bool set_iszero(const volatile void *ptr, uint8_t len)
+{
+	const volatile uint8_t *p = (const volatile uint8_t *)ptr;
+
+	while (len--)
+		if (*p++ != 0) return false;
+	return true;
+}
+
+
+/*
+ * Flash access: core1 held in its lockout handler (RAM), core0 interrupts off.
+ * The flash_range_* functions run from RAM.
+ */
+static uint32_t set_ints;
+static uint32_t set_t0;
+static void set_flash_begin(void)
+{
+	set_t0 = time_us_32();
+	multicore_lockout_start_blocking();
+	set_ints = save_and_disable_interrupts();
+}
+
+static void set_flash_end(void)
+{
+	uint32_t us;
+
+	restore_interrupts(set_ints);
+	multicore_lockout_end_blocking();
+	dsp_mute(SET_MUTE_MS);
+	us = time_us_32() - set_t0;
+	if (us > set_stat.write_us) set_stat.write_us = us;
+}
+
+/* Program n records from slot on, page by page (unprogrammed bytes are written as 0xff) */
+static void set_program(uint8_t block, uint16_t slot, const set_rec_t *r, uint16_t n)
+{
+	uint16_t first, cnt;
+
+	while (n > 0)
+	{
+		first = slot % SET_PAGEREC;
+		cnt = MIN(n, SET_PAGEREC - first);
+		memset(set_page, 0xff, FLASH_PAGE_SIZE);
+		memcpy(set_page + first*sizeof(set_rec_t), r, cnt*sizeof(set_rec_t));
+		flash_range_program(SET_BLOCK(block) + (slot - first)*sizeof(set_rec_t), set_page, FLASH_PAGE_SIZE);
+		slot += cnt;
+		r += cnt;
+		n -= cnt;
+	}
+}
+
+
+/* Cheap checksum over all settings, only to see that something changed */
+static uint32_t set_livesum(void)
+{
+	const volatile uint8_t *p;
+	uint32_t sum = 0;
+	uint16_t i;
+	uint8_t n;
+
+	for (i=0; i<set_nitems; i++)
+	{
+		p = (const volatile uint8_t *)set_item[i].ptr;
+		for (n=0; n<set_item[i].len; n++)
+			sum = (sum << 5) + (sum >> 27) + *p++;
+	}
+	return sum;
+}
+
+
+/*
+ * Write the changed settings, or all settings to the next block when the active one is full
+ */
+void set_write(void)
+{
+	uint16_t i, n = 0;
+	uint8_t blk;
+
+	for (i=0; i<set_nitems; i++)
+	{
+		if (memcmp((const void *)set_item[i].ptr, set_shadow[i], set_item[i].len) == 0) continue;
+		set_mkrec(&set_buf[n++], set_item[i].key, set_item[i].len, set_item[i].ptr);
+	}
+	set_dirty = false;
+	if (n == 0) return;
+
+	if (set_stat.used + n <= SET_NREC)
+	{
+		set_flash_begin();
+		set_program(set_stat.block, set_stat.used, set_buf, n);
+		set_flash_end();
+		set_stat.used += n;
+	}
+	else
+	{
+		n = 1;													// compaction: all settings, slot 0 = header, programmed last
+		for (i=0; i<set_nitems; i++)
+		{
+			if (set_item[i].sparse && set_iszero(set_item[i].ptr, set_item[i].len)) continue;
+			set_mkrec(&set_buf[n++], set_item[i].key, set_item[i].len, set_item[i].ptr);
+		}
+		blk = (set_stat.block + 1) % SET_NBLOCKS;
+		uint32_t hdr[2] = { SET_MAGIC, set_stat.seq + 1 };
+		set_mkrec(&set_buf[0], SET_K_HDR, sizeof(hdr), hdr);
+
+		set_flash_begin();
+		flash_range_erase(SET_BLOCK(blk), FLASH_SECTOR_SIZE);
+		set_program(blk, 1, &set_buf[1], n-1);
+		set_program(blk, 0, &set_buf[0], 1);
+		set_flash_end();
+		set_stat.erases++;
+		set_stat.block = blk;
+		set_stat.seq++;
+		set_stat.used = n;
+	}
+	set_stat.writes++;
+	set_stat.records += n;
+
+	for (i=0; i<set_nitems; i++)
+		memcpy(set_shadow[i], (const void *)set_item[i].ptr, set_item[i].len);
+}
+
+
+/*
+ * Erase all blocks, the next boot starts with the defaults
+ */
+void set_erase(void)
+{
+	uint8_t b;
+
+	set_flash_begin();
+	for (b=0; b<SET_NBLOCKS; b++)
+		flash_range_erase(SET_BLOCK(b), FLASH_SECTOR_SIZE);
+	set_flash_end();
+	set_stat.erases += SET_NBLOCKS;
+	set_stat.block = SET_NBLOCKS-1;
+	set_stat.used = SET_NREC;									// next write starts block 0
+	memset(set_shadow, 0xff, sizeof(set_shadow));				// everything is written then
+	set_dirty = false;
+}
+
+
+/*
+ * Find the newest block and replay its records into the shadow, then into the settings.
+ * Records with a bad CRC (power loss while programming) or an unknown key/length are skipped.
+ */
+void set_restore(void)
+{
+	const set_rec_t *r;
+	uint32_t t0 = time_us_32();
+	uint32_t hdr[2], seq = 0;
+	int best = -1;
+	uint16_t slot;
+	uint8_t b;
+	int i;
+
+	set_nitems = 0;												// ascending keys
+	set_add(SET_K_BAND, &hmi_band, sizeof(hmi_band), false, false);
+	set_add(SET_K_FFTGAIN, &fft_gain, sizeof(fft_gain), true, false);
+#ifdef USE_TOUCH_SCREEN
+	set_add(SET_K_PALETTE, &lutoption, sizeof(lutoption), false, false);
+#endif
+	set_add(SET_K_XTAL, &si_xtal_freq, sizeof(si_xtal_freq), false, false);
+	for (b=0; b<NUMBER_OF_BANDS; b++)
+		set_add(SET_K_VARS + b, band_vars[b], NUMBER_OF_MENUES, false, false);
+	for (b=0; b<NUMBER_OF_BANDS; b++)
+		set_add(SET_K_FREQ + b, &band_starting_freq[b], sizeof(band_starting_freq[b]), false, false);
+	for (i=0; i<MEM_NCHAN; i++)
+		set_add(SET_K_MEM + i, &mem_chan[i], sizeof(mem_chan_t), false, true);
+
+	for (b=0; b<SET_NBLOCKS; b++)
+	{
+		r = (const set_rec_t *)(XIP_BASE + SET_BLOCK(b));
+		if ((r->kl != SET_KL(SET_K_HDR, sizeof(hdr))) || (r->crc != set_rec_crc(r))) continue;
+		memcpy(hdr, r->val, sizeof(hdr));
+		if (hdr[0] != SET_MAGIC) continue;
+		if ((best < 0) || ((int32_t)(hdr[1] - seq) > 0))
+		{
+			best = b;
+			seq = hdr[1];
+		}
+	}
+
+	if (best < 0)												// empty store: first write starts block 0
+	{
+		set_stat.block = SET_NBLOCKS-1;
+		set_stat.seq = 0;
+		set_stat.used = SET_NREC;
+	}
+	else
+	{
+		r = (const set_rec_t *)(XIP_BASE + SET_BLOCK(best));
+		for (slot=1; (slot<SET_NREC) && (r[slot].kl != SET_KL_FREE); slot++)
+		{
+			if ((SET_LEN(&r[slot]) > SET_VALLEN) || (r[slot].crc != set_rec_crc(&r[slot]))) continue;
+			i = set_find(SET_KEY(&r[slot]));
+			if ((i < 0) || (SET_LEN(&r[slot]) != set_item[i].len)) continue;
+			memcpy(set_shadow[i], r[slot].val, set_item[i].len);
+			set_item[i].loaded = true;
+		}
+		set_stat.block = best;
+		set_stat.seq = seq;
+		set_stat.used = slot;
+	}
+
+	for (i=0; i<set_nitems; i++)
+	{
+		if (set_item[i].loaded && !set_item[i].late)
+			memcpy((void *)set_item[i].ptr, set_shadow[i], set_item[i].len);
+		else if (!set_item[i].loaded)
+			memcpy(set_shadow[i], (const void *)set_item[i].ptr, set_item[i].len);
+	}
+	if (hmi_band >= NUMBER_OF_BANDS) hmi_band = START_BAND;
+
+	set_stat.restore_us = time_us_32() - t0;
+}
+
+
+/*
+ * The settings that Setup_Band() overwrites with a default
+ */
+void set_start(void)
+{
+	uint16_t i;
+
+	for (i=0; i<set_nitems; i++)
+	{
+		if (set_item[i].loaded && set_item[i].late)
+			memcpy((void *)set_item[i].ptr, set_shadow[i], set_item[i].len);
+	}
+	set_live_sum = set_livesum();
+	set_changed = millis();
+}
+
+
+/*
+ * Main loop task: write-behind after SET_IDLE_MS without changes, never during TX
+ */
+void set_evaluate(void)
+{
+	uint32_t sum;
+
+	sum = set_livesum();
+	if (sum != set_live_sum)
+	{
+		set_live_sum = sum;
+		set_changed = millis();
+		set_dirty = true;
+		return;
+	}
+	if (!set_dirty || tx_enabled) return;
+	if ((millis() - set_changed) < SET_IDLE_MS) return;
+	set_write();
+}
@@ -0,0 +1,44 @@
+#ifndef __SETTINGS_H__
+#define __SETTINGS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * settings.h
+ *
+ * Created: Oct 2026
+ *
+ * See settings.cpp for more information
+ */
+
+
+#define SET_NBLOCKS			4		// flash sectors used round robin, at the end of the flash
+#define SET_IDLE_MS			5000	// write when the settings did not change for this time
+#define SET_MUTE_MS			20		// audio mute after a flash write (core1 was stopped)
+
+typedef struct
+{
+	uint32_t seq;					// sequence number of the active block
+	uint8_t  block;					// active block
+	uint16_t used;					// records in the active block (incl. header)
+	uint32_t writes;				// flash write batches
+	uint32_t records;				// records written
+	uint32_t erases;				// sector erases (compactions)
+	uint32_t restore_us;			// time of the restore at boot
+	uint32_t write_us;				// longest write batch (core1 held)
+} set_stat_t;
+
+extern set_stat_t set_stat;
+
+void set_restore(void);				// before hmi_init0()
+void set_start(void);				// after hmi_init0()
+void set_evaluate(void);
+void set_write(void);				// write the changed settings now
+void set_erase(void);				// erase the store, defaults at the next boot
+
+#ifdef __cplusplus
+}
+#endif
+#endif
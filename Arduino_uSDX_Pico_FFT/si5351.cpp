@@ -133,8 +133,7 @@ Control Si5351 (see AN619):
 
 
 #if TX_METHOD == I_Q_QSE
-#define i2c_write_blocking_   i2c_write_blocking
-#define i2c_read_blocking_    i2c_read_blocking
+#include "i2c_async.h"
 #endif
 #if TX_METHOD == PHASE_AMPLITUDE
 #include "uSDX_SI5351.h"
@@ -184,60 +183,130 @@ Control Si5351 (see AN619):
 #else
 #define SI_XTAL_FREQ  (25000000UL)  // Replace with measured crystal frequency of XTAL for CL = 10pF (default)
 #endif
-#define SI_MSN_LO		((0.6e9)/SI_XTAL_FREQ)
-#define SI_MSN_HI		((0.9e9)/SI_XTAL_FREQ)
+#define SI_VCO_LO		600000000ULL	// Fvco range, MSN = Fvco/Fxtal
+#define SI_VCO_HI		900000000ULL
 #define SI_PLL_C		1000000UL		// Parameter c for PLL-A and -B setting
 
 
 
 vfo_t vfo[2];				// 0: clk0 and clk1     1: clk2
+uint8_t  si_regs[SI_NUM_REGS];		// register shadow
+uint32_t si_xtal_freq = SI_XTAL_FREQ;
+
+
+/* 
+ * write registers reg .. reg+len-1 
+ * only the range from the first to the last byte different from the shadow is sent, in one burst
+ * force = send all (registers with action, like PLL reset, or init)
+ */
+void si_setregs(uint8_t reg, const uint8_t *val, uint8_t len, bool force)
+{
+	uint8_t data[20];		// I2C trx buffer (max 19 registers)
+	int first, last;
+
+	if (force)
+	{
+		first = 0;
+		last = len-1;
+	}
+	else
+	{
+		for (first=0; (first<len) && (si_regs[reg+first]==val[first]); first++);
+		if (first==len) return;						// nothing changed
+		for (last=len-1; si_regs[reg+last]==val[last]; last--);
+	}
+	data[0] = reg+first;
+	memcpy(&data[1], &val[first], last-first+1);
+#if TX_METHOD == I_Q_QSE
+	if (i2ca_write(I2CA_BUS_SI, I2C_VFO, data, last-first+2, 0, NULL, NULL) < 0)
+		return;										// not queued: shadow unchanged, sent again next time
+#else
+	i2c_write_blocking_(i2c0, I2C_VFO, data, last-first+2, false);
+#endif
+	memcpy(&si_regs[reg+first], &val[first], last-first+1);
+}
+
+
+// position in the Si5351 I2C queue (blocking I2C: the write is done on return)
+#if TX_METHOD == I_Q_QSE
+#define si_last()		i2ca_last(I2CA_BUS_SI)
+#define si_sent(seq)	i2ca_sent(I2CA_BUS_SI, (seq))
+#else
+#define si_last()		0
+#define si_sent(seq)	true
+#endif
+
+// PTT switch from the DSP IRQ (si_txrx) against the main loop
+static volatile bool    si_lock = false;		// main loop is using the Si5351 registers and I2C queue
+static volatile bool    si_txrx_pend = false;
+static volatile uint8_t si_txrx_want;
+static void si_unlock(void);
+#define SI_TXRX_NTRN	5						// worst case PTT switch: MSN, MS0/1, phase, CLK1 control, PLL reset
+
 
 /* read contents of SI5351 registers, from reg to reg+len-1, output in data array */
 int si_getreg(uint8_t *data, uint8_t reg, uint8_t len)
 {
 	int ret;
 	
+#if TX_METHOD == I_Q_QSE
+	uint8_t i, n, r;
+
+	si_lock = true;												// no PTT switch on the queue meanwhile
+	__compiler_memory_barrier();
+	for (i=0; i<len; i+=n)										// in pieces of the RX FIFO size
+	{
+		n = ((len-i) > I2CA_MAXREAD) ? I2CA_MAXREAD : (len-i);
+		r = reg + i;
+		ret = i2ca_transfer(I2CA_BUS_SI, I2C_VFO, &r, 1, &data[i], n);
+		if (ret<0) printf ("I2C read error\n");
+	}
+	si_unlock();
+#else
 	ret = i2c_write_blocking_(i2c0, I2C_VFO, &reg, 1, true);
 	if (ret<0) printf ("I2C write error\n");
 	ret = i2c_read_blocking_(i2c0, I2C_VFO, data, len, false);
 	if (ret<0) printf ("I2C read error\n");
+#endif
 	return(len);
 }
 
 
-// Set up MSN PLL divider for vfo[i], assuming MSN has been set in vfo[i]
-// Optimize for speed, this may be called with short intervals
+// Format the 8 MSN PLL registers for MSN = a + b/SI_PLL_C
 // See also SiLabs AN619 section 3.2
-void si_setmsn(uint8_t i)
+void si_fmtmsn(uint8_t *data, uint8_t a, uint32_t b)
 {
-	uint8_t  data[16];		// I2C trx buffer
 	uint32_t P1, P2;		// MSN parameters
-	uint32_t A;
-	uint32_t B;
 
-	i=(i>0?1:0);
 /*
  P1 = 128*a + Floor(128*b/c) - 512
  P2 = 128*b - c*Floor(128*b/c)
  P3 = c									(P3 = 1000000 for MSN tuning)
 */	
-	A  = (uint32_t)(floor(vfo[i].msn));						// A is integer part of MSN
-	B  = (uint32_t)((vfo[i].msn - (float)A) * SI_PLL_C);	// B is C * fraction part of MSN (C is a constant)
-	P2 = (uint32_t)(floor((float)(128 * B) / (float)SI_PLL_C));
-	P1 = (uint32_t)(128 * A + P2 - 512);
-	P2 = (uint32_t)(128 * B - SI_PLL_C * P2);
+	P2 = (128 * b) / SI_PLL_C;								// Floor(128*b/c)
+	P1 = 128 * (uint32_t)a + P2 - 512;
+	P2 = 128 * b - SI_PLL_C * P2;
 	
-	// transfer registers
-	data[0] = (i==0?SI_SYNTH_PLLA:SI_SYNTH_PLLB);
-	data[1] = (SI_PLL_C & 0x0000FF00) >> 8;
-	data[2] = (SI_PLL_C & 0x000000FF);
-	data[3] = (P1 & 0x00030000) >> 16;
-	data[4] = (P1 & 0x0000FF00) >> 8;
-	data[5] = (P1 & 0x000000FF);
-	data[6] = ((SI_PLL_C & 0x000F0000) >> 12) | ((P2 & 0x000F0000) >> 16);
-	data[7] = (P2 & 0x0000FF00) >> 8;
-	data[8] = (P2 & 0x000000FF);
-	i2c_write_blocking_(i2c0, I2C_VFO, data, 9, false);
+	data[0] = (SI_PLL_C & 0x0000FF00) >> 8;
+	data[1] = (SI_PLL_C & 0x000000FF);
+	data[2] = (P1 & 0x00030000) >> 16;
+	data[3] = (P1 & 0x0000FF00) >> 8;
+	data[4] = (P1 & 0x000000FF);
+	data[5] = ((SI_PLL_C & 0x000F0000) >> 12) | ((P2 & 0x000F0000) >> 16);
+	data[6] = (P2 & 0x0000FF00) >> 8;
+	data[7] = (P2 & 0x000000FF);
+}
+
+// Set up MSN PLL divider for vfo[i], assuming MSN has been set in vfo[i]
+// Optimize for speed, this may be called with short intervals
+// Only the changed bytes are written (normally P1 low byte and P2)
+void si_setmsn(uint8_t i)
+{
+	uint8_t  data[8];		// register values
+
+	i=(i>0?1:0);
+	si_fmtmsn(data, vfo[i].msn_a, vfo[i].msn_b);
+	si_setregs((i==0?SI_SYNTH_PLLA:SI_SYNTH_PLLB), data, 8, false);
 }
 
 // Set up registers with MS and R divider for vfo[i], assuming values have been set in vfo[i]
@@ -245,7 +314,7 @@ void si_setmsn(uint8_t i)
 // See also SiLabs AN619 section 4.1
 void si_setmsi(uint8_t i)
 {
-	uint8_t data[16];		// I2C trx buffer
+	uint8_t data[16];		// register values
 	uint32_t P1;
 	uint8_t  R;
 
@@ -255,92 +324,263 @@ void si_setmsi(uint8_t i)
  P2 = 128*b - c*Floor(128*b/c)			(P2 = 0 for MSi integer mode)
  P3 = c									(P3 = 1 for MSi integer mode)
 */	
-	P1 = (uint32_t)(128*(uint32_t)floor(vfo[i].msi) - 512);
+	P1 = 128*(uint32_t)vfo[i].msi - 512;
 	R  = vfo[i].ri;
 	R  = (R&0xf0) ? ((R&0xc0)?((R&0x80)?7:6):(R&0x20)?5:4) : ((R&0x0c)?((R&0x08)?3:2):(R&0x02)?1:0); // quick log2(r)
 	
-	data[0] = (i==0?SI_SYNTH_MS0:SI_SYNTH_MS2);
-	data[1] = 0x00;
-	data[2] = 0x01;
-	data[3] = ((P1 & 0x00030000) >> 16) | (R << 4 );
-	data[4] = (P1 & 0x0000FF00) >> 8;
-	data[5] = (P1 & 0x000000FF);
+	data[0] = 0x00;
+	data[1] = 0x01;
+	data[2] = ((P1 & 0x00030000) >> 16) | (R << 4 );
+	data[3] = (P1 & 0x0000FF00) >> 8;
+	data[4] = (P1 & 0x000000FF);
+	data[5] = 0x00;
 	data[6] = 0x00;
 	data[7] = 0x00;
-	data[8] = 0x00;
-	i2c_write_blocking_(i2c0, I2C_VFO, data, 9, false);
 
-	// If vfo[0] also set clk 1	
 	if (i==0)
 	{
-		data[0] = SI_SYNTH_MS1;						// Same data in synthesizer
-		i2c_write_blocking_(i2c0, I2C_VFO, data, 9, false);
+		memcpy(&data[8], &data[0], 8);				// If vfo[0] also set clk 1, same data in synthesizer
+		si_setregs(SI_SYNTH_MS0, data, 16, false);	// MS0 and MS1 in one burst
 		
-		if (vfo[0].phase&1)							// Phase is either 90 or 270 deg?
-		{
-			data[0] = SI_CLK1_PHOFF;
-			data[1] = vfo[0].msi;
-			i2c_write_blocking_(i2c0, I2C_VFO, data, 2, false);
-		}
-		else										// Phase is 0 or 180 deg
-		{
-			data[0] = SI_CLK1_PHOFF;
-			data[1] = 0;
-			i2c_write_blocking_(i2c0, I2C_VFO, data, 2, false);
-		}
+		data[0] = (vfo[0].phase&1) ? vfo[0].msi : 0;	// Phase is either 90 or 270 deg?  or 0 or 180 deg
+		si_setregs(SI_CLK1_PHOFF, data, 1, false);
 		if (vfo[0].phase&2)							// Phase is 180 or 270 deg?
 		{
-			data[0] = SI_CLK1_CTL;
-			data[1] = 0x5d;							// CLK1: INT, PLLA, INV, MS, 8mA
-			i2c_write_blocking_(i2c0, I2C_VFO, data, 2, false);
+			data[0] = 0x5d;							// CLK1: INT, PLLA, INV, MS, 8mA
+			si_setregs(SI_CLK1_CTL, data, 1, false);
 		}
 	}
+	else
+	{
+		si_setregs(SI_SYNTH_MS2, data, 8, false);
+	}
 		
 	// Reset associated PLL
-	data[0] = SI_PLL_RESET;
-	data[1] = (i==1)?0x80:0x20;
-	i2c_write_blocking_(i2c0, I2C_VFO, data, 2, false);
+	data[0] = (i==1)?SI_PLLB_RST:SI_PLLA_RST;
+	si_setregs(SI_PLL_RESET, data, 1, true);
+}
+
+
+/*
+ * Tuning plan for one band (Fout = f_lo .. f_hi)
+ * Each segment starts with the smallest even MSi that keeps Fvco >= 600MHz and is extended up to 900MHz, 
+ * then MSi is moved to the center of the range allowed on the segment.
+ * Ri follows the same rule as si_evaluate (Ri=1 is stretched down to 3MHz with MSi=126).
+ */
+si_seg_t si_plan[SI_PLAN_MAX_SEG];
+uint8_t  si_plan_nseg = 0;
+uint32_t si_reset_us = 0;
+uint32_t si_reset_us_max = 0;
+uint32_t si_reset_count = 0;
+
+void si_plan_band(uint32_t f_lo, uint32_t f_hi)
+{
+	uint32_t f, seg_hi, msi_lo, msi_hi, msi, f_top, ri_end;
+	uint8_t  ri;
+
+	si_plan_nseg = 0;
+	f = f_lo;
+	while ((f <= f_hi) && (si_plan_nseg < SI_PLAN_MAX_SEG))
+	{
+		ri = (f<1000000)?128:((f<3000000)?32:1);
+		ri_end = (ri==128)?1000000:((ri==32)?3000000:0xffffffff);		// Ri changes there
+
+		msi_lo = (uint32_t)((SI_VCO_LO + (uint64_t)f*ri - 1) / ((uint64_t)f*ri));	// Fvco >= 600MHz at f
+		msi_lo = (msi_lo + 1) & 0xfe;
+		if (msi_lo > 126) msi_lo = 126;									// Ri=1 stretch
+		if (msi_lo < 4) msi_lo = 4;
+
+		seg_hi = (uint32_t)((SI_VCO_HI - 1) / ((uint64_t)msi_lo*ri));		// Fvco < 900MHz
+		if (seg_hi >= ri_end) seg_hi = ri_end - 1;
+		if (seg_hi > f_hi) seg_hi = f_hi;
+
+		msi_hi = (uint32_t)((SI_VCO_HI - 1) / ((uint64_t)seg_hi*ri)) & 0xfe;
+		if (msi_hi > 126) msi_hi = 126;									// MSi is also the CLK1 phase offset (7 bits)
+		msi = (msi_hi > msi_lo) ? (((msi_lo + msi_hi) / 2) & 0xfe) : msi_lo;
+		if (msi > 126) msi = 126;
+		f_top = (uint32_t)((SI_VCO_HI - 1) / ((uint64_t)msi*ri));			// Fvco < 900MHz with the MSi used
+		if (seg_hi > f_top) seg_hi = f_top;
+		si_plan[si_plan_nseg].f_lo = f;
+		si_plan[si_plan_nseg].f_hi = seg_hi;
+		si_plan[si_plan_nseg].msi  = (uint8_t)msi;
+		si_plan[si_plan_nseg].ri   = ri;
+		si_plan_nseg++;
+		f = seg_hi + 1;
+	}
 }
 
 
-// For each vfo, calculate required MSN setting, MSN = MSi*Ri*Fout/Fxtal
-// If in range, just set MSN registers
-// If not in range, recalculate MSi and Ri and also MSN
-// Set MSN, MSi and Ri registers (implicitly resets PLL)
+/*
+ * RX and TX register images for clk0/1 (PLLA)
+ * Both are calculated when a frequency changes, so the PTT edge only sends the prepared MSN bytes
+ * (one burst, no PLL reset when RX and TX are on the same segment).
+ * The switch runs on core0 in the DSP IRQ on the tx_enabled edge (dsp.cpp). si_evaluate() (main loop,
+ * same core) holds si_lock while it changes the images: an edge in that time is left pending and
+ * done when the lock is released.
+ */
+si_img_t si_img[2];
+uint8_t  si_img_sel = SI_IMG_RX;		// image loaded in the Si5351
+volatile bool si_img_same = true;		// RX and TX images are equal (simplex, no XIT): TX needs no switch
+static volatile uint32_t si_img_seq = 0;	// I2C queue sequence number of the last image burst
+uint32_t si_tx_freq = 0;
+uint32_t si_txrx_us = 0;
+uint32_t si_txrx_us_max = 0;
+
+// MSi, Ri and MSN registers for Fout = f, all integer
+void si_calcimg(si_img_t *img, uint32_t f)
+{
+	uint64_t vco, rem;
+	uint8_t seg;
+
+	for (seg=0; seg<si_plan_nseg; seg++)									// Planned segment?
+		if ((f >= si_plan[seg].f_lo) && (f <= si_plan[seg].f_hi)) break;
+
+	vco = (uint64_t)vfo[0].msi * (uint64_t)vfo[0].ri * (uint64_t)f;
+	if (seg < si_plan_nseg)
+	{
+		img->msi = si_plan[seg].msi;
+		img->ri  = si_plan[seg].ri;
+	}
+	else if ((vco>=SI_VCO_LO)&&(vco<SI_VCO_HI))									// Current MSi and Ri still fit
+	{
+		img->msi = vfo[0].msi;
+		img->ri  = vfo[0].ri;
+	}
+	else
+	{
+		img->ri  = (f<1000000)?128:((f<3000000)?32:1);								// Pre-scale Ri, stretch down Ri=1 range
+		if ((f >= 3000000)&&(f < 6000000))											// Low end of Ri=1 range
+			img->msi = (uint8_t)126;												// Maximum MSi on Fvco=(4x126)MHz
+		else
+			img->msi = (uint8_t)(750000000UL / (f * img->ri)) & 0xfe;				// Calculate MSi on Fvco=750MHz
+	}
+
+	vco = (uint64_t)img->msi * (uint64_t)img->ri * (uint64_t)f;
+	img->freq  = f;
+	img->msn_a = (uint8_t)(vco / si_xtal_freq);
+	rem = vco % si_xtal_freq;
+	img->msn_b = (uint32_t)((rem * SI_PLL_C) / si_xtal_freq);
+	si_fmtmsn(img->msn, img->msn_a, img->msn_b);
+}
+
+/*
+ * Write image sel to clk0/1
+ * Same MSi/Ri: only the changed MSN bytes, else MSi and Ri too, with PLL reset and audio muted (time measured)
+ */
+void si_load(uint8_t sel)
+{
+	si_img_t *img = &si_img[sel];
+	uint32_t st;
+
+	vfo[0].msn_a = img->msn_a;
+	vfo[0].msn_b = img->msn_b;
+	if ((img->msi == vfo[0].msi) && (img->ri == vfo[0].ri))
+	{
+		si_setregs(SI_SYNTH_PLLA, img->msn, 8, false);
+		si_img_seq = si_last();
+		return;
+	}
+
+	st = micros();
+	dsp_mute(SI_MUTE_MS);
+	vfo[0].msi = img->msi;
+	vfo[0].ri  = img->ri;
+	si_setregs(SI_SYNTH_PLLA, img->msn, 8, false);
+	si_setmsi(0);
+	si_reset_us = micros() - st;
+	if (si_reset_us > si_reset_us_max) si_reset_us_max = si_reset_us;
+	si_reset_count++;
+	si_img_seq = si_last();
+}
+
+static void si_switch(uint8_t sel)
+{
+	uint32_t st;
+
+	si_txrx_pend = false;
+	if (sel == si_img_sel) return;
+	st = micros();
+	si_load(sel);
+	si_img_sel = sel;										// queued: si_tx_ready() waits until the bus is done with it
+	si_txrx_us = micros() - st;
+	if (si_txrx_us > si_txrx_us_max) si_txrx_us_max = si_txrx_us;
+}
+
+/*
+ * PTT edge (DSP IRQ): switch clk0/1 to the TX or RX image
+ * Only the writes are queued here (the I2C IRQ sends them). When the main loop is using the
+ * Si5351 or the queue has no room for the MSN, MSi and PLL reset bursts, the switch is left
+ * to si_unlock(). With blocking I2C (no I2C queue) it is always left to the main loop.
+ */
+void si_txrx(uint8_t sel)
+{
+#if TX_METHOD == I_Q_QSE
+	if (!si_lock && i2ca_room(I2CA_BUS_SI, SI_TXRX_NTRN))
+	{
+		si_switch(sel);
+		return;
+	}
+#endif
+	si_txrx_want = sel;
+	si_txrx_pend = true;
+}
+
+// main loop: end of the Si5351 access, a PTT edge that came in the meantime is done now
+static void si_unlock(void)
+{
+	uint32_t st;
+
+	__compiler_memory_barrier();
+	si_lock = false;
+	if (!si_txrx_pend) return;
+	st = save_and_disable_interrupts();						// a new edge must not run in between
+#if TX_METHOD == I_Q_QSE
+	if (si_txrx_pend && i2ca_room(I2CA_BUS_SI, SI_TXRX_NTRN))
+#else
+	if (si_txrx_pend)
+#endif
+		si_switch(si_txrx_want);
+	restore_interrupts(st);
+}
+
+
+// vfo[0] holds the RX frequency, si_tx_freq the TX frequency (0 = same as RX)
+// Both images are recalculated on a change, and the one for the current PTT state is written
+// when it differs (tuning inside the DDC window only changes the TX image: no I2C in RX):
+// inside the band tuning plan, MSi and Ri come from the segment, so the PLL is reset only when the segment changes
+// outside the plan, MSi and Ri are kept while Fvco = MSi*Ri*Fout stays in the VCO range
+/*
+ * DSP IRQ (tx): the TX frequency is in the Si5351, the last image burst has left the I2C queue
+ * (a failed write also counts, the queue moves on)
+ */
+bool si_tx_ready(void)
+{
+	return ((si_img_sel == SI_IMG_TX) || si_img_same) && si_sent(si_img_seq);
+}
+
 void si_evaluate(void)
 {
-	float msn;
+	si_img_t old;
 
+	si_lock = true;
+	__compiler_memory_barrier();
 	if (vfo[0].flag)
 	{
-		msn = (float)(vfo[0].msi); 														// Re-calculate MSN
-		msn = msn * (float)(vfo[0].ri);
-		msn = msn * (float)(vfo[0].freq) / SI_XTAL_FREQ;
-		if ((msn>=SI_MSN_LO)&&(msn<SI_MSN_HI))
-		{
-			vfo[0].msn = msn;
-			si_setmsn(0);
-		}
-		else
-		{
-			vfo[0].ri  = (vfo[0].freq<1000000)?128:((vfo[0].freq<3000000)?32:1);		// Pre-scale Ri, stretch down Ri=1 range
-			if ((vfo[0].freq >= 3000000)&&(vfo[0].freq < 6000000))						// Low end of Ri=1 range
-				vfo[0].msi = (uint8_t)126;												// Maximum MSi on Fvco=(4x126)MHz
-			else
-				vfo[0].msi = (uint8_t)(750000000UL / (vfo[0].freq * vfo[0].ri)) & 0xfe;	// Calculate MSi on Fvco=750MHz
-			msn = (float)(vfo[0].msi); 													// Re-calculate MSN
-			msn = msn * (float)(vfo[0].ri);
-			msn = msn * (float)(vfo[0].freq) / SI_XTAL_FREQ;
-			vfo[0].msn = msn;
-			si_setmsn(0);
-			si_setmsi(0);
-		}
+		old = si_img[si_img_sel];
+		si_calcimg(&si_img[SI_IMG_RX], vfo[0].freq);
+		si_calcimg(&si_img[SI_IMG_TX], (si_tx_freq != 0) ? si_tx_freq : vfo[0].freq);
+		if ((old.msi != si_img[si_img_sel].msi) || (old.ri != si_img[si_img_sel].ri) ||
+		    (memcmp(old.msn, si_img[si_img_sel].msn, sizeof(old.msn)) != 0))
+			si_load(si_img_sel);
+		si_img_same = (si_img[SI_IMG_RX].msi == si_img[SI_IMG_TX].msi) && (si_img[SI_IMG_RX].ri == si_img[SI_IMG_TX].ri) &&
+		              (memcmp(si_img[SI_IMG_RX].msn, si_img[SI_IMG_TX].msn, sizeof(old.msn)) == 0);
 		vfo[0].flag = 0;
 	}
 	if (vfo[1].flag)
 	{
 		vfo[1].flag = 0;
 	}
+	si_unlock();
 }
 
 
@@ -349,6 +589,12 @@ void si_init(void)
 {
 	uint8_t data[16];		// I2C trx buffer
 
+#if TX_METHOD == I_Q_QSE
+	i2c_set_baudrate(i2c0, SI_I2C_CLOCK);			// i2c0 is only used for the Si5351
+	i2ca_init(I2CA_BUS_SI);
+#endif
+	memset(si_regs, 0, sizeof(si_regs));
+
 	// Hard initialize Synth registers: 7.074MHz, CLK1 90 deg ahead, PLLA for CLK 0&1, PLLB for CLK2
 	// Ri=1,
 	// MSi=68,    P1=8192, P2=0,      P3=1
@@ -358,13 +604,15 @@ void si_init(void)
 	vfo[0].phase = 1;
 	vfo[0].ri    = 1;
 	vfo[0].msi   = 68;
-	vfo[0].msn   = 27.2;
+	vfo[0].msn_a = 27;
+	vfo[0].msn_b = 200000;
 	vfo[1].freq  = 10000000;
 	vfo[1].flag  = 0;
 	vfo[1].phase = 0;
 	vfo[1].ri    = 1;
 	vfo[1].msi   = 68;
-	vfo[1].msn   = 27.2;
+	vfo[1].msn_a = 27;
+	vfo[1].msn_b = 200000;
 
 	// PLLA: MSN P1=0x00000b99, P2=0x000927c0, P3=0x000f4240
 	data[0] = SI_SYNTH_PLLA;
@@ -376,12 +624,12 @@ void si_init(void)
 	data[6] = 0xf9;		// MSNA_P3[19:16] , MSNA_P2[19:16]
 	data[7] = 0x27;		// MSNA_P2[15:8]
 	data[8] = 0xc0;		// MSNA_P2[7:0]
-	i2c_write_blocking_(i2c0, I2C_VFO, data, 9, false);
+	si_setregs(data[0], &data[1], 8, true);
 
 	
 	// PLLB: MSN P1=0x00000b99, P2=0x000927c0, P3=0x000f4240
 	data[0] = SI_SYNTH_PLLB;		// Same content
-	i2c_write_blocking_(i2c0, I2C_VFO, data, 9, false);
+	si_setregs(data[0], &data[1], 8, true);
 
 	// MS0 P1=0x00002000, P2=0x00000000, P3=0x00000001, R=1
 	data[0] = SI_SYNTH_MS0;
@@ -393,39 +641,39 @@ void si_init(void)
 	data[6] = 0x00;		// MS0_P3[19:16] , MS0_P2[19:16]
 	data[7] = 0x00;		// MS0_P2[15:8]
 	data[8] = 0x00;		// MS0_P2[7:0]
-	i2c_write_blocking_(i2c0, I2C_VFO, data, 9, false);
+	si_setregs(data[0], &data[1], 8, true);
 
 	// MS1 P1=0x00002000, P2=0x00000000, P3=0x00000001, R=1
 	data[0] = SI_SYNTH_MS1;		// Same content
-	i2c_write_blocking_(i2c0, I2C_VFO, data, 9, false);
+	si_setregs(data[0], &data[1], 8, true);
 
 	// MS2 P1=0x00002000, P2=0x00000000, P3=0x00000001, R=1
 	data[0] = SI_SYNTH_MS2;		// Same content
-	i2c_write_blocking_(i2c0, I2C_VFO, data, 9, false);
+	si_setregs(data[0], &data[1], 8, true);
 
 	// Phase offsets for 3 clocks
 	data[0] = SI_CLK0_PHOFF;
 	data[1] = 0x00;		// CLK0: phase 0 deg
 	data[2] = 0x44;		// CLK1: phase 90 deg (=MSi)
 	data[3] = 0x00;		// CLK2: phase 0 deg
-	i2c_write_blocking_(i2c0, I2C_VFO, data, 4, false);
+	si_setregs(data[0], &data[1], 3, true);
 
 	// Output port settings for 3 clocks
 	data[0] = SI_CLK0_CTL;
 	data[1] = 0x4d;		// CLK0: INT, PLLA, nonINV, MS, 4mA
 	data[2] = 0x4d;		// CLK1: INT, PLLA, nonINV, MS, 4mA
 	data[3] = 0x6f;		// CLK2: INT, PLLB, nonINV, MS, 8mA
-	i2c_write_blocking_(i2c0, I2C_VFO, data, 4, false);
+	si_setregs(data[0], &data[1], 3, true);
 
 	// Disable spread spectrum (startup state is undefined)	
 	data[0] = SI_SS_EN;
 	data[1] = 0x00;
-	i2c_write_blocking_(i2c0, I2C_VFO, data, 2, false);
+	si_setregs(data[0], &data[1], 1, true);
 	
 	// Reset both PLL
 	data[0] = SI_PLL_RESET;
 	data[1] = 0xa0;
-	i2c_write_blocking_(i2c0, I2C_VFO, data, 2, false);
+	si_setregs(data[0], &data[1], 1, true);
 
 	// Enable all outputs	
   data[0] = SI_CLK_OE;  //reg address
@@ -434,5 +682,5 @@ void si_init(void)
 #else
 	data[1] = 0x00;       //0 = enable all
 #endif
-	i2c_write_blocking_(i2c0, I2C_VFO, data, 2, false);
+	si_setregs(data[0], &data[1], 1, true);
 }
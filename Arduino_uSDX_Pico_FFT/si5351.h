@@ -24,10 +24,58 @@ typedef struct
 	uint8_t  phase;		// in quarter waves (0, 1, 2, 3)
 	uint8_t  ri;		// Ri (1 .. 128)
 	uint8_t  msi;		// MSi parameter a (4, 6, 8 .. 126)
-	float    msn;		// MSN (24.0 .. 35.9999)
+	uint8_t  msn_a;		// MSN integer part (24 .. 35)
+	uint32_t msn_b;		// MSN fraction part * SI_PLL_C  (MSN = msn_a + msn_b/SI_PLL_C)
 } vfo_t;
 extern vfo_t vfo[2];	// Table contains all control data for three clk outputs, but 0 and 1 are coupled in vfo[0]
 
+#define SI_I2C_CLOCK	400000UL	// i2c0 clock to Si5351 (Hz), up to 1000000 (Fast-mode Plus)
+#define SI_NUM_REGS		188			// registers kept in the shadow (0 .. SI_XTAL_LOAD)
+extern uint8_t  si_regs[SI_NUM_REGS];	// shadow of the Si5351 registers, writes only send the changed bytes
+extern uint32_t si_xtal_freq;			// crystal frequency (Hz), can be changed for calibration
+
+
+// Tuning plan: the band is covered by segments with fixed MSi and Ri, inside a segment only MSN changes (no PLL reset)
+#define SI_PLAN_MAX_SEG	6
+#define SI_MUTE_MS		10			// audio mute when a new segment is programmed (PLL reset)
+typedef struct
+{
+	uint32_t f_lo;		// Fout range covered, f_lo .. f_hi
+	uint32_t f_hi;
+	uint8_t  msi;
+	uint8_t  ri;
+} si_seg_t;
+extern si_seg_t si_plan[SI_PLAN_MAX_SEG];
+extern uint8_t  si_plan_nseg;
+extern uint32_t si_reset_us;			// duration of the last MSi/Ri change with PLL reset (us)
+extern uint32_t si_reset_us_max;
+extern uint32_t si_reset_count;
+
+void si_plan_band(uint32_t f_lo, uint32_t f_hi);
+
+
+// Split operation: register images for the RX and TX frequency of clk0/1, prepared in si_evaluate()
+#define SI_IMG_RX		0
+#define SI_IMG_TX		1
+typedef struct
+{
+	uint32_t freq;		// Fout
+	uint8_t  msi;
+	uint8_t  ri;
+	uint8_t  msn_a;
+	uint32_t msn_b;
+	uint8_t  msn[8];	// PLLA registers, ready to send
+} si_img_t;
+extern si_img_t si_img[2];
+extern uint8_t  si_img_sel;				// image in the Si5351 (SI_IMG_RX or SI_IMG_TX)
+extern volatile bool si_img_same;		// RX and TX images are equal
+extern uint32_t si_tx_freq;				// TX Fout, 0 = same as RX (vfo[0].freq)
+extern uint32_t si_txrx_us;				// duration of the last RX/TX switch (us)
+extern uint32_t si_txrx_us_max;
+
+void si_txrx(uint8_t sel);
+bool si_tx_ready(void);
+
 
 int  si_getreg(uint8_t *data, uint8_t reg, uint8_t len);
 void si_init(void);
@@ -38,6 +86,7 @@ void si_evaluate(void);
 //#define SI_INCFREQ(i, d)	if ((((i)>=0)&&((i)<2))&&((vfo[(i)].freq)<(150000000-(d)))) { vfo[(i)].freq += (d); vfo[(i)].flag = 1;}
 //#define SI_DECFREQ(i, d)	if ((((i)>=0)&&((i)<2))&&((vfo[(i)].freq)>(d))) { (vfo[(i)].freq) -= (d); vfo[(i)].flag = 1;}
 #define SI_SETFREQ(i, f)	if ((((i)>=0)&&((i)<2))&&((f)<150000000)) { vfo[(i)].freq = (f); vfo[(i)].flag = 1;}
+#define SI_SETFREQ_TX(f)	if ((f)<150000000) { si_tx_freq = (f); vfo[0].flag = 1;}
 #define SI_SETPHASE(i, p)	if (((i)>=0)&&((i)<2)) {vfo[(i)].phase = ((uint8_t)p)&3; vfo[(i)].flag = 1;}
 
 
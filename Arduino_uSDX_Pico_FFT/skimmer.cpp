@@ -0,0 +1,319 @@
+/*
+ * skimmer.cpp
+ *
+ * Created: Oct 2026
+ *
+ * CW skimmer: up to SK_NCH signals of the band map (bandmap.cpp) are decoded at the same time.
+ *
+ * Channel (core1 DMA IRQ, sk_block): the raw I/Q samples (160kHz, before the main DDC) are mixed
+ * with the NCO of the channel (ddc_sin table) and integrated over SK_NBLOCK blocks = 400 samples.
+ * The magnitude of the sum is a single DFT bin of 2.5ms (~400Hz wide), twice the level rate the
+ * audio decoder gets from rx() (5ms). The levels go into a double buffer of SK_NLEVEL (100ms).
+ *
+ * Decoder (core1 loop, sk_decode): each channel has its own cw_dec_t, the buffer that is not being
+ * filled runs through cw_dec_level(), threshold and timing follow the signal of the channel.
+ * Channel changes requested by core0 are applied here too, so the IRQ and the decoder state are
+ * only touched from core1.
+ *
+ * Assignment and output (core0, sk_fft_line after bm_fft_line): a channel stays on its band map
+ * entry until the entry expires, free channels take the strongest entries not decoded yet.
+ * The decoded characters are read from the decoder out list, every complete word goes to the
+ * serial port with its frequency, the text and the last callsign are kept for the list view.
+ */
+
+#include "Arduino.h"
+#include "uSDR.h"
+#include "hmi.h"
+#include "dsp.h"
+#include "bandmap.h"
+#include "skimmer.h"
+
+
+sk_ch_t sk_ch[SK_NCH];
+volatile bool sk_on = false;
+bool sk_changed = false;
+
+static volatile uint32_t sk_lo;
+static volatile bool     sk_relo = false;
+static uint16_t sk_cnt = 0;							// blocks in the integration
+static uint16_t sk_index = 0;						// level in the buffer being filled
+static volatile uint32_t sk_nbuf = 0;				// buffers filled, the one being filled is sk_nbuf & 1
+static uint32_t sk_nbuf_old = 0;
+volatile uint32_t sk_drops = 0;						// buffers not decoded (sk_decode late by 100ms or more)
+
+
+/*
+ * Core1 DMA IRQ: one block of BLOCK_NSAMP (I, Q, MIC)
+ */
+void __not_in_flash_func(sk_block)(volatile int16_t *samp)
+{
+	sk_ch_t *ch;
+	uint16_t n, i;
+	uint32_t phase, k;
+	int32_t x_i, x_q, s, c, a_i, a_q, level;
+
+	for (n=0; n<SK_NCH; n++)
+	{
+		ch = &sk_ch[n];
+		if (!ch->on) continue;
+		phase = ch->phase;
+		a_i = ch->acc_i;
+		a_q = ch->acc_q;
+		for (i=0; i<BLOCK_NSAMP; i+=3)
+		{
+			x_i = samp[i];
+			x_q = samp[i+1];
+			k = phase >> (32u - DDC_LUT_BITS);
+			s = ddc_sin[k];
+			c = ddc_sin[(k + (DDC_LUT_SIZE/4u)) & DDC_LUT_MASK];
+			a_i += (x_i * c + x_q * s) >> SK_MIX_SHIFT;
+			a_q += (x_q * c - x_i * s) >> SK_MIX_SHIFT;
+			phase += ch->step;
+		}
+		ch->phase = phase;
+		ch->acc_i = a_i;
+		ch->acc_q = a_q;
+	}
+	if (++sk_cnt < SK_NBLOCK) return;
+	sk_cnt = 0;
+
+	for (n=0; n<SK_NCH; n++)
+	{
+		ch = &sk_ch[n];
+		a_i = abs(ch->acc_i);
+		a_q = abs(ch->acc_q);
+		level = (a_i > a_q) ? a_i + ((3*a_q)>>3) : a_q + ((3*a_i)>>3);		// alpha max plus beta min
+		level >>= SK_LEVEL_SHIFT;
+		ch->level[sk_nbuf & 1][sk_index] = (level > 0xffff) ? 0xffff : (uint16_t)level;
+		ch->acc_i = 0;
+		ch->acc_q = 0;
+	}
+	if (++sk_index >= SK_NLEVEL)
+	{
+		sk_index = 0;
+		sk_nbuf++;
+	}
+}
+
+
+static uint32_t sk_step(uint32_t freq, uint32_t lo)
+{
+	return (uint32_t)(((int64_t)(int32_t)(freq - lo) * 4294967296LL) / (int64_t)DDC_FSAMP);
+}
+
+/*
+ * Core1 loop: channel requests and the levels of the last 100ms
+ */
+void sk_decode(void)
+{
+	sk_ch_t *ch;
+	uint8_t n, arr;
+	uint16_t i;
+	uint32_t freq, nbuf;
+	bool relo;
+
+	// flags are cleared before the data is read: a request core0 makes after the read sets them again
+	relo = false;
+	if (sk_relo)
+	{
+		sk_relo = false;
+		__dmb();
+		relo = true;
+	}
+	for (n=0; n<SK_NCH; n++)
+	{
+		ch = &sk_ch[n];
+		if (ch->req)
+		{
+			ch->on = false;								// the IRQ leaves the channel alone
+			do
+			{
+				ch->req = false;
+				__dmb();
+				if (ch->req_reset)
+				{
+					ch->req_reset = false;
+					cw_dec_init(&ch->dec, false);
+				}
+				freq = ch->req_freq;
+				ch->step = sk_step(freq, sk_lo);
+				ch->phase = 0;
+				ch->acc_i = 0;
+				ch->acc_q = 0;
+			} while (ch->req);							// a request during the update is applied too
+			ch->on = (freq != 0);
+		}
+		else if (relo && ch->on)
+			ch->step = sk_step(ch->req_freq, sk_lo);
+	}
+
+	nbuf = sk_nbuf;										// one read: the IRQ may flip the buffers again meanwhile
+	if (nbuf == sk_nbuf_old) return;
+	if ((nbuf - sk_nbuf_old) > 1)
+		sk_drops += nbuf - sk_nbuf_old - 1;
+	sk_nbuf_old = nbuf;
+	arr = (uint8_t)((nbuf - 1) & 1);					// the last one filled
+	for (n=0; n<SK_NCH; n++)
+	{
+		ch = &sk_ch[n];
+		if (!ch->on) continue;
+		for (i=0; i<SK_NLEVEL; i++)
+			cw_dec_level(&ch->dec, ch->level[arr][i]);
+	}
+}
+
+
+/*
+ * Core0: channel to a new frequency, 0 = free
+ */
+static void sk_set(uint8_t n, uint32_t freq, bool reset)
+{
+	sk_ch_t *ch = &sk_ch[n];
+
+	ch->freq = freq;
+	if (reset || (freq == 0))
+	{
+		memset(ch->text, ' ', SK_TEXT_LEN);
+		ch->text[SK_TEXT_LEN] = 0;
+		memset(ch->call, 0, sizeof(ch->call));
+		ch->nword = 0;
+		ch->out_tail = ch->dec.out_head;
+	}
+	ch->req_freq = freq;
+	if (reset) ch->req_reset = true;					// core1 clears it: a pending reset is not lost
+	__dmb();
+	ch->req = true;
+	sk_changed = true;
+}
+
+void sk_enable(bool on)
+{
+	uint8_t n;
+
+	sk_on = on;
+	for (n=0; n<SK_NCH; n++)
+		sk_set(n, 0, false);
+}
+
+void sk_tune(uint32_t lo)
+{
+	sk_lo = lo;
+	__dmb();
+	sk_relo = true;
+}
+
+
+/*
+ * Callsign: prefix with a letter, digit at position 1-3, suffix of 1-4 letters
+ */
+static bool sk_is_call(const char *w)
+{
+	int len = strlen(w), p, i;
+	bool letter = false;
+
+	if ((len < 3) || (len > SK_CALL_LEN)) return false;
+	for (p=len-1; (p>=0) && !isdigit(w[p]); p--);
+	if ((p < 1) || (p > 3) || (len-1-p < 1) || (len-1-p > 4)) return false;
+	for (i=p+1; i<len; i++)
+		if (!isalpha(w[i])) return false;
+	for (i=0; i<p; i++)
+	{
+		if (isalpha(w[i])) letter = true;
+		else if (!isdigit(w[i])) return false;
+	}
+	return letter;
+}
+
+static void sk_word(sk_ch_t *ch)
+{
+	char s[40];
+
+	if (ch->nword == 0) return;
+	ch->word[ch->nword] = 0;
+	ch->nword = 0;
+	if (sk_is_call(ch->word))
+		strcpy(ch->call, ch->word);
+	sprintf(s, "SK %lu.%lu %s", (unsigned long)(ch->freq/1000), (unsigned long)((ch->freq%1000)/100), ch->word);
+	Serialx.println(s);
+}
+
+static void sk_read(sk_ch_t *ch)
+{
+	uint8_t head = ch->dec.out_head;
+	char c;
+
+	if ((uint8_t)(head - ch->out_tail) > CW_OUT_LEN)
+		ch->out_tail = head - CW_OUT_LEN;				// overrun, only the last ones are there
+	while (ch->out_tail != head)
+	{
+		c = ch->dec.out[ch->out_tail & (CW_OUT_LEN-1)];
+		ch->out_tail++;
+		memmove(ch->text, ch->text+1, SK_TEXT_LEN-1);
+		ch->text[SK_TEXT_LEN-1] = c;
+		if (c == ' ')
+			sk_word(ch);
+		else
+		{
+			ch->word[ch->nword++] = c;
+			if (ch->nword >= SK_WORD_LEN) sk_word(ch);
+		}
+		sk_changed = true;
+	}
+}
+
+
+/*
+ * Core0: channels follow the band map, new signals get the free channels
+ */
+void sk_fft_line(void)
+{
+	bool used[BM_NSIG];
+	sk_ch_t *ch;
+	uint8_t n, i;
+	int best;
+	uint32_t d, best_d;
+
+	if (!sk_on) return;
+	memset(used, 0, sizeof(used));
+
+	for (n=0; n<SK_NCH; n++)
+	{
+		ch = &sk_ch[n];
+		if (ch->freq == 0) continue;
+		best = -1;
+		best_d = BM_MATCH_HZ + 1;
+		for (i=0; i<bm_nsig; i++)
+		{
+			if ((bm_sig[i].bin < 0) || used[i]) continue;
+			d = abs((int32_t)(bm_sig[i].freq - ch->freq));
+			if (d < best_d) { best = i; best_d = d; }
+		}
+		if (best < 0)
+		{
+			sk_word(ch);
+			sk_set(n, 0, false);							// expired or outside the span
+			continue;
+		}
+		used[best] = true;
+		if (best_d > SK_RETUNE_HZ)
+			sk_set(n, bm_sig[best].freq, false);
+	}
+
+	for (n=0; n<SK_NCH; n++)
+	{
+		ch = &sk_ch[n];
+		if (ch->freq != 0) continue;
+		best = -1;
+		for (i=0; i<bm_nsig; i++)
+		{
+			if ((bm_sig[i].bin < 0) || used[i]) continue;
+			if ((best < 0) || (bm_sig[i].level > bm_sig[best].level)) best = i;
+		}
+		if (best < 0) break;
+		used[best] = true;
+		sk_set(n, bm_sig[best].freq, true);
+	}
+
+	for (n=0; n<SK_NCH; n++)
+		if (sk_ch[n].freq != 0) sk_read(&sk_ch[n]);
+}
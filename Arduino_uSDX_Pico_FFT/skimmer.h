@@ -0,0 +1,64 @@
+#ifndef __SKIMMER_H__
+#define __SKIMMER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * skimmer.h
+ *
+ * Created: Oct 2026
+ *
+ * See skimmer.cpp for more information
+ */
+
+#include "CwDecoder.h"
+
+#define SK_NCH				6		// decoder channels
+#define SK_NBLOCK			40		// DMA blocks per level: 40 * 10 I/Q samples = 2.5ms
+#define SK_NLEVEL			40		// levels per buffer: 100ms, decoded while the other is filled
+#define SK_MIX_SHIFT		7		// mixer products (Q15) before the integration
+#define SK_LEVEL_SHIFT		13		// integrated magnitude to level (~16 per ADC count of carrier)
+#define SK_RETUNE_HZ		100		// channel follows the band map entry when it moves more
+#define SK_TEXT_LEN			24		// decoded text kept per channel
+#define SK_WORD_LEN			12
+#define SK_CALL_LEN			7
+
+typedef struct
+{
+	/* core0: assignment and text */
+	uint32_t freq;					// Hz, 0 = free
+	char     text[SK_TEXT_LEN+1];	// last characters decoded
+	char     call[SK_CALL_LEN+1];	// last word that looks like a callsign
+	char     word[SK_WORD_LEN+1];	// word being received
+	uint8_t  nword;
+	uint8_t  out_tail;				// read position in dec.out
+	/* core0 -> core1 */
+	volatile uint32_t req_freq;
+	volatile bool     req_reset;	// new signal: decoder starts over (set by core0, cleared by core1)
+	volatile bool     req;			// set after req_freq, cleared by core1 before it reads req_freq
+	/* core1: channel and decoder */
+	volatile bool     on;
+	uint32_t step;					// NCO
+	uint32_t phase;
+	int32_t  acc_i, acc_q;			// integrate and dump
+	uint16_t level[2][SK_NLEVEL];
+	cw_dec_t dec;
+} sk_ch_t;
+
+extern sk_ch_t sk_ch[SK_NCH];
+extern volatile bool sk_on;
+extern bool sk_changed;				// text or channels changed, for the list view
+extern volatile uint32_t sk_drops;		// level buffers lost (decoder late)
+
+void sk_enable(bool on);
+void sk_tune(uint32_t lo);						// LO changed, from hmi_setfreq()
+void sk_block(volatile int16_t *samp);			// core1 DMA IRQ, one block of raw I/Q samples
+void sk_decode(void);							// core1 loop
+void sk_fft_line(void);							// after bm_fft_line(), from display_tft_loop()
+
+#ifdef __cplusplus
+}
+#endif
+#endif
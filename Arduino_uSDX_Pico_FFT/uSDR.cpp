@@ -27,12 +27,15 @@
 #include "relay.h"
 #include "TFT_eSPI.h"
 #include "display_tft.h"
+#include "sched.h"
+#include "hmi_pio.h"
+#include "i2c_async.h"
+#include "settings.h"
+#include "memchan.h"
 
 
 
 
-uint16_t tim_loc;     // local time 
-
 void uSDR_setup0(void)  //main
 {
   display_intro();
@@ -92,7 +95,10 @@ Serialx.println("uSDR_setup   relay_init");
 
 
 
+set_restore();                // settings from flash, before the band is set up
 hmi_init0(); 
+set_start();
+mem_init();                   // index of the memory channels restored with the settings
 
 
 
@@ -101,7 +107,23 @@ Serialx.println("uSDR_setup   finished");
 
 
 
-  tim_loc = tim_count;          // local time for main loop
+  // main loop tasks
+#ifdef HMI_USE_PIO_INPUT
+  sched_add("enc",   hmi_pio_evaluate, NULL,              TASK_ENC_MS,   TASK_ENC_PRIO);    // Encoder count from PIO
+#endif
+  sched_add("i2c",   i2ca_evaluate,    NULL,              TASK_I2C_MS,   TASK_I2C_PRIO);    // I2C queue: timeouts, callbacks
+  sched_add("si",    si_evaluate,      NULL,              TASK_SI_MS,    TASK_SI_PRIO);     // Refresh VFO settings
+#ifdef USE_TOUCH_SCREEN
+  sched_add("touch", touch_evaluate,   NULL,              TASK_TOUCH_MS, TASK_TOUCH_PRIO);
+#endif
+  sched_add("hmi",   hmi_evaluate,     NULL,              TASK_HMI_MS,   TASK_HMI_PRIO);    // Refresh HMI
+  sched_add("tft",   display_tft_loop, display_tft_ready, 0,             TASK_TFT_PRIO);    // Waterfall
+  sched_add("mon",   mon_evaluate,     NULL,              TASK_MON_MS,   TASK_MON_PRIO);    // Check monitor input
+  sched_add("swr",   hmi_swr_evaluate, NULL,              TASK_SWR_MS,   TASK_SWR_PRIO);
+  sched_add("mem",   mem_evaluate,     NULL,              TASK_MEM_MS,   TASK_MEM_PRIO);    // Memory scan
+  sched_add("dsp",   dsp_loop,         NULL,              TASK_DSP_MS,   TASK_DSP_PRIO);
+  sched_add("set",   set_evaluate,     NULL,              TASK_SET_MS,   TASK_SET_PRIO);    // Settings to flash when idle
+  sched_start();
   //digitalWrite(14, LOW);
 
 
@@ -111,62 +133,5 @@ Serialx.println("uSDR_setup   finished");
 
 void uSDR_loop(void)
 { 
-
-
-  if((uint16_t)(tim_count - tim_loc) >= (uint16_t)LOOP_MS)  //run the tasks every 100ms  (LOOP_MS = 100)
-  {
-
-   uint32_t st = millis(); 
-
-
-    #ifdef USE_TOUCH_SCREEN
-    touch_evaluate();             // must run before hmi_evaluate
-    #endif
- 
-    hmi_evaluate();               // Refresh HMI
-    //Serialx.println("hmi_evaluate   finished");
-   
-    si_evaluate();                // Refresh VFO settings
-    //Serialx.println("si_evaluate   finished");
-    
-    mon_evaluate();               // Check monitor input
-    //Serialx.println("mon_evaluate   finished");
-    
-    //Serialx.println("dsp_loop  started\n");
-    dsp_loop();  //spend more time here for FFT and graphic
-    //Serialx.println("dsp_loop   finished\n");
-
-    //Serialx.println("tft_loop  started\n");
-    display_tft_loop();           // Refresh display
-   // Serialx.println("tft_loop  finished\n");
-
-    //it takes around 35ms for the tasks (most in hmi_evaluate() to plot the waterfall)
-
-  /*  
-    
-  uint32_t diff = millis() - st;
-
-if (diff < 1000) {
-
-static uint32_t diff_old = 0;  
-  
-  if (diff_old != diff) {
-   char s [20];
-  
-  sprintf(s, "%lums", diff);
-  tft.setFreeFont(FONT1);
-  tft.setTextColor(TFT_GREEN);
-  tft.fillRect(170,105,50,22,TFT_BLACK);
-  tft.setCursor(170,120);
-  tft.print(s);
-  diff_old = diff;
-  }
-
-}
- 
- */
-    tim_loc += LOOP_MS;
-  }
-
-
+  sched_run();                  // one task per call, the highest priority one that is due
 }
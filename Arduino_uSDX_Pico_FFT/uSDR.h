@@ -13,7 +13,28 @@ extern "C" {
 #define Serialx   SerialUSB    //USB virtual serial  /dev/ttyACM0
 //#define Serialx   Serial   ///dev/ttyUSB0
 
-#define LOOP_MS    100  //100 miliseconds
+// main loop tasks (see sched.cpp): period in ms and priority (0 = highest)
+#define TASK_ENC_MS       5   //encoder poll (PIO input)
+#define TASK_SI_MS       10   //VFO settings
+#define TASK_I2C_MS       1   //I2C timeouts and completion callbacks
+#define TASK_TOUCH_MS   100   //touch screen (touch_delay counts in 100ms)
+#define TASK_HMI_MS      20   //encoder/UI
+#define TASK_MON_MS      10   //monitor input
+#define TASK_SWR_MS     200   //power and SWR during TX
+#define TASK_DSP_MS     100
+#define TASK_SET_MS     500   //settings write-behind
+#define TASK_MEM_MS      20   //memory scan
+#define TASK_ENC_PRIO     0
+#define TASK_SI_PRIO      0
+#define TASK_I2C_PRIO     1
+#define TASK_TOUCH_PRIO   1
+#define TASK_HMI_PRIO     2
+#define TASK_TFT_PRIO     3   //waterfall, runs when a new FFT line is ready
+#define TASK_MON_PRIO     4
+#define TASK_SWR_PRIO     5
+#define TASK_DSP_PRIO     6
+#define TASK_SET_PRIO     7
+#define TASK_MEM_PRIO     5
 
 
 
@@ -0,0 +1,116 @@
+/*
+ * cw_morse_test.cpp
+ *
+ * Host test of the letter packing and lookup of the CW decoder (CwMorse.h, as CwDecoder.cpp uses it):
+ *  - every character of tab_morse goes through cw_letter_add() element by element (new_dot / new_dash)
+ *    and back through cw_letter_char() (new_space_letters)
+ *  - the same from mark durations with cw_letter_marks() (held letters), over the range of tdot
+ *  - every other dot/dash pattern up to CW_TREE_DEPTH gives no character, longer letters and an
+ *    empty one give none either (shown as '#' by the decoder)
+ *
+ *   g++ -std=c++17 -Wall -o cw_morse_test cw_morse_test.cpp
+ *   ./cw_morse_test
+ *
+ * Returns 0 when all checks pass.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../Arduino_uSDX_Pico_FFT/CwMorse.h"
+
+#define TDOT_MIN    4       // levels, as CwDecoder.cpp
+#define TDOT_MAX    96
+
+static int n_err = 0;
+
+static void check(bool ok, const char *what, const char *code)
+{
+  if (ok) return;
+  printf("FAIL %s: %s\n", what, code);
+  n_err++;
+}
+
+// elements of a letter one by one, as cw_dec_level() does at each falling edge
+static char letter_code(const char *code)
+{
+  uint16_t letter = 0, pos = 0;
+
+  for (; *code; code++)
+    cw_letter_add(&letter, &pos, *code == '-');
+  return cw_letter_char(letter, pos);
+}
+
+// marks of 1 and 3 dots, with the boundary of the mark clusters ((dot + dash) / 2)
+static char letter_marks(const char *code, uint16_t tdot)
+{
+  uint16_t mark[CW_TREE_DEPTH];
+  uint16_t n;
+
+  for (n = 0; code[n]; n++)
+    mark[n] = (code[n] == '-') ? 3 * tdot : tdot;
+  return cw_letter_char(cw_letter_marks(mark, n, 2 * tdot), n);
+}
+
+// pattern of pos elements (bit pos-1 = first element, 1 = dash) as a code string
+static void pattern_code(uint16_t bits, uint16_t pos, char *code)
+{
+  uint16_t i;
+
+  for (i = 0; i < pos; i++)
+    code[i] = ((bits >> (pos - 1 - i)) & 1) ? '-' : '.';
+  code[pos] = 0;
+}
+
+static const st_morse *table_find(const char *code)
+{
+  for (const st_morse &m : tab_morse)
+    if (strcmp(m.code, code) == 0) return &m;
+  return NULL;
+}
+
+
+int main(void)
+{
+  char code[24], c;
+  uint16_t tdot, pos, bits, n_code = 0, n_none = 0;
+
+  // the table round trip
+  for (const st_morse &m : tab_morse)
+  {
+    check(letter_code(m.code) == m.c, "element packing", m.code);
+    for (tdot = TDOT_MIN; tdot <= TDOT_MAX; tdot++)
+      check(letter_marks(m.code, tdot) == m.c, "mark durations", m.code);
+  }
+
+  // all patterns the tree can hold: a character only for the codes of the table
+  for (pos = 1; pos <= CW_TREE_DEPTH; pos++)
+    for (bits = 0; bits < (1u << pos); bits++)
+    {
+      pattern_code(bits, pos, code);
+      c = letter_code(code);
+      if (table_find(code))
+        n_code++;
+      else
+      {
+        check(c == 0, "not a code but decoded", code);
+        n_none++;
+      }
+    }
+
+  // no elements, and longer than the tree (up to more than the 16 bits of the letter)
+  check(cw_letter_char(0, 0) == 0, "empty letter", "");
+  for (pos = CW_TREE_DEPTH + 1; pos <= 20; pos++)
+  {
+    memset(code, '.', pos);
+    code[pos] = 0;
+    check(letter_code(code) == 0, "too long", code);
+    memset(code, '-', pos);
+    check(letter_code(code) == 0, "too long", code);
+  }
+
+  printf("%u characters, %u patterns with a character, %u without, %d errors\n",
+         (unsigned)(sizeof(tab_morse) / sizeof(tab_morse[0])), n_code, n_none, n_err);
+  return (n_err == 0) ? 0 : 1;
+}
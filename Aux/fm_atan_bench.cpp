@@ -0,0 +1,177 @@
+/*
+ * fm_atan_bench.cpp
+ *
+ * Host test of the I/Q phase functions for the FM discriminator (rectangular_2_phase() in dsp.cpp):
+ * error against atan2() in double and time per call, for
+ *  - atan2f() of libm
+ *  - arctan3() of uSDX_TX_PhaseAmpl.cpp (polynomial), with z in Q15
+ *  - atan tables of the first octant, nearest entry or linear interpolation (dsp.cpp: 32 interpolated)
+ * The angles are in 65536 = 2pi, as in the firmware. The times are of the host, only the ratios mean
+ * something for the RP2040 (no FPU there: atan2f is much slower than on the host).
+ *
+ *   g++ -O2 -o fm_atan_bench fm_atan_bench.cpp -lm
+ *   ./fm_atan_bench
+ *
+ * Add -fsanitize=address,undefined to check the table reads, the vectors include |i| == |q| and the axes.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#define ABS(x)      ((x) < 0 ? -(x) : (x))
+#define NVEC        65536
+#define NRUN        200
+
+static uint16_t atan_tab[1024+2];
+static uint32_t atan_bits;
+
+// table of atan(k/n) for n = 2^bits, +1 entry for z = 1.0 (|i| == |q|) as in dsp_init()
+static uint32_t atan_tab_make(uint32_t bits)
+{
+  uint32_t k, n = 1u << bits;
+
+  atan_bits = bits;
+  for (k = 0; k <= n + 1; k++)
+    atan_tab[k] = (uint16_t)lrint(65536.0 / (2.0 * M_PI) * atan((double)k / n));
+  return 2 * (n + 2);
+}
+
+// rectangular_2_phase() of dsp.cpp, table size as parameter
+static int16_t phase_tab_interp(int16_t i, int16_t q)
+{
+  int32_t ai = ABS((int32_t)i), aq = ABS((int32_t)q), a;
+  uint32_t z, k, f;
+
+  if (aq <= ai)
+  {
+    if (ai == 0) return 0;
+    z = ((uint32_t)aq << 15) / (uint32_t)ai;
+  }
+  else
+    z = ((uint32_t)ai << 15) / (uint32_t)aq;
+  k = z >> (15u - atan_bits);
+  f = z & ((1u << (15u - atan_bits)) - 1u);
+  a = atan_tab[k] + ((((int32_t)atan_tab[k+1] - atan_tab[k]) * (int32_t)f) >> (15u - atan_bits));
+  if (aq > ai) a = 16384 - a;
+  if (i < 0) a = 32768 - a;
+  return (int16_t)((q < 0) ? -a : a);
+}
+
+static int16_t phase_tab_near(int16_t i, int16_t q)
+{
+  int32_t ai = ABS((int32_t)i), aq = ABS((int32_t)q), a;
+  uint32_t z;
+
+  if (aq <= ai)
+  {
+    if (ai == 0) return 0;
+    z = ((uint32_t)aq << 15) / (uint32_t)ai;
+  }
+  else
+    z = ((uint32_t)ai << 15) / (uint32_t)aq;
+  a = atan_tab[(z + (1u << (14u - atan_bits))) >> (15u - atan_bits)];
+  if (aq > ai) a = 16384 - a;
+  if (i < 0) a = 32768 - a;
+  return (int16_t)((q < 0) ? -a : a);
+}
+
+// arctan3() of uSDX_TX_PhaseAmpl.cpp: (_UA/8 + _UA/22 - _UA/22 * z) * z, z = min/max in Q15
+#define _UA         65536
+#define ATAN3(z)    ((int32_t)(((((int64_t)(_UA/8 + _UA/22) << 15) - (int64_t)(_UA/22) * (z)) * (z)) >> 30))
+static int16_t phase_arctan3(int16_t i, int16_t q)
+{
+  int32_t ai = ABS((int32_t)i), aq = ABS((int32_t)q), r;
+
+  if (aq > ai)
+    r = _UA/4 - ATAN3(((int64_t)ai << 15) / aq);
+  else
+    r = (ai == 0) ? 0 : ATAN3(((int64_t)aq << 15) / ai);
+  r = (i < 0) ? _UA/2 - r : r;
+  return (int16_t)((q < 0) ? -r : r);
+}
+
+static int16_t phase_atan2f(int16_t i, int16_t q)
+{
+  return (int16_t)lrintf(atan2f((float)q, (float)i) * (65536.0f / (2.0f * (float)M_PI)));
+}
+
+
+typedef int16_t (*phase_fn)(int16_t i, int16_t q);
+
+static int16_t vec_i[NVEC], vec_q[NVEC];
+
+static double phase_time(phase_fn fn)
+{
+  volatile int32_t sum = 0;
+  struct timespec t0, t1;
+  int r, k;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (r = 0; r < NRUN; r++)
+    for (k = 0; k < NVEC; k++)
+      sum += fn(vec_i[k], vec_q[k]);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / ((double)NRUN * NVEC);
+}
+
+static void phase_test(const char *name, phase_fn fn, uint32_t bytes)
+{
+  double ref, e, e_max = 0.0, e_sq = 0.0;
+  int k;
+
+  for (k = 0; k < NVEC; k++)
+  {
+    ref = atan2((double)vec_q[k], (double)vec_i[k]) * 65536.0 / (2.0 * M_PI);
+    e = fabs((double)fn(vec_i[k], vec_q[k]) - ref);
+    if (e > 32768.0) e = 65536.0 - e;   // +-pi wrap
+    if (e > e_max) e_max = e;
+    e_sq += e * e;
+  }
+  printf("%-22s %5u bytes  max %6.3f deg  rms %6.4f deg  %5.2f ns\n", name, bytes,
+         e_max * 360.0 / 65536.0, sqrt(e_sq / NVEC) * 360.0 / 65536.0, phase_time(fn));
+}
+
+
+int main(void)
+{
+  double a, m;
+  int k;
+
+  // random vectors over the signal range of the FM filter, then the octant borders and the axes
+  srand(1);
+  for (k = 0; k < NVEC - 16; k++)
+  {
+    a = rand() * 2.0 * M_PI / RAND_MAX;
+    m = 50 + rand() % 30000;
+    vec_i[k] = (int16_t)lrint(m * cos(a));
+    vec_q[k] = (int16_t)lrint(m * sin(a));
+  }
+  for (; k < NVEC; k++)
+  {
+    m = 100 + 1000 * (k & 1);
+    if (k & 8)                          // |i| == |q|: z = 1.0, the last table entry
+    {
+      vec_i[k] = (int16_t)((k & 2) ? -m : m);
+      vec_q[k] = (int16_t)((k & 4) ? -m : m);
+    }
+    else                                // axes
+    {
+      vec_i[k] = (int16_t)((k & 2) ? 0 : ((k & 4) ? -m : m));
+      vec_q[k] = (int16_t)((k & 2) ? ((k & 4) ? -m : m) : 0);
+    }
+  }
+
+  printf("phase of %d I/Q vectors, error against atan2() in double, host time per call\n", NVEC);
+  phase_test("atan2f (libm)", phase_atan2f, 0);
+  phase_test("arctan3 (uSDX_TX)", phase_arctan3, 0);
+  phase_test("table 256, nearest", phase_tab_near, atan_tab_make(8));
+  phase_test("table 1024, nearest", phase_tab_near, atan_tab_make(10));
+  phase_test("table 16, interp.", phase_tab_interp, atan_tab_make(4));
+  phase_test("table 32, interp.", phase_tab_interp, atan_tab_make(5));   // dsp.cpp
+  phase_test("table 64, interp.", phase_tab_interp, atan_tab_make(6));
+  phase_test("table 256, interp.", phase_tab_interp, atan_tab_make(8));
+  return 0;
+}
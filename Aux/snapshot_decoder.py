@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+#
+# snapshot_decoder.py
+#
+# Decodes the screen snapshot sent by the monitor command "ss" and writes a PNG.
+# Input is a serial port (needs pyserial) or a file with the captured bytes.
+#
+#   python3 snapshot_decoder.py /dev/ttyACM0 screen.png
+#   python3 snapshot_decoder.py capture.bin screen.png
+#
+# Frame format: see display_tft_snapshot() in display_tft.cpp
+#
+
+import os
+import struct
+import sys
+import time
+import zlib
+
+SNAP_SYNC = 0xA5
+
+
+def read_frame(data):
+    pos = data.find(bytes([SNAP_SYNC, ord('F')]))
+    if pos < 0:
+        raise ValueError("frame start not found")
+    width, height = struct.unpack_from(">HH", data, pos + 2)
+    pos += 6
+    img = [[0] * width for _ in range(height)]
+    lines = 0
+    while True:
+        if data[pos] != SNAP_SYNC:
+            raise ValueError("lost sync at byte %d" % pos)
+        rec = chr(data[pos + 1])
+        if rec == 'E':
+            break
+        if rec != 'L':
+            raise ValueError("unknown record %r" % rec)
+        y, length = struct.unpack_from(">HH", data, pos + 2)
+        payload = data[pos + 6:pos + 6 + length]
+        (chk,) = struct.unpack_from(">H", data, pos + 6 + length)
+        if (sum(payload) & 0xffff) != chk:
+            print("line %d: checksum error" % y)
+        x = 0
+        for i in range(0, length, 3):
+            run = payload[i]
+            (color,) = struct.unpack_from(">H", payload, i + 1)
+            for _ in range(run):
+                if x < width:
+                    img[y][x] = color
+                x += 1
+        lines += 1
+        pos += 6 + length + 2
+    return width, height, img, lines
+
+
+def write_png(name, width, height, img):
+    raw = bytearray()
+    for row in img:
+        raw.append(0)  # filter none
+        for c in row:
+            r = (c >> 11) & 0x1f
+            g = (c >> 5) & 0x3f
+            b = c & 0x1f
+            raw += bytes(((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)))
+
+    def chunk(tag, body):
+        return (struct.pack(">I", len(body)) + tag + body +
+                struct.pack(">I", zlib.crc32(tag + body) & 0xffffffff))
+
+    with open(name, "wb") as f:
+        f.write(b"\x89PNG\r\n\x1a\n")
+        f.write(chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, 8, 2, 0, 0, 0)))
+        f.write(chunk(b"IDAT", zlib.compress(bytes(raw), 9)))
+        f.write(chunk(b"IEND", b""))
+
+
+def read_serial(port):
+    import serial
+    ser = serial.Serial(port, 115200, timeout=1)
+    ser.reset_input_buffer()
+    ser.write(b"ss\r")
+    t0 = time.time()
+    data = bytearray()
+    while True:
+        chunk = ser.read(4096)
+        data += chunk
+        try:
+            read_frame(bytes(data))  # complete frame received?
+            break
+        except (IndexError, struct.error, ValueError):
+            pass
+        if not chunk and time.time() - t0 > 5:
+            raise ValueError("timeout, %d bytes received" % len(data))
+    print("%d bytes in %.2f s" % (len(data), time.time() - t0))
+    ser.close()
+    return bytes(data)
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("usage: snapshot_decoder.py <port|file> [out.png]")
+        return 1
+    src = sys.argv[1]
+    out = sys.argv[2] if len(sys.argv) > 2 else "snapshot.png"
+    if os.path.isfile(src):
+        with open(src, "rb") as f:
+            data = f.read()
+    else:
+        data = read_serial(src)
+    width, height, img, lines = read_frame(data)
+    write_png(out, width, height, img)
+    print("%s: %dx%d, %d lines" % (out, width, height, lines))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,176 @@
+//  Based on QCX-SSB.ino - https://github.com/threeme3/QCX-SSB
+//
+//  Copyright 2019, 2020, 2021   Guido PE1NNZ <pe1nnz@amsat.org>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions: The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software. THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Adapted by: Klaus Fensterseifer PY2KLA
+//  https://github.com/kaefe64/Arduino_uSDX_Pico_FFT_Proj
+
+
+#include "Arduino.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/clocks.h"
+#include "uSDX_PIO_I2C.h"
+
+
+
+
+// The bit-banging I2C spends the whole transfer in the CPU (88us for a PLL update at 731kbit/s).
+// Here a PIO state machine generates SCL/SDA and a DMA channel feeds it, so the CPU only formats
+// the 6 FIFO words of the PLL update and returns. Both lines are open drain: the output level
+// is 0 and the PIO drives the pin directions (1 = pull low, 0 = released to the pullup).
+// 4 PIO cycles per SCL period, each FIFO word carries START flag, data byte and STOP flag.
+/*
+ * .side_set 1 opt pindirs             SCL = side-set pin, SDA = set/out pin
+ *  0  top:     pull block
+ *  1           out x, 1                START flag
+ *  2           jmp !x, byte
+ *  3           set pindirs, 1  [1]     START: SDA low while SCL high
+ *  4           nop      side 1 [1]     SCL low
+ *  5  byte:    set y, 7
+ *  6  bitloop: out pindirs, 1  side 1  SDA = data bit while SCL low
+ *  7           nop      side 0 [1]     SCL high
+ *  8           jmp y--, bitloop side 1
+ *  9           set pindirs, 0  side 1  release SDA for the ACK
+ *  10          nop      side 0 [1]     ACK clock, not checked
+ *  11          nop      side 1
+ *  12          out x, 1                STOP flag
+ *  13          jmp !x, top             next byte, SCL stays low
+ *  14          set pindirs, 1  side 1 [1]
+ *  15          nop      side 0 [1]     SCL high
+ *  16          set pindirs, 0  [1]     STOP: SDA high while SCL high (wrap)
+ */
+#define PIO_I2C_WRAP_TARGET   0
+#define PIO_I2C_WRAP          16
+#define PIO_I2C_CYCLES        4         // PIO cycles per SCL period
+static const uint16_t pio_i2c_instr[] =
+{
+  0x80a0,
+  0x6021,
+  0x0025,
+  0xe181,
+  0xb942,
+  0xe047,
+  0x7881,
+  0xb142,
+  0x1886,
+  0xf880,
+  0xb142,
+  0xb842,
+  0x6021,
+  0x0020,
+  0xf981,
+  0xb142,
+  0xe180
+};
+static const struct pio_program pio_i2c_prog = { pio_i2c_instr, sizeof(pio_i2c_instr)/sizeof(uint16_t), -1 };
+
+
+
+
+//***********************************************************************
+//
+//  class PIO_I2C
+//
+//***********************************************************************
+
+
+//***********************************************************************
+  void PIO_I2C::begin(uint sda_pin, uint scl_pin, uint32_t scl_hz){
+    uint32_t mask = (1u << sda_pin) | (1u << scl_pin);
+    uint offset;
+    pio_sm_config c;
+    dma_channel_config dc;
+
+    pio = PIO_I2C_PIO;
+    sda = sda_pin;
+    scl = scl_pin;
+    buf_sel = 0;
+
+    offset = pio_add_program(pio, &pio_i2c_prog);
+    sm = pio_claim_unused_sm(pio, true);
+
+    c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + PIO_I2C_WRAP_TARGET, offset + PIO_I2C_WRAP);
+    sm_config_set_out_pins(&c, sda, 1);
+    sm_config_set_set_pins(&c, sda, 1);
+    sm_config_set_sideset_pins(&c, scl);
+    sm_config_set_sideset(&c, 2, true, true);       // 1 bit + opt, on pindirs
+    sm_config_set_out_shift(&c, false, false, 32);  // MSB first, explicit pull
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);  // 8 words: a PLL update fits in the FIFO
+    sm_config_set_clkdiv(&c, (float)clock_get_hz(clk_sys) / (float)(PIO_I2C_CYCLES * scl_hz));
+
+    gpio_pull_up(sda);
+    gpio_pull_up(scl);
+    pio_sm_set_pins_with_mask(pio, sm, 0, mask);     // level low, open drain by pindirs
+    pio_sm_set_pindirs_with_mask(pio, sm, 0, mask);  // both released = bus idle
+    pio_gpio_init(pio, sda);
+    pio_gpio_init(pio, scl);
+
+    pio_sm_init(pio, sm, offset, &c);
+    pio_sm_set_enabled(pio, sm, true);
+
+    dma_ch = dma_claim_unused_channel(true);
+    dc = dma_channel_get_default_config(dma_ch);
+    channel_config_set_transfer_data_size(&dc, DMA_SIZE_32);
+    channel_config_set_read_increment(&dc, true);
+    channel_config_set_write_increment(&dc, false);
+    channel_config_set_dreq(&dc, pio_get_dreq(pio, sm, true));
+    dma_channel_configure(dma_ch, &dc, &pio->txf[sm], NULL, 0, false);
+  }
+
+
+//***********************************************************************
+  void PIO_I2C::send(const uint32_t* words, uint8_t n){
+    // the words are self-delimiting (START/STOP flags), so a burst can follow the last one in the FIFO
+    dma_channel_wait_for_finish_blocking(dma_ch);
+    dma_channel_transfer_from_buffer_now(dma_ch, words, n);
+  }
+
+
+//***********************************************************************
+  void PIO_I2C::write(uint8_t addr, uint8_t reg, const volatile uint8_t* data, uint8_t n){
+    uint32_t *w = buf[buf_sel];
+    uint8_t i;
+
+    if(n > PIO_I2C_MAXBYTES - 2) n = PIO_I2C_MAXBYTES - 2;
+    w[0] = PIO_I2C_START | PIO_I2C_DATA(addr << 1);
+    w[1] = PIO_I2C_DATA(reg);
+    for(i = 0; i < n; i++)
+      w[i+2] = PIO_I2C_DATA(data[i]);
+    w[n+1] |= PIO_I2C_STOP;
+
+    send(w, n+2);  // the other buffer is free once this one is taken
+    buf_sel ^= 1;
+  }
+
+
+//***********************************************************************
+  void PIO_I2C::wait(){
+    uint32_t stall = 1u << (PIO_FDEBUG_TXSTALL_LSB + sm);
+
+    dma_channel_wait_for_finish_blocking(dma_ch);
+    while(!pio_sm_is_tx_fifo_empty(pio, sm)) ;
+    pio->fdebug = stall;                 // clear, set again when the SM waits at the pull with nothing to send
+    while(!(pio->fdebug & stall)) ;
+  }
+
+
+//***********************************************************************
+  void PIO_I2C::release(){
+    wait();
+    gpio_set_dir(sda, GPIO_IN);          // the bit-banging I2C drives the SIO direction, level stays 0
+    gpio_set_dir(scl, GPIO_IN);
+    gpio_set_function(sda, GPIO_FUNC_SIO);
+    gpio_set_function(scl, GPIO_FUNC_SIO);
+  }
+
+
+//***********************************************************************
+  void PIO_I2C::acquire(){
+    pio_gpio_init(pio, sda);
+    pio_gpio_init(pio, scl);
+  }
@@ -0,0 +1,73 @@
+#ifndef __USDX_PIO_I2C_H__
+#define __USDX_PIO_I2C_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+#include "hardware/pio.h"
+
+
+#define USDX_PIO_I2C        1           // Si5351 writes on the PIO I2C master (comment out to use the bit-banging I2C class)
+#define USDX_I2C_BENCHMARK  0           // 1: measure the PLL register updates per second at setup (~1s of PLL writes)
+
+#define PIO_I2C_PIO         pio0        // the TX test sketch has no other PIO programs loaded
+#define PIO_I2C_SCL_HZ      1000000UL   // 1MHz (Fm+); the Si5351 works up to ~1.4MHz with the 1K pullups
+#define PIO_I2C_MAXBYTES    12          // longest burst: address + register + 10 data bytes (the PLL update is 6)
+
+// FIFO word format: one I2C byte per word, shifted out MSB first
+#define PIO_I2C_START       0x80000000UL                          // START before the byte
+#define PIO_I2C_DATA(b)     ((uint32_t)((~(b)) & 0xff) << 23)     // data is inverted: pindir 1 = SDA low
+#define PIO_I2C_STOP        0x00400000UL                          // STOP after the ACK
+
+
+
+
+//***********************************************************************
+//
+//  Write-only I2C master on a PIO state machine, fed by DMA
+//  ACK is clocked but not checked, reads still use the bit-banging I2C class
+//
+//***********************************************************************
+class PIO_I2C {
+public:
+  PIO pio;
+  uint sm;
+  uint sda;
+  uint scl;
+  int dma_ch;
+  uint8_t buf_sel;                           // double buffer: format the next burst while the DMA sends the last one
+  uint32_t buf[2][PIO_I2C_MAXBYTES];
+
+//***********************************************************************
+  void begin(uint sda_pin, uint scl_pin, uint32_t scl_hz);
+
+//***********************************************************************
+  void write(uint8_t addr, uint8_t reg, const volatile uint8_t* data, uint8_t n);   // queue a register burst, returns when the DMA has it
+
+//***********************************************************************
+  void send(const uint32_t* words, uint8_t n);   // queue prepared FIFO words
+
+//***********************************************************************
+  void wait();      // until the last STOP is on the bus
+
+//***********************************************************************
+  void release();   // give the pins to SIO (bit-banging reads)
+
+//***********************************************************************
+  void acquire();   // and back to the PIO
+};
+
+
+
+extern PIO_I2C pio_i2c;
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -10,6 +10,7 @@
 
 #include "Arduino.h"
 #include "uSDX_I2C.h"
+#include "uSDX_PIO_I2C.h"
 #include "uSDX_SI5351.h"
 #include "uSDX_TX_PhaseAmpl.h"
 
@@ -74,6 +75,9 @@ vdf[10] = 0;
 
 //***********************************************************************
   void SI5351::SendPLLRegisterBulk(){
+#ifdef USDX_PIO_I2C
+    pio_i2c.write(SI5351_ADDR, 26+0*8 + 4, &pll_regs[4], 4);  // Write to PLLA, returns as soon as the DMA has it
+#else
     i2c.start();
     i2c.SendByte(SI5351_ADDR << 1);
     i2c.SendByte(26+0*8 + 4);  // Write to PLLA
@@ -83,16 +87,21 @@ vdf[10] = 0;
     i2c.SendByte(pll_regs[6]);
     i2c.SendByte(pll_regs[7]);
     i2c.stop();
+#endif
   }
 
   
 //***********************************************************************
   void SI5351::SendRegister(uint8_t reg, uint8_t* data, uint8_t n){
+#ifdef USDX_PIO_I2C
+    pio_i2c.write(SI5351_ADDR, reg, data, n);
+#else
     i2c.start();
     i2c.SendByte(SI5351_ADDR << 1);
     i2c.SendByte(reg);
     while (n--) i2c.SendByte(*data++);
     i2c.stop();      
+#endif
   }
 //***********************************************************************
   void SI5351::SendRegister(uint8_t reg, uint8_t val){ SendRegister(reg, &val, 1); }
@@ -175,6 +184,9 @@ vdf[10] = 0;
 
 //***********************************************************************
   uint8_t SI5351::RecvRegister(uint8_t reg){
+#ifdef USDX_PIO_I2C
+    pio_i2c.release();  // the PIO master is write-only
+#endif
     i2c.start();  // Data write to set the register address
     i2c.SendByte(SI5351_ADDR << 1);
     i2c.SendByte(reg);
@@ -183,6 +195,9 @@ vdf[10] = 0;
     i2c.SendByte((SI5351_ADDR << 1) | 1);
     uint8_t data = i2c.RecvByte(true);
     i2c.stop();
+#ifdef USDX_PIO_I2C
+    pio_i2c.acquire();
+#endif
     return data;
   }
 
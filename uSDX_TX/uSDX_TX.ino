@@ -24,6 +24,7 @@
 //      Output: Amplitude at GP21 = I TX 
 //      Output: CW Side Tone at GP22 = Audio
 // - it needs the 1K pullup change on SCL SDA I2C in Si5351 board, similar to "Modifying SI 5351 Module:"  at https://antrak.org.tr/blog/usdx-a-compact-sota-ssb-sdr-transceiver-with-arduino/
+// - Si5351 writes go through a PIO + DMA I2C master (uSDX_PIO_I2C.h: USDX_PIO_I2C), the setup prints the PLL updates/s (USDX_I2C_BENCHMARK 1)
 // - it needs to be connected by USB to PC with the Serial Monitor running
 // - it just tests the transmission, no display, no reception.
 //
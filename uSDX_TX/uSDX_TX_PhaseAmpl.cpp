@@ -11,6 +11,7 @@
 #include "Arduino.h"
 #include "pwm.h"
 #include "uSDX_I2C.h"
+#include "uSDX_PIO_I2C.h"
 #include "uSDX_SI5351.h"
 #include "uSDX_TX_PhaseAmpl.h"
 
@@ -35,6 +36,9 @@ volatile uint16_t dac_iq, dac_audio;
 
 
 I2C i2c;
+#ifdef USDX_PIO_I2C
+PIO_I2C pio_i2c;
+#endif
 SI5351 si5351;
 
 
@@ -390,6 +394,9 @@ void uSDX_TX_PhaseAmpl_setup(void)
   uint32_t t0, t1;
   uint16_t i;
       
+#ifdef USDX_PIO_I2C
+  pio_i2c.begin(I2C_SDA, I2C_SCL, PIO_I2C_SCL_HZ);  // takes the pins from the bit-banging I2C
+#endif
   si5351.powerDown();  // disable all CLK outputs (especially needed for si5351 variants that has CLK2 enabled by default, such as Si5351A-B04486-GT)
 
   build_lut();  //create the table for ampl to pwm output conversion
@@ -446,12 +453,31 @@ void uSDX_TX_PhaseAmpl_setup(void)
   t0 = micros();
   for(i = 0; i != 1000; i++) 
     si5351.SendPLLRegisterBulk();
+#ifdef USDX_PIO_I2C
+  pio_i2c.wait();
+#endif
   t1 = micros();
   uint32_t speed = (1000000UL * 8 * 7) / (t1 - t0); // speed in kbit/s
   
   //if(false) {    fatal(F("i2cspeed"), speed, 'k');  }
   Serial.println("Result i2c speed: " + String(speed) + "k\n"); 
 
+#if USDX_I2C_BENCHMARK
+  // PLL register updates per second, the same calls as dsp_tx() does per sample (needs F_SAMP_TX/s)
+  uint32_t n_upd = 0;
+  t0 = micros();
+  do {
+    si5351.freq_calc_fast(n_upd & 0x3ff);
+    si5351.SendPLLRegisterBulk();
+    n_upd++;
+  } while((uint32_t)(micros() - t0) < 1000000UL);
+#ifdef USDX_PIO_I2C
+  pio_i2c.wait();
+#endif
+  t1 = micros();
+  Serial.println("Result PLL updates: " + String((uint32_t)(((uint64_t)n_upd * 1000000UL) / (t1 - t0))) + "/s  (" + String(F_SAMP_TX) + "/s needed)\n"); 
+#endif
+
   
 
 